@@ -0,0 +1,405 @@
+/*************************************************
+ * 源文件：batch.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "batch.h"
+
+/*
+ * 局部函数声明
+ */
+static int bat_load(const char *list, struct batsub **subs, int *count,
+		char *errmsg);
+static void bat_parse(struct batsub *sub);
+static void bat_duplicate(struct batsub *subs, int count);
+static void bat_preload(const struct dataset *ds);
+static void bat_worker(struct condition *cond, int k, int sock,
+		struct batsub *subs);
+static void bat_fail(const struct batsub *sub, enum estatus code,
+		const char *msg);
+static void bat_emit(const struct batsub *sub, const char *buf, int len);
+static void bat_free(struct batsub *subs, int count);
+
+/*
+ * 接口函数：bat_run
+ * 功能：批量评测列表中的全部提交，每个提交的结果写到标准输出
+ * 参数：cond为除了basedir、magic和command之外的评测条件，
+ *   bt为批量评测的参数，errmsg接收错误信息
+ * 返回值：全部提交都已输出结果返回0；评测开始之前出错返回-1
+ * 注意：数据集在派生工作进程之前打开一次，由工作进程共享；
+ *   空闲的工作进程从父进程领取下一个提交，重的提交不会挡住其他工作进程；
+ *   结果由父进程按完成的顺序输出，见doc/HowTo_batch.txt
+ */
+int
+bat_run(struct condition *cond, const struct batch *bt, char *errmsg)
+{
+	struct batsub *subs;
+	struct pollfd pfd[BAT_JOBS_MAX];
+	int sock[BAT_JOBS_MAX];		/* 与工作进程通信的套接字，-1为已经结束 */
+	int cur[BAT_JOBS_MAX];		/* 正在评测的提交序号，-1为空闲 */
+	int who[BAT_JOBS_MAX];		/* pfd中各项对应的工作进程 */
+	pid_t pids[BAT_JOBS_MAX];
+	static char buf[ERR_MSG_MAX + EXTRA_MAX + 128];
+	char msg[ERR_MSG_MAX];
+	int i, k, n, len, jobs, count, next = 0, alive = 0;
+	int sv[2];
+
+	if (bat_load(bt->list, &subs, &count, errmsg) != 0)
+		return -1;
+	if ((cond->dataset = dd_open(cond->datadir, cond->store, errmsg)) == NULL) {
+		bat_free(subs, count);
+		return -1;
+	}
+	bat_preload(cond->dataset);
+	fflush(stdout);
+
+	/* 派生工作进程，套接字不被用户程序等继承 */
+	jobs = bt->jobs < count ? bt->jobs : count;
+	for (k = 0; k < jobs; ++k) {
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1)
+			break;
+		if ((pids[k] = fork()) == -1) {
+			close(sv[0]);
+			close(sv[1]);
+			break;
+		}
+		if (pids[k] == 0) {
+			for (i = 0; i < k; ++i)
+				if (sock[i] != -1)
+					close(sock[i]);
+			close(sv[0]);
+			bat_worker(cond, k, sv[1], subs);
+			_exit(0);
+		}
+		close(sv[1]);
+		sock[k] = sv[0];
+		cur[k] = -1;
+		++alive;
+	}
+	if (alive == 0 && count > 0) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**bat_run** start worker error: %s", strerror(errno));
+		dd_close(cond->dataset);
+		cond->dataset = NULL;
+		bat_free(subs, count);
+		return -1;
+	}
+	jobs = k;
+
+	while (alive > 0) {
+		/* 空闲的工作进程领取下一个提交，格式错误的提交直接输出结果 */
+		for (k = 0; k < jobs; ++k) {
+			if (sock[k] == -1 || cur[k] != -1)
+				continue;
+			while (next < count && subs[next].error != NULL) {
+				bat_fail(&subs[next], EXIT_EE, subs[next].error);
+				++next;
+			}
+			if (next < count &&
+					send(sock[k], &next, sizeof(int), MSG_NOSIGNAL) ==
+					sizeof(int)) {
+				cur[k] = next++;
+				continue;
+			}
+
+			/* 没有提交了，或者工作进程已经退出 */
+			close(sock[k]);
+			sock[k] = -1;
+			--alive;
+		}
+
+		n = 0;
+		for (k = 0; k < jobs; ++k) {
+			if (sock[k] == -1)
+				continue;
+			pfd[n].fd = sock[k];
+			pfd[n].events = POLLIN;
+			who[n++] = k;
+		}
+		if (n == 0)
+			break;
+		if (poll(pfd, n, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+
+			/* 无法再等待结果，正在评测的提交为IE，工作进程读到EOF后退出 */
+			snprintf(msg, ERR_MSG_MAX, "**bat_run** poll error: %s",
+					strerror(errno));
+			for (k = 0; k < jobs; ++k) {
+				if (sock[k] == -1)
+					continue;
+				if (cur[k] != -1)
+					bat_fail(&subs[cur[k]], EXIT_IE, msg);
+				close(sock[k]);
+				sock[k] = -1;
+			}
+			alive = 0;
+			break;
+		}
+
+		for (i = 0; i < n; ++i) {
+			if (pfd[i].revents == 0)
+				continue;
+			k = who[i];
+			if ((len = recv(sock[k], buf, sizeof(buf), 0)) > 0) {
+				bat_emit(&subs[cur[k]], buf, len);
+				cur[k] = -1;
+				continue;
+			}
+			if (len == -1 && errno == EINTR)
+				continue;
+
+			/* 工作进程异常退出，正在评测的提交为IE，不再使用它 */
+			snprintf(msg, ERR_MSG_MAX, "**bat_run** worker %d exited.", k);
+			bat_fail(&subs[cur[k]], EXIT_IE, msg);
+			close(sock[k]);
+			sock[k] = -1;
+			--alive;
+		}
+	}
+
+	/* 工作进程都异常退出时还有没评测的提交 */
+	for (; next < count; ++next)
+		bat_fail(&subs[next], subs[next].error != NULL ? EXIT_EE : EXIT_IE,
+				subs[next].error != NULL ? subs[next].error :
+				"**bat_run** no worker left.");
+
+	for (k = 0; k < jobs; ++k)
+		while (waitpid(pids[k], NULL, 0) == -1 && errno == EINTR)
+			;
+	dd_close(cond->dataset);
+	cond->dataset = NULL;
+	bat_free(subs, count);
+	return 0;
+}
+
+/*
+ * 局部函数：bat_load
+ * 功能：读取提交列表，跳过空行和以'#'开头的注释行
+ * 参数：list为列表文件，subs和count接收提交数组和个数，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：格式错误的行也作为一个提交，其结果为EE，不影响其他提交；
+ *   basedir和编号都与前面的提交相同时临时输出文件会冲突，也作为格式错误
+ */
+static int
+bat_load(const char *list, struct batsub **subs, int *count, char *errmsg)
+{
+	FILE *fp;
+	struct batsub *tmp;
+	char *line = NULL;
+	size_t n = 0;
+	ssize_t len;
+	int size = 0;
+
+	*subs = NULL;
+	*count = 0;
+	if ((fp = fopen(list, "r")) == NULL) {
+		snprintf(errmsg, ERR_MSG_MAX, "**bat_load** fopen %s error: %s",
+				list, strerror(errno));
+		return -1;
+	}
+
+	while ((len = getline(&line, &n, fp)) != -1) {
+		if (len > 0 && line[len - 1] == '\n')
+			line[--len] = '\0';
+		if (line[strspn(line, " \t")] == '\0' || line[0] == '#')
+			continue;
+
+		if (*count == size) {
+			size = size == 0 ? 64 : size * 2;
+			if ((tmp = realloc(*subs, sizeof(struct batsub) * size)) == NULL) {
+				sprintf(errmsg, "**bat_load** realloc error.");
+				goto errexit;
+			}
+			*subs = tmp;
+		}
+
+		/* 行的空间交给提交，getline重新分配 */
+		(*subs)[*count].line = line;
+		bat_parse(&(*subs)[*count]);
+		line = NULL;
+		n = 0;
+		if ((*subs)[*count].error == NULL)
+			bat_duplicate(*subs, *count);
+		++*count;
+	}
+
+	fclose(fp);
+	free(line);
+	return 0;
+
+errexit:
+	fclose(fp);
+	free(line);
+	bat_free(*subs, *count);
+	return -1;
+}
+
+/*
+ * 局部函数：bat_parse
+ * 功能：把一行分成编号、basedir和命令，字段以空白分隔，不支持引号
+ * 参数：sub为提交，line已经设置
+ * 返回值：无，格式错误时原因在sub->error中，正确时为NULL
+ * 注意：编号用作临时输出文件名的一部分，不能包含'/'
+ */
+static void
+bat_parse(struct batsub *sub)
+{
+	char *save, *tok;
+	int argc = 0;
+
+	sub->id = strtok_r(sub->line, " \t", &save);
+	sub->basedir = strtok_r(NULL, " \t", &save);
+	while ((tok = strtok_r(NULL, " \t", &save)) != NULL && argc < BAT_ARGS)
+		sub->argv[argc++] = tok;
+	sub->argv[argc] = NULL;
+
+	sub->error = NULL;
+	if (sub->basedir == NULL || argc == 0)
+		sub->error = "**bat_parse** format error.";
+	else if (tok != NULL)
+		sub->error = "**bat_parse** too many arguments.";
+	else if (strchr(sub->id, '/') != NULL)
+		sub->error = "**bat_parse** bad id.";
+}
+
+/*
+ * 局部函数：bat_duplicate
+ * 功能：检查最后一个提交的basedir和编号是否与前面的提交重复
+ * 参数：subs为提交数组，count为前面的提交的个数，subs[count]为要检查的提交
+ * 返回值：无，重复时原因在subs[count].error中
+ * 注意：格式错误的提交没有被评测，不算重复
+ */
+static void
+bat_duplicate(struct batsub *subs, int count)
+{
+	int i;
+
+	for (i = 0; i < count; ++i) {
+		if (subs[i].error == NULL &&
+				strcmp(subs[i].id, subs[count].id) == 0 &&
+				strcmp(subs[i].basedir, subs[count].basedir) == 0) {
+			subs[count].error = "**bat_duplicate** duplicate id.";
+			return;
+		}
+	}
+}
+
+/*
+ * 局部函数：bat_preload
+ * 功能：提示内核预读全部输入和答案文件，之后的评测从页缓存读取
+ * 参数：ds为数据集
+ * 返回值：无
+ * 注意：只是提示，出错被忽略；生成的数据由生成数据的缓存负责
+ */
+static void
+bat_preload(const struct dataset *ds)
+{
+	const char *path;
+	int i, j, fd;
+
+	for (i = 0; i < dd_get_count(ds); ++i) {
+		for (j = 0; j < 2; ++j) {
+			path = j == 0 ? dd_get_input(ds, i) : dd_get_answer(ds, i);
+			if (path[0] == '!' || (fd = open(path, O_RDONLY)) == -1)
+				continue;
+			posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+			close(fd);
+		}
+	}
+}
+
+/*
+ * 局部函数：bat_worker
+ * 功能：工作进程，从父进程领取提交的序号，评测后把结果发回
+ * 参数：cond为公共的评测条件，k为工作进程的序号，sock为与父进程通信的套接字，
+ *   subs为提交数组
+ * 返回值：无，父进程关闭套接字后返回
+ * 注意：有--cpu时第k个工作进程绑定在第cpu+k个CPU上，不区分超线程和杂务核，
+ *   调用者要保证这些编号是各自独立的物理核（见doc/HowTo_batch.txt）；
+ *   结果为exit_format的输出，SOCK_SEQPACKET保留消息边界，一次发送
+ */
+static void
+bat_worker(struct condition *cond, int k, int sock, struct batsub *subs)
+{
+	static struct result res;
+	static char buf[ERR_MSG_MAX + EXTRA_MAX + 128];
+	struct condition c;
+	int index, n;
+
+	for (;;) {
+		n = recv(sock, &index, sizeof(int), 0);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n != sizeof(int))
+			break;
+
+		c = *cond;
+		c.basedir = subs[index].basedir;
+		c.magic = subs[index].id;
+		c.command = subs[index].argv;
+		if (cond->cpu >= 0)
+			c.cpu = cond->cpu + k;
+		moj_judge(&c, &res);
+
+		n = exit_format(&res, buf, sizeof(buf));
+		if (send(sock, buf, n, MSG_NOSIGNAL) != n)
+			break;
+	}
+	close(sock);
+}
+
+/*
+ * 局部函数：bat_fail
+ * 功能：输出一个没有评测的提交的结果
+ * 参数：sub为提交，code为状态，msg为信息
+ * 返回值：无
+ */
+static void
+bat_fail(const struct batsub *sub, enum estatus code, const char *msg)
+{
+	static struct result res;
+	static char buf[ERR_MSG_MAX + EXTRA_MAX + 128];
+
+	exit_init(&res);
+	res.code = code;
+	snprintf(res.msg, ERR_MSG_MAX, "%s", msg);
+	bat_emit(sub, buf, exit_format(&res, buf, sizeof(buf)));
+}
+
+/*
+ * 局部函数：bat_emit
+ * 功能：输出一个提交的结果
+ * 参数：sub为提交，buf和len为与moj相同格式的输出
+ * 返回值：无
+ * 注意：先输出一行"submission <编号> <行数>"，之后是该行数的结果，
+ *   读者不需要理解结果的格式就可以分开各个提交
+ */
+static void
+bat_emit(const struct batsub *sub, const char *buf, int len)
+{
+	int i, lines = 0;
+
+	for (i = 0; i < len; ++i)
+		if (buf[i] == '\n')
+			++lines;
+	printf("submission %s %d\n", sub->id, lines);
+	fwrite(buf, 1, len, stdout);
+	fflush(stdout);
+}
+
+/*
+ * 局部函数：bat_free
+ * 功能：释放提交数组
+ * 参数：subs和count为提交数组和个数
+ * 返回值：无
+ */
+static void
+bat_free(struct batsub *subs, int count)
+{
+	int i;
+
+	for (i = 0; i < count; ++i)
+		free(subs[i].line);
+	free(subs);
+}
@@ -0,0 +1,56 @@
+/***************************************************************
+ * 文件名：batch.h
+ * 模块功能：批量重测，同一个题目的多个提交在一次运行中评测，
+ *   数据集只读取一次，由多个工作进程分担，每个提交输出一个结果
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include "moj.h"
+#include "data.h"
+#include "exit.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+
+#ifndef BATCH_H
+#define BATCH_H
+
+/*
+ * 工作进程的最大个数，一行提交的最大参数个数
+ */
+#define BAT_JOBS_MAX 64
+#define BAT_ARGS 64
+
+/*
+ * 批量评测的参数
+ */
+struct batch
+{
+	const char *list;		/* 提交列表文件，NULL为不是批量模式 */
+	int jobs;				/* 工作进程数，默认1 */
+};
+
+/*
+ * 列表中的一个提交，每行为"<编号> <basedir> <命令>..."
+ */
+struct batsub
+{
+	char *line;				/* 读到的行，各字段指向其中 */
+	const char *id;			/* 编号，同时作为--magic */
+	const char *basedir;
+	char *argv[BAT_ARGS + 1];	/* 命令，以NULL结尾 */
+	const char *error;		/* 格式错误的原因，NULL为正确 */
+};
+
+int bat_run(struct condition *cond, const struct batch *bt, char *errmsg);
+
+#endif
@@ -0,0 +1,292 @@
+/*************************************************
+ * 源文件：cache.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "cache.h"
+
+/*
+ * 局部函数声明
+ */
+static int cache_parse_policy(const char *policy, int *mask, char *errmsg);
+static void cache_path(struct cache *cc, const unsigned char *key,
+		char *path, int subdir);
+
+/*
+ * 接口函数：cache_init
+ * 功能：解析缓存策略，计算用户程序和限制条件的摘要
+ * 参数：cc为待初始化的缓存，dir为缓存目录，policy为可缓存的结果列表，
+ *   如"AC,WA"，为NULL则使用默认值，csin提供命令、限制、比较方式
+ *   和常驻检查程序，应该在启动zygote之后调用，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：命令的每个参数都参与摘要，参数如果是basedir下的普通文件，
+ *   则文件内容也参与摘要，这样相同的可执行文件或脚本得到相同的摘要
+ */
+int
+cache_init(struct cache *cc, const char *dir, const char *policy,
+		const struct casein *csin, char *errmsg)
+{
+	char path[PATH_MAX];
+	char limits[128];
+	unsigned char fhash[HASH_LEN];
+	char * const *arg;
+	struct stat st;
+	struct hashctx ctx;
+
+	cc->dir = dir;
+	if (cache_parse_policy(policy != NULL ? policy : CACHE_DEFAULT_POLICY,
+				&cc->policy, errmsg) != 0)
+		return -1;
+
+	hash_init(&ctx);
+	hash_update(&ctx, CACHE_VERSION, strlen(CACHE_VERSION) + 1);
+
+	for (arg = csin->command; *arg != NULL; ++arg) {
+		hash_update(&ctx, *arg, strlen(*arg) + 1);
+
+		if ((*arg)[0] == '/')
+			snprintf(path, PATH_MAX, "%s", *arg);
+		else
+			snprintf(path, PATH_MAX, "%s/%s", csin->basedir, *arg);
+		if (stat(path, &st) == -1 || !S_ISREG(st.st_mode))
+			continue;
+
+		if (hash_file(path, fhash, errmsg) != 0)
+			return -1;
+		hash_update(&ctx, fhash, HASH_LEN);
+	}
+
+	/* 常驻检查程序也决定结果 */
+	if (csin->checker != NULL) {
+		if (hash_file(csin->checker->path, fhash, errmsg) != 0)
+			return -1;
+		hash_update(&ctx, fhash, HASH_LEN);
+	}
+
+	/* 交互题的交互程序同样决定结果 */
+	if (csin->interactor != NULL) {
+		if (hash_file(csin->interactor, fhash, errmsg) != 0)
+			return -1;
+		hash_update(&ctx, fhash, HASH_LEN);
+	}
+
+	/* 限制条件或者比较方式不同，结果不能复用 */
+	if (csin->compare != NULL)
+		snprintf(limits, sizeof(limits), "%d %d %d %d %.17g %.17g",
+				csin->time, csin->memory, csin->fsize, csin->compare->kind,
+				csin->compare->abseps, csin->compare->releps);
+	else
+		snprintf(limits, sizeof(limits), "%d %d %d",
+				csin->time, csin->memory, csin->fsize);
+	hash_update(&ctx, limits, strlen(limits) + 1);
+
+	/* 扣除的跟踪开销不同，时间也不同 */
+	if (csin->overhead > 0)
+		hash_update(&ctx, &csin->overhead, sizeof(csin->overhead));
+
+	/* 沙箱中可用的文件不同，程序的行为也可能不同 */
+	if (csin->rootfs != NULL)
+		hash_update(&ctx, csin->rootfs, strlen(csin->rootfs) + 1);
+
+	/* cgroup计入派生的进程，并限制进程数和IO */
+	if (csin->cgroup != NULL)
+		hash_update(&ctx, "cgroup", strlen("cgroup") + 1);
+
+	/* zygote模式下解释器的启动不计入时间和内存 */
+	if (csin->zygote != NULL)
+		hash_update(&ctx, "zygote", strlen("zygote") + 1);
+	hash_final(&ctx, cc->prog);
+
+	return 0;
+}
+
+/*
+ * 接口函数：cache_key
+ * 功能：计算一组测试的缓存键
+ * 参数：cc为缓存，ds为数据集，infile和ansfile为输入和答案文件（程序），
+ *   key接收HASH_LEN个字节的键，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ */
+int
+cache_key(struct cache *cc, const struct dataset *ds,
+		const char *infile, const char *ansfile,
+		unsigned char *key, char *errmsg)
+{
+	unsigned char inhash[HASH_LEN], anshash[HASH_LEN];
+	struct hashctx ctx;
+
+	/*
+	 * 仓库中的数据以摘要为文件名，数据目录的清单中也有摘要，不用再读取内容；
+	 * 生成的数据由生成程序和参数决定
+	 */
+	if (src_generated(infile)) {
+		if (src_digest(infile, inhash, errmsg) != 0)
+			return -1;
+	} else if (store_digest(infile, inhash) != 0 &&
+			dd_get_digest(ds, infile, inhash) != 0 &&
+			hash_file(infile, inhash, errmsg) != 0)
+		return -1;
+	if (src_generated(ansfile)) {
+		if (src_digest(ansfile, anshash, errmsg) != 0)
+			return -1;
+	} else if (store_digest(ansfile, anshash) != 0 &&
+			dd_get_digest(ds, ansfile, anshash) != 0 &&
+			hash_file(ansfile, anshash, errmsg) != 0)
+		return -1;
+
+	hash_init(&ctx);
+	hash_update(&ctx, cc->prog, HASH_LEN);
+	hash_update(&ctx, inhash, HASH_LEN);
+	hash_update(&ctx, anshash, HASH_LEN);
+	hash_final(&ctx, key);
+
+	return 0;
+}
+
+/*
+ * 接口函数：cache_lookup
+ * 功能：查找缓存条目
+ * 参数：cc为缓存，key为缓存键，csout接收缓存的结果
+ * 返回值：命中返回1，没有命中返回0
+ * 注意：条目损坏或者结果不在策略之内都视为没有命中
+ */
+int
+cache_lookup(struct cache *cc, const unsigned char *key,
+		struct caseout *csout)
+{
+	int fd, n, code, time, memory, skip;
+	char path[PATH_MAX];
+	char buf[64 + ERR_MSG_MAX];
+
+	cache_path(cc, key, path, 0);
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return 0;
+	n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (n <= 0)
+		return 0;
+	buf[n] = '\0';
+
+	if (sscanf(buf, "%d %d %d\n%n", &code, &time, &memory, &skip) != 3)
+		return 0;
+	if (code < EXIT_AC || code > EXIT_OLE || !(cc->policy & (1 << code)))
+		return 0;
+
+	csout->code = code;
+	csout->time = time;
+	csout->rawtime = time;
+	csout->memory = memory;
+	csout->trace.count = 0;
+	snprintf(csout->msg, ERR_MSG_MAX, "%s", buf + skip);
+	return 1;
+}
+
+/*
+ * 接口函数：cache_store
+ * 功能：按照策略保存一组测试的结果
+ * 参数：cc为缓存，key为缓存键，csout为测试结果
+ * 返回值：无
+ * 注意：先写临时文件再改名，并发的评测不会读到不完整的条目；
+ *   保存失败只是少了一个缓存条目，不影响评测结果；
+ *   RE的出错信息和检查程序给出的PE、WA信息随结果保存，命中时原样输出
+ */
+void
+cache_store(struct cache *cc, const unsigned char *key,
+		const struct caseout *csout)
+{
+	int fd, n;
+	char path[PATH_MAX], tmp[PATH_MAX];
+	char buf[64 + ERR_MSG_MAX];
+
+	if (csout->code < EXIT_AC || csout->code > EXIT_OLE ||
+			!(cc->policy & (1 << csout->code)))
+		return;
+
+	cache_path(cc, key, path, 1);
+	if (mkdir(path, S_IRWXU | S_IRWXG) == -1 && errno != EEXIST)
+		return;
+	cache_path(cc, key, path, 0);
+	snprintf(tmp, PATH_MAX, "%s.%d", path, getpid());
+
+	n = snprintf(buf, sizeof(buf), "%d %d %d\n%s", csout->code,
+			csout->code == EXIT_AC ? csout->time : 0,
+			csout->code == EXIT_AC ? csout->memory : 0,
+			csout->code == EXIT_RE1 || csout->code == EXIT_RE2 ||
+			csout->code == EXIT_PE || csout->code == EXIT_WA ?
+			csout->msg : "");
+
+	if ((fd = open(tmp, O_CREAT | O_WRONLY | O_TRUNC,
+					S_IRUSR | S_IWUSR | S_IRGRP)) == -1)
+		return;
+	if (write(fd, buf, n) != n) {
+		close(fd);
+		unlink(tmp);
+		return;
+	}
+	close(fd);
+
+	if (rename(tmp, path) == -1)
+		unlink(tmp);
+}
+
+/*
+ * 局部函数：cache_parse_policy
+ * 功能：把结果名称列表转换为位掩码
+ * 参数：policy为逗号分隔的列表，RE同时包括两种运行时错误，
+ *   mask接收位掩码，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ */
+static int
+cache_parse_policy(const char *policy, int *mask, char *errmsg)
+{
+	int len;
+	const char *p, *end;
+
+	*mask = 0;
+	for (p = policy; *p != '\0'; p = *end == ',' ? end + 1 : end) {
+		end = strchr(p, ',');
+		if (end == NULL)
+			end = p + strlen(p);
+		len = end - p;
+
+		if (len == 2 && strncmp(p, "AC", 2) == 0)
+			*mask |= 1 << EXIT_AC;
+		else if (len == 2 && strncmp(p, "PE", 2) == 0)
+			*mask |= 1 << EXIT_PE;
+		else if (len == 2 && strncmp(p, "WA", 2) == 0)
+			*mask |= 1 << EXIT_WA;
+		else if (len == 2 && strncmp(p, "RE", 2) == 0)
+			*mask |= 1 << EXIT_RE1 | 1 << EXIT_RE2;
+		else if (len == 3 && strncmp(p, "TLE", 3) == 0)
+			*mask |= 1 << EXIT_TLE;
+		else if (len == 3 && strncmp(p, "MLE", 3) == 0)
+			*mask |= 1 << EXIT_MLE;
+		else if (len == 3 && strncmp(p, "OLE", 3) == 0)
+			*mask |= 1 << EXIT_OLE;
+		else {
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**cache_parse_policy** unknown verdict: %.*s", len, p);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * 局部函数：cache_path
+ * 功能：生成缓存条目的路径，条目按键的前两个十六进制字符分目录存放
+ * 参数：cc为缓存，key为缓存键，path接收路径，subdir为1则只生成子目录
+ * 返回值：无
+ */
+static void
+cache_path(struct cache *cc, const unsigned char *key, char *path, int subdir)
+{
+	char hex[HASH_HEX];
+
+	hash_hex(key, hex);
+	if (subdir)
+		snprintf(path, PATH_MAX, "%s/%.2s", cc->dir, hex);
+	else
+		snprintf(path, PATH_MAX, "%s/%.2s/%s", cc->dir, hex, hex);
+}
@@ -0,0 +1,55 @@
+/***************************************************************
+ * 文件名：cache.h
+ * 模块功能：按用户程序、测试数据和限制条件的摘要缓存单组测试结果，
+ *   重判时命中缓存的测试不再运行用户程序
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include "hash.h"
+#include "store.h"
+#include "data.h"
+#include "case.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef CACHE_H
+#define CACHE_H
+
+/*
+ * 缓存条目格式的版本，改变格式时递增，使旧条目失效
+ */
+#define CACHE_VERSION "moj-cache-2"
+
+/*
+ * 默认可缓存的结果
+ */
+#define CACHE_DEFAULT_POLICY "AC,PE,WA,RE"
+
+/*
+ * 一次评测使用的缓存
+ */
+struct cache
+{
+	const char *dir;				/* 缓存目录 */
+	int policy;						/* 可缓存的结果，按(1 << code)置位 */
+	unsigned char prog[HASH_LEN];	/* 用户程序和限制条件的摘要 */
+};
+
+int cache_init(struct cache *cc, const char *dir, const char *policy,
+		const struct casein *csin, char *errmsg);
+int cache_key(struct cache *cc, const struct dataset *ds,
+		const char *infile, const char *ansfile,
+		unsigned char *key, char *errmsg);
+int cache_lookup(struct cache *cc, const unsigned char *key,
+		struct caseout *csout);
+void cache_store(struct cache *cc, const unsigned char *key,
+		const struct caseout *csout);
+
+#endif
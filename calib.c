@@ -0,0 +1,177 @@
+/*************************************************
+ * 源文件：calib.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "calib.h"
+
+/*
+ * 局部函数声明
+ */
+static int calib_run(int traced, long *usec, long *stops, char *errmsg);
+
+/*
+ * 接口函数：calib_measure
+ * 功能：测量每次系统调用停止给被跟踪进程增加的CPU时间
+ * 参数：overhead接收测量结果，单位纳秒，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：子进程执行CALIB_CALLS次getppid，分别在不被跟踪和被PTRACE_SYSCALL
+ *   跟踪时测量其用户和系统时间，差值除以停止次数；
+ *   各测量CALIB_ROUNDS轮取最小值，减小其他负载的影响
+ */
+int
+calib_measure(long *overhead, char *errmsg)
+{
+	int i;
+	long plain = -1, traced = -1, stops = 0, usec, n;
+
+	for (i = 0; i < CALIB_ROUNDS; ++i) {
+		if (calib_run(0, &usec, &n, errmsg) != 0)
+			return -1;
+		if (plain == -1 || usec < plain)
+			plain = usec;
+
+		if (calib_run(1, &usec, &n, errmsg) != 0)
+			return -1;
+		if (traced == -1 || usec < traced)
+			traced = usec;
+		stops = n;
+	}
+
+	if (stops <= 0) {
+		snprintf(errmsg, ERR_MSG_MAX, "**calib_measure** no syscall stops.");
+		return -1;
+	}
+
+	*overhead = traced > plain ? (traced - plain) * 1000 / stops : 0;
+	return 0;
+}
+
+/*
+ * 接口函数：calib_save
+ * 功能：保存测量结果
+ * 参数：path为校准文件，overhead为每次停止的开销，单位纳秒，
+ *   errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：先写临时文件再改名，并发的评测不会读到不完整的文件
+ */
+int
+calib_save(const char *path, long overhead, char *errmsg)
+{
+	FILE *fp;
+	char tmp[PATH_MAX];
+
+	snprintf(tmp, PATH_MAX, "%s.%d", path, getpid());
+	if ((fp = fopen(tmp, "w")) == NULL) {
+		snprintf(errmsg, ERR_MSG_MAX, "**calib_save** fopen %s error: %s",
+				tmp, strerror(errno));
+		return -1;
+	}
+	fprintf(fp, "%s\n%ld\n", CALIB_VERSION, overhead);
+	if (fclose(fp) == EOF || rename(tmp, path) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**calib_save** write %s error: %s",
+				path, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 接口函数：calib_load
+ * 功能：读取测量结果
+ * 参数：path为校准文件，overhead接收每次停止的开销，单位纳秒，
+ *   errmsg接收错误信息
+ * 返回值：成功返回0，文件不存在或者格式错误返回-1
+ */
+int
+calib_load(const char *path, long *overhead, char *errmsg)
+{
+	FILE *fp;
+	char version[32];
+	int ok;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		snprintf(errmsg, ERR_MSG_MAX, "**calib_load** fopen %s error: %s",
+				path, strerror(errno));
+		return -1;
+	}
+	ok = fscanf(fp, "%31s %ld", version, overhead) == 2 &&
+		strcmp(version, CALIB_VERSION) == 0 && *overhead >= 0;
+	fclose(fp);
+
+	if (!ok) {
+		snprintf(errmsg, ERR_MSG_MAX, "**calib_load** %s: bad format.", path);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：calib_run
+ * 功能：运行一次测量用的子进程
+ * 参数：traced为1则用PTRACE_SYSCALL跟踪子进程，usec接收子进程的用户和
+ *   系统时间之和，单位微秒，stops接收系统调用停止的次数，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ */
+static int
+calib_run(int traced, long *usec, long *stops, char *errmsg)
+{
+	int i, status, sig;
+	struct rusage used;
+	pid_t pid;
+
+	if ((pid = fork()) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**calib_run** fork error: %s", strerror(errno));
+		return -1;
+
+	} else if (pid == 0) {
+		if (traced) {
+			if (ptrace(PTRACE_TRACEME, 0, 0, 0) == -1)
+				_exit(1);
+			raise(SIGSTOP);
+		}
+		for (i = 0; i < CALIB_CALLS; ++i)
+			syscall(SYS_getppid);
+		_exit(0);
+	}
+
+	*stops = 0;
+	if (traced) {
+		/* 子进程先停在SIGSTOP上，之后每次系统调用的进入和退出都停止 */
+		if (waitpid(pid, &status, 0) == -1 || !WIFSTOPPED(status)) {
+			snprintf(errmsg, ERR_MSG_MAX, "**calib_run** child did not stop.");
+			return -1;
+		}
+		ptrace(PTRACE_SYSCALL, pid, 0, 0);
+	}
+
+	while (1) {
+		if (wait4(pid, &status, 0, &used) == -1) {
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**calib_run** wait4 error: %s", strerror(errno));
+			kill(pid, SIGKILL);
+			waitpid(pid, NULL, 0);
+			return -1;
+		}
+		if (!WIFSTOPPED(status))
+			break;
+
+		sig = WSTOPSIG(status);
+		if (sig == SIGTRAP) {
+			++*stops;
+			sig = 0;
+		}
+		ptrace(PTRACE_SYSCALL, pid, 0, sig);
+	}
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		snprintf(errmsg, ERR_MSG_MAX, "**calib_run** child failed.");
+		return -1;
+	}
+
+	*usec = used.ru_utime.tv_sec * 1000000L + used.ru_utime.tv_usec +
+		used.ru_stime.tv_sec * 1000000L + used.ru_stime.tv_usec;
+	return 0;
+}
@@ -0,0 +1,48 @@
+/***************************************************************
+ * 文件名：calib.h
+ * 模块功能：测量本机上每次ptrace停止给被跟踪进程增加的CPU时间，
+ *   评测时按系统调用停止的次数从用户程序的时间中扣除
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+
+#ifndef CALIB_H
+#define CALIB_H
+
+/*
+ * 校准文件格式的版本
+ */
+#define CALIB_VERSION "moj-calib-1"
+
+/*
+ * 测量时子进程执行的系统调用次数和重复的轮数，每轮取最小值
+ */
+#define CALIB_CALLS 100000
+#define CALIB_ROUNDS 3
+
+/*
+ * 扣除开销时，强制的CPU时间限制和墙上时间闹钟放宽的倍数，
+ *   否则系统调用密集的程序在扣除之前就被杀死；
+ *   停止时评测程序本身的开销也计入墙上时间，放宽的幅度要大于CPU时间的开销
+ */
+#define CALIB_SLACK 4
+
+int calib_measure(long *overhead, char *errmsg);
+int calib_save(const char *path, long overhead, char *errmsg);
+int calib_load(const char *path, long *overhead, char *errmsg);
+
+#endif
@@ -1,7 +1,7 @@
 /*************************************************
  * 源文件：case.c
  * 版本：v0.1.0
- * 最后修改：2012-08-14
+ * 最后修改：2026-10-18
  ************************************************/
 #include "case.h"
 
@@ -38,6 +38,8 @@ struct monitorin
 	int lmt_memory;		/* 对用户程序的内存限制 */
 	int lst_time;		/* 子进程总共使用的时间 */
 	int lst_memory;		/* 子进程总共使用的内存 */
+	long long stops;	/* 系统调用停止的次数 */
+	struct sampler *smp;	/* 内存采样器，为NULL则不采样 */
 };
 
 /*
@@ -47,16 +49,43 @@ struct comparein
 {
 	int outfd;				/* 用户程序临时输出文件描述符 */
 	const char *ansfile;	/* 用户程序的答案文件（程序）路径 */
+	const struct cmpmode *mode;	/* 静态答案的比较方式，NULL为严格比较 */
+	int infd;				/* 用户程序输入文件描述符 */
+	int index;				/* 测试序号 */
+	struct checker *checker;	/* 常驻检查程序，NULL为不使用 */
+	int timeout;			/* 答案程序的时间限制，单位毫秒 */
 };
 
 /*
- * 模块全局变量定义
+ * 交互题中与交互程序相关的数据
  */
-static jmp_buf jbuf;
+struct interactin
+{
+	pid_t pid;				/* 交互程序的进程ID */
+	int vfd;				/* 读取交互程序判定结果的管道 */
+	int infd;				/* 用户程序的标准输入，由交互程序写入 */
+	int outfd;				/* 用户程序的标准输出，由交互程序读取 */
+	int timeout;			/* 用户程序结束后等待判定的时间，单位毫秒 */
+};
+
+/*
+ * 没有进程描述符时，等待答案程序的轮询间隔，单位毫秒
+ */
+#define CASE_POLL_SLICE 10
+
+/*
+ * 墙上时间到期之后，超时定时器重复发送信号的间隔，单位毫秒；
+ *   信号在wait4之外到达时会被错过，重复发送保证wait4最终被打断
+ */
+#define CASE_TIMER_SLICE 100
 
 /*
  * 局部函数声明
  */
+static void case_run_child(struct casein *csin, int infd, int outfd,
+		struct caseout *csout);
+static void case_trace_child(struct casein *csin, int infd, int outfd,
+		struct caseout *csout);
 static void case_wait_child(struct waitin *win, struct chdstatus *chds);
 static void case_monitor_child(struct monitorin *min,
 		struct chdstatus *chds);
@@ -67,6 +96,8 @@ static void case_kill_child(pid_t child);
 static int case_vmsize_ok(pid_t child, int memory);
 
 static int case_signal_ok(int signo, enum estatus *code, char *errmsg);
+static int case_start_timer(int lmt_time, timer_t *timer,
+		struct timespec *deadline, char *errmsg);
 static void case_sigalrm_handler(int signo);
 static int case_memory_syscall(int scno);
 
@@ -74,22 +105,86 @@ static void case_compare_static(struct comparein *cin,
 		struct chdstatus *chds);
 static void case_compare_dynamic(struct comparein *cin,
 		struct chdstatus *chds);
-static enum estatus case_compare_string(const char *str1, int len1,
-		const char *str2, int len2);
-static int case_is_nonprint(char c);
+static void case_compare_checker(struct comparein *cin,
+		struct chdstatus *chds);
+static void case_collect_verdict(pid_t pid, int fd, int timeout,
+		const char *what, struct chdstatus *chds);
+
+static int case_start_interactor(struct casein *csin,
+		struct interactin *iin, struct caseout *csout);
+static void case_finish_interactor(struct interactin *iin,
+		struct caseout *csout);
+static int case_pipe_cloexec(int fd[2]);
 
 /*
  * 接口函数：case_run_test
  * 功能：运行一次用户程序，对一组输入进行一次测试
  * 参数：csin, csout见case.h的定义
  * 返回值：无
+ * 注意：交互题的用户程序与交互程序通过两个管道直接相连，
+ *   评测程序不转发数据，最后由交互程序的判定决定结果
  */
 void
 case_run_test(struct casein *csin, struct caseout *csout)
+{
+	struct interactin iin;
+
+	if (csin->interactor == NULL) {
+		case_run_child(csin, csin->infd, csin->outfd, csout);
+		return;
+	}
+
+	if (case_start_interactor(csin, &iin, csout) != 0)
+		return;
+	case_run_child(csin, iin.infd, iin.outfd, csout);
+
+	/* 用户程序已经结束，关闭管道使交互程序读到结束符 */
+	close(iin.infd);
+	close(iin.outfd);
+	case_finish_interactor(&iin, csout);
+}
+
+/*
+ * 局部函数：case_run_child
+ * 功能：运行用户程序并监控，非交互题还要检查输出
+ * 参数：csin, csout见case.h的定义，infd和outfd为用户程序的标准输入输出
+ * 返回值：无
+ * 注意：有cgroup时用户程序在新建的叶子组中运行，结束后杀死组内剩余的进程；
+ *   组内有进程因为内存限制被杀死则结果为MLE
+ */
+static void
+case_run_child(struct casein *csin, int infd, int outfd,
+		struct caseout *csout)
+{
+	if (csin->cgroup == NULL) {
+		case_trace_child(csin, infd, outfd, csout);
+		return;
+	}
+
+	if (cg_create(csin->cgroup, csin->memory, csout->msg) != 0) {
+		csout->code = EXIT_IE;
+		return;
+	}
+	case_trace_child(csin, infd, outfd, csout);
+	if (csout->code != EXIT_IE && cg_oom(csin->cgroup))
+		csout->code = EXIT_MLE;
+	cg_destroy(csin->cgroup);
+}
+
+/*
+ * 局部函数：case_trace_child
+ * 功能：运行并跟踪用户程序，判断时间和内存
+ * 参数：同case_run_child
+ * 返回值：无
+ */
+static void
+case_trace_child(struct casein *csin, int infd, int outfd,
+		struct caseout *csout)
 {
 	pid_t pid;
 	int pfd[2];
 	int used_time;			/* 在该次测试中用户程序使用的时间 */
+	long long deduct;		/* 扣除的系统调用停止开销，单位毫秒 */
 	int used_memory;		/* 在该次测试中用户程序使用的内存 */
 
 	struct childin chdin; 	/* 该结构体是提供给child模块的数据 */
@@ -97,6 +192,9 @@ case_run_test(struct casein *csin, struct caseout *csout)
 	struct monitorin min;
 	struct comparein cin;
 	struct chdstatus chds;
+	struct sampler smp;		/* 内存采样器，需要csin->memtrace */
+
+	csout->trace.count = 0;
 	
 	/* 创建一个和子进程通讯的管道 */
 	if (pipe(pfd) == -1) {
@@ -108,16 +206,37 @@ case_run_test(struct casein *csin, struct caseout *csout)
 	}
 
 	/* 填充chdin结构体，在fork之后马上调用child_run_process */
-	chdin.infd = csin->infd;
-	chdin.outfd = csin->outfd;
+	chdin.infd = infd;
+	chdin.outfd = outfd;
 	chdin.pfd[0] = pfd[0];
 	chdin.pfd[1] = pfd[1];
-	chdin.time = csin->time;
+	chdin.time = csin->overhead > 0 ? csin->time * CALIB_SLACK : csin->time;
 	chdin.fsize = csin->fsize;
 	chdin.basedir = csin->basedir;
 	chdin.command = csin->command;
 	chdin.who = csin->who;
-	if ((pid = fork()) == -1) {
+	chdin.ctlfd = -1;
+	chdin.rootfs = csin->rootfs;
+	chdin.cpu = csin->cpu;
+
+	/*
+	 * zygote模式下由zygote派生用户进程，子进程已经在运行，
+	 * 没有execve之前的阶段，也没有需要扣除的时间和内存
+	 */
+	if (csin->zygote != NULL) {
+		close(pfd[0]);
+		close(pfd[1]);
+		if (zyg_spawn(csin->zygote, infd, outfd, csin->cgroup, &pid,
+					csout->msg) != 0) {
+			csout->code = EXIT_IE;
+			return;
+		}
+		win.pre_time = 0;
+		win.pre_memory = 0;
+		goto monitor;
+	}
+
+	if ((pid = sbx_fork(csin->rootfs)) == -1) {
 		csout->code = EXIT_IE;
 		snprintf(csout->msg, ERR_MSG_MAX,
 				"**case_run_test** fork error: %s",
@@ -141,34 +260,77 @@ case_run_test(struct casein *csin, struct caseout *csout)
 		return;
 	}
 
+	/* 用户程序停在execve之后，移入叶子组，execve之前的使用不计入组内 */
+	if (csin->cgroup != NULL &&
+			cg_attach(csin->cgroup, pid, csout->msg) != 0) {
+		case_kill_child(pid);
+		csout->code = EXIT_IE;
+		return;
+	}
+
+monitor:
+	/* 按需要打开内存采样器，先记录execve之后的第一个点 */
+	min.smp = NULL;
+	if (csin->memtrace > 0) {
+		if (smp_open(&smp, pid, csin->memtrace,
+					&csout->trace, csout->msg) != 0) {
+			case_kill_child(pid);
+			csout->code = EXIT_IE;
+			return;
+		}
+		smp_record(&smp, 1);
+		min.smp = &smp;
+	}
+
 	/* 填充min结构体，调用case_monitor_child */
 	min.child = pid;
-	min.lmt_time = csin->time;
+	min.lmt_time = chdin.time;
 	min.lmt_memory = csin->memory;
+	min.stops = 0;
 	case_monitor_child(&min, &chds);
+	if (min.smp != NULL)
+		smp_close(min.smp);
 	if (chds.code != EXIT_AC) {
 		csout->code = chds.code;
 		memcpy(csout->msg, chds.chdmsg, ERR_MSG_MAX);
 		return;
 	}
 
-	/* 填充cin结构体，调用case_compare_answer */
+	/* 填充cin结构体，调用case_compare_answer；交互题由交互程序判定 */
 	cin.outfd = csin->outfd;
 	cin.ansfile = csin->ansfile;
-	case_compare_answer(&cin, &chds);
+	cin.mode = csin->compare;
+	cin.infd = csin->infd;
+	cin.index = csin->index;
+	cin.checker = csin->checker;
+	cin.timeout = csin->chktime > 0 ? csin->chktime : CHK_DEFAULT_TIME;
+	if (csin->interactor == NULL)
+		case_compare_answer(&cin, &chds);
 	if (chds.code != EXIT_AC) {
 		csout->code = chds.code;
 		memcpy(csout->msg, chds.chdmsg, ERR_MSG_MAX);
 		return;
 	}
 
-	/* 三个流程函数都得到了AC的结果，最后判断是否超时超内存 */
+	/*
+	 * 三个流程函数都得到了AC的结果，最后判断是否超时超内存；
+	 * 有cgroup时计入用户程序派生的进程；
+	 * 有校准结果时扣除系统调用停止带来的开销，用扣除后的时间判断
+	 */
 	used_time = min.lst_time - win.pre_time;
+	used_memory = min.lst_memory - win.pre_memory;
+	if (csin->cgroup != NULL)
+		cg_account(csin->cgroup, &used_time, &used_memory);
+	csout->rawtime = used_time;
+	if (csin->overhead > 0) {
+		/* 32位平台上long只有32位，乘积按long long计算 */
+		deduct = min.stops * csin->overhead / 1000000;
+		used_time = deduct < used_time ? used_time - deduct : 0;
+	}
 	if (used_time > csin->time) {
 		csout->code = EXIT_TLE;
 		return;
 	}
-	used_memory = min.lst_memory - win.pre_memory;
 	if (used_memory > csin->memory) {
 		csout->code = EXIT_MLE;
 		return;
@@ -198,11 +360,14 @@ case_wait_child(struct waitin *win, struct chdstatus *chds)
 
 	close(win->msgfd[1]);
 
-	/* 只等待一次子进程状态，期待是由于execve而被SIGTRAP信号停止 */
-	if (wait3(&status, 0, &used) == -1) {
+	/*
+	 * 只等待一次子进程状态，期待是由于execve而被SIGTRAP信号停止；
+	 * 只等待该子进程，常驻检查程序等其他子进程的状态不会混淆进来
+	 */
+	if (wait4(win->child, &status, 0, &used) == -1) {
 		chds->code = EXIT_IE;
 		snprintf(chds->chdmsg, ERR_MSG_MAX,
-				"**case_wait_child** wait3 error: %s",
+				"**case_wait_child** wait4 error: %s",
 				strerror(errno));
 		case_kill_child(win->child);
 		close(win->msgfd[0]);
@@ -310,43 +475,52 @@ case_monitor_child(struct monitorin *min, struct chdstatus *chds)
 	int status; 					/* 用户进程状态 */
 	int endflag = 1; 				/* 系统调用退出标志，0为进入，1为退出 */
 	int signo;						/* 用户进程收到的信号 */
+	int vmsize;						/* 采样器读取到的虚拟内存 */
+	int vmok;						/* 内存是否在限制之内 */
 	struct rusage used;				/* 用户进程资源使用 */
 	struct user_regs_struct preg;
+	struct timespec deadline, now;	/* 墙上时间的期限 */
+	timer_t timer;					/* 超时定时器，到期时打断wait4 */
 
-	/* 注册闹钟信号和定义超时闹钟，其值比用户设定大2.x秒 */
-	if (signal(SIGALRM, case_sigalrm_handler) == SIG_ERR) {
+	/* 墙上时间的期限比用户设定大2.x秒 */
+	if (case_start_timer(min->lmt_time, &timer, &deadline,
+				chds->chdmsg) != 0) {
+		case_kill_child(min->child);
 		chds->code = EXIT_IE;
-		sprintf(chds->chdmsg,
-				"**case_monitor_child** signal SIGALARM error.");
-		return;
-	}
-
-	if (min->lmt_time % 1000 == 0)
-		alarm(min->lmt_time / 1000 + 2);
-	else
-		alarm(min->lmt_time / 1000 + 3);
-	
-	/* 闹钟信号函数回跳到这里 */
-	if (setjmp(jbuf) != 0) {
-		chds->code = EXIT_TLE;
 		return;
 	}
 
 	/* 循环等待用户进程状态 */
 	while (1) {
-		if (wait3(&status, 0, &used) == -1) {
-			alarm(0);
+		if (wait4(min->child, &status, 0, &used) == -1) {
+			/* 定时器打断了wait4，超时则结束，否则按需要采样后继续等待 */
+			if (errno == EINTR) {
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				if (now.tv_sec > deadline.tv_sec ||
+						(now.tv_sec == deadline.tv_sec &&
+						 now.tv_nsec >= deadline.tv_nsec)) {
+					timer_delete(timer);
+					case_kill_child(min->child);
+					chds->code = EXIT_TLE;
+					return;
+				}
+				if (min->smp != NULL)
+					smp_record(min->smp, 0);
+				continue;
+			}
+
+			timer_delete(timer);
 			case_kill_child(min->child);
 			chds->code = EXIT_IE;
 			snprintf(chds->chdmsg, ERR_MSG_MAX,
-					"**case_monitor_child** wait3 error: %s",
+					"**case_monitor_child** wait4 error: %s",
 					strerror(errno));
 			return;
 		}
 
 		/* 判断用户进程状态 */
 		if (WIFSIGNALED(status)) {
-			alarm(0);
+			timer_delete(timer);
 			chds->code = EXIT_RE2;
 			sprintf(chds->chdmsg,
 					"**case_monitor_child** child killed[1]: signal = %d",
@@ -355,10 +529,11 @@ case_monitor_child(struct monitorin *min, struct chdstatus *chds)
 
 		} else if (WIFSTOPPED(status) && WSTOPSIG(status) == SIGTRAP) { 
 			endflag ^= 1;
+			++min->stops;
 
 			/* 如果是被SIGTRAP信号停止，则获取其系统调用号 */
 			if (ptrace(PTRACE_GETREGS, min->child, NULL, &preg) == -1) {
-				alarm(0);
+				timer_delete(timer);
 				case_kill_child(min->child);
 				chds->code = EXIT_IE;
 				snprintf(chds->chdmsg, ERR_MSG_MAX,
@@ -369,7 +544,7 @@ case_monitor_child(struct monitorin *min, struct chdstatus *chds)
 
 			/* 只在进入系统调用的时候判断是否合法 */
 			if (endflag == 0 && !syscall_is_valid(preg.orig_eax)) {
-				alarm(0);
+				timer_delete(timer);
 				case_kill_child(min->child);
 				chds->code = EXIT_RE2;
 				sprintf(chds->chdmsg,
@@ -378,18 +553,29 @@ case_monitor_child(struct monitorin *min, struct chdstatus *chds)
 				return;
 			}
 
-			/* 如果是系统调用退出并且是内存有关的系统调用 */
-			if (endflag == 1 && case_memory_syscall(preg.orig_eax) &&
-					!case_vmsize_ok(min->child, min->lmt_memory)) {
-				alarm(0);
-				case_kill_child(min->child);
-				chds->code = EXIT_MLE;
-				return;
+			/*
+			 * 如果是系统调用退出并且是内存有关的系统调用，
+			 * 有采样器时顺便记录一个采样点，并复用其读取结果
+			 */
+			if (endflag == 1 && case_memory_syscall(preg.orig_eax)) {
+				if (min->smp != NULL) {
+					vmsize = smp_record(min->smp, 1);
+					vmok = vmsize >= 0 && vmsize <= min->lmt_memory;
+				} else {
+					vmok = case_vmsize_ok(min->child, min->lmt_memory);
+				}
+
+				if (!vmok) {
+					timer_delete(timer);
+					case_kill_child(min->child);
+					chds->code = EXIT_MLE;
+					return;
+				}
 			}
 
 			/* 继续用户进程，无信号传递 */
 			if (ptrace(PTRACE_SYSCALL, min->child, 0, 0) == -1) {
-				alarm(0);
+				timer_delete(timer);
 				case_kill_child(min->child);
 				chds->code = EXIT_IE;
 				snprintf(chds->chdmsg, ERR_MSG_MAX,
@@ -402,14 +588,14 @@ case_monitor_child(struct monitorin *min, struct chdstatus *chds)
 			/* 由信号停止 */
 			signo = WSTOPSIG(status);
 			if (!case_signal_ok(signo, &chds->code, chds->chdmsg)) {
-				alarm(0);
+				timer_delete(timer);
 				case_kill_child(min->child);
 				return;
 			}
 			
 			/* 继续用户进程，同样不传递信号 */
 			if (ptrace(PTRACE_SYSCALL, min->child, 0, 0) == -1) {
-				alarm(0);
+				timer_delete(timer);
 				case_kill_child(min->child);
 				chds->code = EXIT_IE;
 				snprintf(chds->chdmsg, ERR_MSG_MAX,
@@ -420,7 +606,7 @@ case_monitor_child(struct monitorin *min, struct chdstatus *chds)
 
 		} else if (WIFEXITED(status)) {
 			/* 用户进程退出，记录资源使用 */
-			alarm(0);
+			timer_delete(timer);
 			min->lst_time = used.ru_utime.tv_sec * 1000 +
 				used.ru_utime.tv_usec / 1000 +
 				used.ru_stime.tv_sec * 1000 +
@@ -431,7 +617,7 @@ case_monitor_child(struct monitorin *min, struct chdstatus *chds)
 
 		} else {
 			/* 未知的子进程状态 */
-			alarm(0);
+			timer_delete(timer);
 			case_kill_child(min->child);
 			chds->code = EXIT_RE2;
 			sprintf(chds->chdmsg,
@@ -451,8 +637,14 @@ case_monitor_child(struct monitorin *min, struct chdstatus *chds)
 static void 
 case_compare_answer(struct comparein *cin, struct chdstatus *chds)
 {
+	/* 只有检查程序会给出AC，PE，WA的附加信息 */
+	chds->chdmsg[0] = '\0';
+
+	/* 如果有常驻检查程序，则所有的测试都由它检查 */
+	if (cin->checker != NULL)
+		case_compare_checker(cin, chds);
 	/* 如果是答案程序 */
-	if (strcmp(cin->ansfile + strlen(cin->ansfile) - 4, ".exe") == 0)
+	else if (strcmp(cin->ansfile + strlen(cin->ansfile) - 4, ".exe") == 0)
 		case_compare_dynamic(cin, chds);
 	else
 		case_compare_static(cin, chds);
@@ -460,11 +652,12 @@ case_compare_answer(struct comparein *cin, struct chdstatus *chds)
 
 /*
  * 局部函数：case_kill_child
- * 功能：发送SIGKILL信号结束子进程
+ * 功能：发送SIGKILL信号结束子进程，并回收子进程
  * 参数：child为子进程ID
  * 返回值：无
  * 注意：如果setreuid错误，则可能出现严重的后果；
- *   另SIGKILL不会被ptrace跟踪而使子进程暂定
+ *   另SIGKILL不会被ptrace跟踪而使子进程暂定；
+ *   必须回收子进程，否则会留下僵尸进程
  */
 static void
 case_kill_child(pid_t child)
@@ -475,6 +668,7 @@ case_kill_child(pid_t child)
 		kill(child, SIGKILL);
 		setreuid(geteuid(), getuid());
 	}
+	waitpid(child, NULL, 0);
 	return;
 }
 
@@ -531,18 +725,69 @@ case_signal_ok(int signo, enum estatus *code, char *errmsg)
 	return 0;
 }
 
+/*
+ * 局部函数：case_start_timer
+ * 功能：创建超时定时器，墙上时间到期后每CASE_TIMER_SLICE毫秒发送一次SIGALRM
+ * 参数：lmt_time为用户程序的时间限制，timer接收定时器，
+ *   deadline接收到期的时间，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：期限为时间限制向上取整到秒再加2秒；信号处理函数什么也不做，
+ *   不设置SA_RESTART，使得wait4返回EINTR，由调用者比较期限，
+ *   不使用模块全局的跳转点；支持时信号只发给调用的线程
+ */
+static int
+case_start_timer(int lmt_time, timer_t *timer,
+		struct timespec *deadline, char *errmsg)
+{
+	struct sigaction act;
+	struct sigevent sev;
+	struct itimerspec its;
+	int secs = (lmt_time + 999) / 1000 + 2;
+
+	memset(&act, 0, sizeof(act));
+	act.sa_handler = case_sigalrm_handler;
+	sigemptyset(&act.sa_mask);
+	if (sigaction(SIGALRM, &act, NULL) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**case_start_timer** sigaction error: %s", strerror(errno));
+		return -1;
+	}
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_signo = SIGALRM;
+#ifdef SIGEV_THREAD_ID
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev._sigev_un._tid = syscall(SYS_gettid);
+#else
+	sev.sigev_notify = SIGEV_SIGNAL;
+#endif
+	if (timer_create(CLOCK_MONOTONIC, &sev, timer) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**case_start_timer** timer_create error: %s",
+				strerror(errno));
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec += secs;
+	its.it_value.tv_sec = secs;
+	its.it_value.tv_nsec = 0;
+	its.it_interval.tv_sec = 0;
+	its.it_interval.tv_nsec = CASE_TIMER_SLICE * 1000000L;
+	timer_settime(*timer, 0, &its, NULL);
+	return 0;
+}
+
 /*
  * 局部函数：case_sigalrm_handler
- * 功能：闹钟超时信号处理函数，回跳到case_monitor_child函数
+ * 功能：超时定时器的信号处理函数
  * 参数：signo为信号编号
  * 返回值：无
- * 注意：如果不是超时信号，则什么也不做
+ * 注意：什么也不做，其作用只是打断case_monitor_child中阻塞的wait4
  */
 static void
 case_sigalrm_handler(int signo)
 {
-	if (signo == SIGALRM)
-		longjmp(jbuf, 1);
 }
 
 /*
@@ -566,201 +811,242 @@ case_memory_syscall(int scno)
 	}
 }
 
-/*
- * 局部函数：case_compare_string
- * 功能：将两个字符串进行比较，判断是AC，PE还是WA
- * 参数：字符串str1长度为len1，字符串str2长度为len2
- * 返回值：enum estatus（定义在exit.h）中的AC，PE或者WA
- */
-static enum estatus
-case_compare_string(const char *str1, int len1, const char *str2, int len2)
-{
-	int i, j;
-
-	/* 去掉字符串尾部的不可打印字符 */
-	for (i = len1 - 1; i >= 0; --i)
-		if (!case_is_nonprint(str1[i]))
-				break;
-	if (i < 0)
-		return EXIT_WA;
-	else
-		len1 = i + 1;
-
-	for (j = len2 - 1; j >= 0; --j)
-		if (!case_is_nonprint(str2[j]))
-			break;
-	if (j < 0)
-		return EXIT_WA;
-	else
-		len2 = j + 1;
-
-	/* 进行一次整体比较，如果全部相同，则AC */
-	for (i = 0, j = 0; i < len1 && j < len2; ++i, ++j)
-		if (str1[i] != str2[j])
-			break;
-	if (i >= len1 && j >= len2)
-		return EXIT_AC;
-
-	/* 跳过不可打印字符进行一次比较，相同则PE，否则WA */
-	for (i = 0, j = 0; i < len1 && j < len2;) {
-		if (case_is_nonprint(str1[i])) {
-			++i;
-			continue;
-		}
-		if (case_is_nonprint(str2[j])) {
-			++j;
-			continue;
-		}
-
-		if (str1[i] != str2[j])
-			return EXIT_WA;
-		
-		++i;
-		++j;
-	}
-
-	/* 全部比较完才是PE，否则其中之一是子串，WA */
-	if (i >= len1 && j >= len2)
-		return EXIT_PE;
-	
-	return EXIT_WA;
-}
-
-/*
- * 局部函数：case_is_nonprint
- * 功能：判断一个字符是否是可打印字符
- * 参数：c为待判断的字符
- * 返回值：不可打印字符返回1，可打印返回0
- * 注意：仅tab，空格和换行视为不可打印字符
- */
-static int
-case_is_nonprint(char c)
-{
-	if (c == '\n' || c == '\t' || c == ' ')
-		return 1;
-	return 0;
-}
-
 /*
  * 局部函数：case_compare_dynamic
  * 功能：将用户程序的输出作为答案程序的输入，由答案程序判断结果
  * 参数：cin和chds见本文件结构体定义
  * 返回值：无
- * 注意：答案程序只能输出0，1，2分别代表AC，PE和WA；
- *   另外不应该使用标准出错；
+ * 注意：答案程序的输出格式见case_collect_verdict；标准出错被关闭；
  *   该函数是模块流程函数case_compare_answer的分支辅助函数
  */
 static void
 case_compare_dynamic(struct comparein *cin, struct chdstatus *chds)
 {
 	int pfd[2];		/* 用管道重定向答案程序的标准输出 */
-	int status;		/* 答案程序的状态 */
-	int rdcnt;		/* 父进程从管道读取到的字节数 */
 	pid_t pid;		/* 答案程序的进程ID */
-	char ret;		/* 答案程序的输出值 */
+	uid_t uid;
 
 	if (pipe(pfd) == -1) {
 		chds->code = EXIT_IE;
-		sprintf(chds->chdmsg,
+		snprintf(chds->chdmsg, ERR_MSG_MAX,
 				"**case_compare_dynamic** pipe error: %s",
 				strerror(errno));
 		return;
 	}
 
+	/* 答案程序与用户程序共享文件偏移，要从头读取用户程序的输出 */
+	lseek(cin->outfd, 0, SEEK_SET);
+
 	if ((pid = fork()) == -1) {
 		chds->code = EXIT_IE;
 		snprintf(chds->chdmsg, ERR_MSG_MAX,
 				"**case_compare_dynamic** fork error: %s",
 				strerror(errno));
+		close(pfd[0]);
+		close(pfd[1]);
 		return;
 
 	} else if (pid == 0) {
 		close(pfd[0]);
 		close(STDERR_FILENO);
 
-		/* 权限设置，去掉隐含的超级特权，组权限不用改变 */
-		if (setuid(getuid()) == -1) {
+		/* 独立的进程组，超时的时候连同其子进程一起杀掉 */
+		setpgid(0, 0);
+
+		/*
+		 * 权限设置，去掉隐含的超级特权，组权限不用改变；
+		 * 此时实际用户是超级用户，要先换回来再设置三个用户ID
+		 */
+		uid = geteuid();
+		if (setreuid(geteuid(), getuid()) == -1 || setuid(uid) == -1) {
 			write(pfd[1], "3", 1);
-			exit(1);
+			_exit(1);
 		}
 
 		/* 重定向输入和输出，注意不能关闭cin->outfd */
 		if (dup2(cin->outfd, STDIN_FILENO) == -1) {
 			write(pfd[1], "3", 1);
-			exit(1);
+			_exit(1);
 		}
 
 		if (dup2(pfd[1], STDOUT_FILENO) == -1) {
 			write(pfd[1], "3", 1);
-			exit(1);
+			_exit(1);
 		}
 		
 		close(pfd[1]);
 		if (execl(cin->ansfile, cin->ansfile, (char *)0) == -1) {
 			write(STDOUT_FILENO, "3", 1);
-			exit(1);
+			_exit(1);
 		}
 	}
-	
 
-	/* 父进程等待答案进程状态，期待是终止状态 */
+	/* 父进程，一边读取管道一边等待答案程序 */
 	close(pfd[1]);
+	case_collect_verdict(pid, pfd[0], cin->timeout, "answer program", chds);
+	close(pfd[0]);
+	return;
+}
 
-	if (setjmp(jbuf) != 0) {
-		close(pfd[0]);
-		kill(pid, SIGKILL);
-		chds->code = EXIT_EE;
-		sprintf(chds->chdmsg,
-				"**case_compare_dynamic** answer program error: "
-				"output too much");
-		return;
+/*
+ * 局部函数：case_collect_verdict
+ * 功能：读取答案程序或交互程序的判定结果，并回收该程序
+ * 参数：pid为程序的进程ID，fd为读取判定结果的管道，
+ *   timeout为时间限制（毫秒），what为出错信息中的程序名称，
+ *   chds接收结果
+ * 返回值：无
+ * 注意：判定结果的第一个字符只能是0，1，2，分别代表AC，PE和WA，
+ *   其后的内容作为检查信息；输出多少都不会阻塞该程序，超出部分丢弃；
+ *   超时则杀掉该程序所在的进程组并判EE
+ */
+static void
+case_collect_verdict(pid_t pid, int fd, int timeout, const char *what,
+		struct chdstatus *chds)
+{
+	int pidfd;		/* 程序的进程描述符，内核不支持时为-1 */
+	int status;		/* 程序的状态 */
+	int rdcnt;		/* 一次从管道读取到的字节数 */
+	int total = 0;	/* 保存在buf中的字节数 */
+	int done = 0;	/* 程序是否已经回收 */
+	int eof = 0;	/* 管道是否已经读到结束符 */
+	int ms;
+	char buf[ERR_MSG_MAX];	/* 程序的输出，超出部分丢弃 */
+	char tmpbuf[4096];
+	char *msg;
+	struct pollfd fds[2];
+	struct timespec end;
+
+	/* 有进程描述符则可以和管道一起用poll等待 */
+#ifdef SYS_pidfd_open
+	pidfd = syscall(SYS_pidfd_open, pid, 0);
+#else
+	pidfd = -1;
+#endif
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += timeout / 1000;
+	end.tv_nsec += timeout % 1000 * 1000000L;
+	if (end.tv_nsec >= 1000000000L) {
+		end.tv_sec++;
+		end.tv_nsec -= 1000000000L;
 	}
 
-	/* 如果答案程序输出大于管道容量，则wait阻塞，直到闹钟超时 */
-	alarm(5);
-	wait(&status);
-	alarm(0);
-	
-	/* 如果暂停了，则杀掉答案程序 */
-	if (WIFSTOPPED(status))
-		kill(pid, SIGKILL);
+	/* 直到管道结束并且程序终止，或者超时 */
+	fds[0].events = POLLIN;
+	fds[1].events = POLLIN;
+	while (!eof || !done) {
+		if ((ms = chk_remain(&end)) <= 0)
+			break;
 
-	/* 此时答案程序已经终止，如果没有数据，则会遇到结束符 */
-	if ((rdcnt = read(pfd[0], &ret, 1)) != 1) {
-		close(pfd[0]);
+		/* 没有进程描述符时，分段等待以便轮询程序的状态 */
+		if (pidfd == -1 && ms > CASE_POLL_SLICE)
+			ms = CASE_POLL_SLICE;
+		fds[0].fd = eof ? -1 : fd;
+		fds[1].fd = done ? -1 : pidfd;
+		if (poll(fds, 2, ms) == -1 && errno != EINTR) {
+			chds->code = EXIT_IE;
+			snprintf(chds->chdmsg, ERR_MSG_MAX,
+					"**case_collect_verdict** poll error: %s",
+					strerror(errno));
+			break;
+		}
+
+		if (!eof && fds[0].revents != 0) {
+			rdcnt = read(fd, tmpbuf, sizeof(tmpbuf));
+			if (rdcnt > 0 && total < ERR_MSG_MAX - 1) {
+				if (rdcnt > ERR_MSG_MAX - 1 - total)
+					rdcnt = ERR_MSG_MAX - 1 - total;
+				memcpy(buf + total, tmpbuf, rdcnt);
+				total += rdcnt;
+			} else if (rdcnt == 0 || (rdcnt == -1 && errno != EINTR)) {
+				eof = 1;
+			}
+		}
+
+		if (!done && waitpid(pid, &status, WNOHANG) == pid)
+			done = 1;
+	}
+
+	if (pidfd != -1)
+		close(pidfd);
+
+	/* poll出错或者超时，杀掉还没有终止的程序 */
+	if (!eof || !done) {
+		kill(-pid, SIGKILL);
+		if (!done)
+			case_kill_child(pid);
+		if (ms <= 0) {
+			chds->code = EXIT_EE;
+			snprintf(chds->chdmsg, ERR_MSG_MAX,
+					"**case_collect_verdict** %s error: "
+					"timeout after %d ms", what, timeout);
+		}
+		return;
+	}
+
+	if (total == 0) {
 		chds->code = EXIT_EE;
-		sprintf(chds->chdmsg,
-				"**case_compare_dynamic** answer program error: no output");
+		snprintf(chds->chdmsg, ERR_MSG_MAX,
+				"**case_collect_verdict** %s error: no output", what);
 		return;
 	}
 
-	switch (ret) {
+	switch (buf[0]) {
 		case '0' : chds->code = EXIT_AC; break;
 		case '1' : chds->code = EXIT_PE; break;
 		case '2' : chds->code = EXIT_WA; break;
 		case '3' : chds->code = EXIT_IE;
-				   sprintf(chds->chdmsg,
-						   "**case_compare_dynamic** "
-						   "answer program error: before execl");
-				   break;
+				   snprintf(chds->chdmsg, ERR_MSG_MAX,
+						   "**case_collect_verdict** "
+						   "%s error: before execl", what);
+				   return;
 		default : chds->code = EXIT_EE;
-				  sprintf(chds->chdmsg,
-						   "**case_compare_dynamic** "
-						   "answer program error: output unregonisable");
-				  break;
-				
+				  snprintf(chds->chdmsg, ERR_MSG_MAX,
+						   "**case_collect_verdict** "
+						   "%s error: output unregonisable", what);
+				  return;
 	}
-	close(pfd[0]);
+
+	/* 判定字符之后的内容是检查信息，去掉首尾的空白 */
+	buf[total] = '\0';
+	for (msg = buf + 1; isspace((unsigned char)*msg); ++msg)
+		;
+	while (total > msg - buf && isspace((unsigned char)buf[total - 1]))
+		buf[--total] = '\0';
+	strcpy(chds->chdmsg, msg);
 	return;
 }
 
+/*
+ * 局部函数：case_compare_checker
+ * 功能：由常驻检查程序判断用户程序的输出
+ * 参数：cin和chds见本文件结构体定义
+ * 返回值：无
+ * 注意：输入、答案和输出的描述符随请求传给检查程序，
+ *   该函数是模块流程函数case_compare_answer的分支辅助函数
+ */
+static void
+case_compare_checker(struct comparein *cin, struct chdstatus *chds)
+{
+	int ansfd;
+
+	if ((ansfd = src_open(cin->ansfile, chds->chdmsg)) == -1) {
+		chds->code = EXIT_EE;
+		return;
+	}
+
+	chds->code = chk_judge(cin->checker, cin->index,
+			cin->infd, ansfd, cin->outfd, chds->chdmsg);
+	close(ansfd);
+}
+
 /*
  * 局部函数：case_compare_static
  * 功能：用户程序的输出跟静态答案文件进行对比
  * 参数：cin和chds见本文件的结构体定义
  * 返回值：无
  * 注意：该函数是case_compare_answer的分支辅助函数，
- *   调用case_compare_string
+ *   按cin->mode调用compare模块的比较函数
  */
 static void
 case_compare_static(struct comparein *cin, struct chdstatus *chds)
@@ -770,12 +1056,9 @@ case_compare_static(struct comparein *cin, struct chdstatus *chds)
 	char *str1, *str2;
 	struct stat st1, st2;
 
-	/* 打开答案文件错误的话，则只是简单的认为是外部错误 */
-	if ((ansfd = open(cin->ansfile, O_RDONLY)) == -1) {
+	/* 打开答案文件错误的话，则只是简单的认为是外部错误；压缩的答案先解压 */
+	if ((ansfd = src_open(cin->ansfile, chds->chdmsg)) == -1) {
 		chds->code = EXIT_EE;
-		snprintf(chds->chdmsg, ERR_MSG_MAX,
-				"**case_compare_static** open %s error: %s",
-				cin->ansfile, strerror(errno));
 		return;
 	}
 
@@ -785,6 +1068,7 @@ case_compare_static(struct comparein *cin, struct chdstatus *chds)
 		snprintf(chds->chdmsg, ERR_MSG_MAX,
 				"**case_compare_static** stat[1] error: %s",
 				strerror(errno));
+		close(ansfd);
 		return;
 	}
 	if (fstat(ansfd, &st2) == -1) {
@@ -792,18 +1076,21 @@ case_compare_static(struct comparein *cin, struct chdstatus *chds)
 		snprintf(chds->chdmsg, ERR_MSG_MAX,
 				"**case_compare_static** stat[2] error: %s",
 				strerror(errno));
+		close(ansfd);
 		return;
 	}
 
 	/* 检测文件大小，如果用户程序无输出判WA，答案文件空判EE */
 	if (st1.st_size == 0) {
 		chds->code = EXIT_WA;
+		close(ansfd);
 		return;
 	}
 	if (st2.st_size == 0) {
 		chds->code = EXIT_EE;
 		sprintf(chds->chdmsg,
 				"**case_compare_static** no data in %s.", cin->ansfile);
+		close(ansfd);
 		return;
 	}
 
@@ -814,6 +1101,7 @@ case_compare_static(struct comparein *cin, struct chdstatus *chds)
 		snprintf(chds->chdmsg, ERR_MSG_MAX,
 				"**case_compare_static** mmap[1] error: %s",
 				strerror(errno));
+		close(ansfd);
 		return;
 	}
 	str2 = mmap(NULL, st2.st_size, PROT_READ, MAP_PRIVATE, ansfd, 0);
@@ -823,13 +1111,200 @@ case_compare_static(struct comparein *cin, struct chdstatus *chds)
 				"**case_compare_static** mmap[2] error: %s",
 				strerror(errno));
 		munmap(str1, st1.st_size);
+		close(ansfd);
 		return;
 	}
 
-	chds->code = case_compare_string(str1, st1.st_size,
+	/* 映射之后不再需要答案文件描述符 */
+	close(ansfd);
+
+	chds->code = cmp_compare(cin->mode, str1, st1.st_size,
 			str2, st2.st_size);
+	if (chds->code == EXIT_IE)
+		sprintf(chds->chdmsg, "**case_compare_static** compare error.");
 
 	munmap(str1, st1.st_size);
 	munmap(str2, st2.st_size);
 	return;
 }
+
+/*
+ * 局部函数：case_start_interactor
+ * 功能：启动交互程序，创建与用户程序相连的两个管道
+ * 参数：csin见case.h的定义，iin接收交互程序的数据，csout接收错误
+ * 返回值：成功返回0，出错返回-1，错误写入csout
+ * 注意：交互程序的命令行为"交互程序 输入文件 答案文件"，
+ *   压缩的文件以SRC_FD_PATH形式的路径代替，
+ *   标准输入为用户程序的输出，标准输出为用户程序的输入，
+ *   判定结果写到描述符CHK_FD，格式见case_collect_verdict；
+ *   所有管道都带FD_CLOEXEC，两个程序只保留dup2之后的描述符
+ */
+static int
+case_start_interactor(struct casein *csin, struct interactin *iin,
+		struct caseout *csout)
+{
+	int up[2];		/* 用户程序到交互程序 */
+	int down[2];	/* 交互程序到用户程序 */
+	int vp[2];		/* 交互程序的判定结果 */
+	int nullfd, ansfd;
+	uid_t uid;
+	char inpath[PATH_MAX], anspath[PATH_MAX];
+	char errbuf[ERR_MSG_MAX];
+
+	if (case_pipe_cloexec(up) == -1) {
+		csout->code = EXIT_IE;
+		snprintf(csout->msg, ERR_MSG_MAX,
+				"**case_start_interactor** pipe[1] error: %s",
+				strerror(errno));
+		return -1;
+	}
+	if (case_pipe_cloexec(down) == -1) {
+		csout->code = EXIT_IE;
+		snprintf(csout->msg, ERR_MSG_MAX,
+				"**case_start_interactor** pipe[2] error: %s",
+				strerror(errno));
+		close(up[0]);
+		close(up[1]);
+		return -1;
+	}
+	if (case_pipe_cloexec(vp) == -1) {
+		csout->code = EXIT_IE;
+		snprintf(csout->msg, ERR_MSG_MAX,
+				"**case_start_interactor** pipe[3] error: %s",
+				strerror(errno));
+		close(up[0]);
+		close(up[1]);
+		close(down[0]);
+		close(down[1]);
+		return -1;
+	}
+
+	if ((iin->pid = fork()) == -1) {
+		csout->code = EXIT_IE;
+		snprintf(csout->msg, ERR_MSG_MAX,
+				"**case_start_interactor** fork error: %s",
+				strerror(errno));
+		close(up[0]);
+		close(up[1]);
+		close(down[0]);
+		close(down[1]);
+		close(vp[0]);
+		close(vp[1]);
+		return -1;
+
+	} else if (iin->pid == 0) {
+		/* 独立的进程组，超时的时候连同其子进程一起杀掉 */
+		setpgid(0, 0);
+
+		/* 先换回超级用户，再把三个用户ID都设置为评测程序的用户 */
+		uid = geteuid();
+		if (setreuid(geteuid(), getuid()) == -1 || setuid(uid) == -1) {
+			write(vp[1], "3", 1);
+			_exit(1);
+		}
+
+		if (dup2(up[0], STDIN_FILENO) == -1 ||
+				dup2(down[1], STDOUT_FILENO) == -1 ||
+				dup2(vp[1], CHK_FD) == -1) {
+			write(vp[1], "3", 1);
+			_exit(1);
+		}
+
+		/* 标准出错指向/dev/null，交互程序可以随意使用 */
+		if ((nullfd = open("/dev/null", O_WRONLY)) != -1) {
+			dup2(nullfd, STDERR_FILENO);
+			close(nullfd);
+		}
+
+		/* 压缩的和生成的数据以内存文件的描述符代替路径传给交互程序 */
+		snprintf(inpath, PATH_MAX, "%s", csin->infile);
+		if (src_packed(csin->infile) || src_generated(csin->infile)) {
+			fcntl(csin->infd, F_SETFD, 0);
+			snprintf(inpath, PATH_MAX, SRC_FD_PATH, csin->infd);
+		}
+		snprintf(anspath, PATH_MAX, "%s", csin->ansfile);
+		if (src_packed(csin->ansfile) || src_generated(csin->ansfile)) {
+			if ((ansfd = src_open(csin->ansfile, errbuf)) == -1) {
+				write(CHK_FD, "3", 1);
+				_exit(1);
+			}
+			fcntl(ansfd, F_SETFD, 0);
+			snprintf(anspath, PATH_MAX, SRC_FD_PATH, ansfd);
+		}
+
+		execl(csin->interactor, csin->interactor,
+				inpath, anspath, (char *)0);
+		write(CHK_FD, "3", 1);
+		_exit(1);
+	}
+
+	/* 父进程只保留用户程序一端和判定结果的读端 */
+	close(up[0]);
+	close(down[1]);
+	close(vp[1]);
+	iin->infd = down[0];
+	iin->outfd = up[1];
+	iin->vfd = vp[0];
+	iin->timeout = csin->chktime > 0 ? csin->chktime : CHK_DEFAULT_TIME;
+	return 0;
+}
+
+/*
+ * 局部函数：case_finish_interactor
+ * 功能：等待交互程序的判定，与用户程序的结果合并
+ * 参数：iin为交互程序的数据，csout为用户程序的结果，同时接收合并结果
+ * 返回值：无
+ * 注意：优先级从高到低为：评测程序或交互程序的IE和EE，
+ *   用户程序的TLE，MLE和OLE，交互程序的PE和WA，用户程序的RE，AC；
+ *   交互程序提前判定并退出时，用户程序常因写管道出错而RE，
+ *   因此交互程序的PE和WA优先于RE
+ */
+static void
+case_finish_interactor(struct interactin *iin, struct caseout *csout)
+{
+	struct chdstatus chds;
+
+	chds.chdmsg[0] = '\0';
+	case_collect_verdict(iin->pid, iin->vfd, iin->timeout,
+			"interactor", &chds);
+	close(iin->vfd);
+
+	/* 评测程序出错，保留原来的结果 */
+	if (csout->code == EXIT_IE || csout->code == EXIT_EE)
+		return;
+
+	/* 交互程序没有出错，用户程序超限或者交互程序判AC时运行出错 */
+	if (chds.code != EXIT_IE && chds.code != EXIT_EE) {
+		if (csout->code == EXIT_TLE || csout->code == EXIT_MLE ||
+				csout->code == EXIT_OLE)
+			return;
+		if ((csout->code == EXIT_RE1 || csout->code == EXIT_RE2) &&
+				chds.code == EXIT_AC)
+			return;
+	}
+
+	/* 交互程序的判定决定结果，AC时保留用户程序的时间和内存 */
+	csout->code = chds.code;
+	memcpy(csout->msg, chds.chdmsg, ERR_MSG_MAX);
+}
+
+/*
+ * 局部函数：case_pipe_cloexec
+ * 功能：创建管道，两端都设置FD_CLOEXEC
+ * 参数：fd同pipe的参数
+ * 返回值：成功返回0，出错返回-1
+ */
+static int
+case_pipe_cloexec(int fd[2])
+{
+	if (pipe(fd) == -1)
+		return -1;
+
+	if (fcntl(fd[0], F_SETFD, FD_CLOEXEC) == -1 ||
+			fcntl(fd[1], F_SETFD, FD_CLOEXEC) == -1) {
+		close(fd[0]);
+		close(fd[1]);
+		return -1;
+	}
+	return 0;
+}
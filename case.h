@@ -2,22 +2,33 @@
  * 文件名：case.h
  * 模块功能：该模块负责对单组输入数据进行测试，并返回测试结果
  * 版本：v0.1.0
- * 最后修改：2012-08-14
+ * 最后修改：2026-10-18
  *******************************************************************/
 #include "global.h"
 #include "child.h"
 #include "syscall_rule.h"
+#include "sample.h"
+#include "compare.h"
+#include "checker.h"
+#include "zygote.h"
+#include "source.h"
+#include "calib.h"
+#include "cgroup.h"
+#include <ctype.h>
+#include <poll.h>
+#include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
-#include <setjmp.h>
 #include <sys/types.h>
 #include <sys/ptrace.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/user.h>
+#include <sys/wait.h>
 
 #ifndef CASE_H
 #define CASE_H
@@ -36,6 +47,18 @@ struct casein
 	const char *basedir;	/* 用户程序的工作和根目录 */
 	char * const *command;	/* execve的参数 */
 	const char *ansfile;	/* 用户程序答案文件路径 */
+	int memtrace;			/* 内存采样间隔，单位毫秒，0为不采样 */
+	const struct cmpmode *compare;	/* 静态答案的比较方式，NULL为严格比较 */
+	int index;				/* 测试序号，提供给常驻检查程序 */
+	struct checker *checker;	/* 常驻检查程序，NULL为不使用 */
+	int chktime;			/* 答案程序的时间限制，单位毫秒，0为默认 */
+	const char *infile;		/* 用户程序输入文件路径，提供给交互程序 */
+	const char *interactor;	/* 交互程序路径，NULL为非交互题 */
+	struct zygote *zygote;	/* 不为NULL则由zygote派生用户进程，见zygote.h */
+	long overhead;			/* 每次系统调用停止的开销，单位纳秒，0为不扣除 */
+	const char *rootfs;		/* 不为NULL则在命名空间沙箱中运行，见sandbox.h */
+	struct cgroup *cgroup;	/* 不为NULL则每组测试新建叶子组，见cgroup.h */
+	int cpu;				/* 不为-1则把用户进程绑定到该CPU上 */
 };
 
 /*
@@ -46,7 +69,9 @@ struct caseout
 	enum estatus code;		/* 退出代号，定义在exit.h */
 	int time;				/* 单组测试中用户程序使用的时间 */
 	int memory;				/* 单组测试中用户程序使用的内存 */
+	int rawtime;			/* 扣除跟踪开销之前的时间 */
 	char msg[ERR_MSG_MAX];		
+	struct memtrace trace;	/* 内存使用的时间序列，需要csin->memtrace */
 };
 
 void case_run_test(struct casein *csin, struct caseout *csout);
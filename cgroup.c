@@ -0,0 +1,331 @@
+/*************************************************
+ * 源文件：cgroup.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "cgroup.h"
+
+/*
+ * 局部函数声明
+ */
+static int cg_has(const char *list, const char *name);
+static int cg_write(const char *dir, const char *file, const char *value,
+		char *errmsg);
+static int cg_read(const char *dir, const char *file, const char *key,
+		long long *value);
+static void cg_device(struct cgroup *cg, const char *basedir);
+
+/*
+ * 接口函数：cg_init
+ * 功能：检查父组是否可用，确定限制IO的设备
+ * 参数：cg为待初始化的结构体，parent为父组目录，
+ *   basedir为用户程序的工作目录，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：父组必须在cgroup.subtree_control中启用cpu，memory，pids控制器，
+ *   启用了io控制器并且basedir在块设备上时才限制IO
+ */
+int
+cg_init(struct cgroup *cg, const char *parent, const char *basedir,
+		char *errmsg)
+{
+	char path[PATH_MAX], list[256];
+	int fd, n;
+
+	cg->parent = parent;
+	cg->io[0] = '\0';
+	cg->path[0] = '\0';
+	cg->seq = 0;
+
+	snprintf(path, PATH_MAX, "%s/cgroup.subtree_control", parent);
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**cg_init** open %s error: %s",
+				path, strerror(errno));
+		return -1;
+	}
+	n = read(fd, list, sizeof(list) - 1);
+	close(fd);
+	list[n > 0 ? n : 0] = '\0';
+
+	if (!cg_has(list, "cpu") || !cg_has(list, "memory") ||
+			!cg_has(list, "pids")) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**cg_init** %s must enable cpu, memory and pids.", parent);
+		return -1;
+	}
+	if (cg_has(list, "io"))
+		cg_device(cg, basedir);
+
+	return 0;
+}
+
+/*
+ * 接口函数：cg_create
+ * 功能：为一组测试新建叶子组并设置限制
+ * 参数：cg为cgroup，memory为内存限制，单位kb，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：内存达到限制时组内进程全部被杀死，不使用交换分区；
+ *   上次同名的组没有删除时先删除
+ */
+int
+cg_create(struct cgroup *cg, int memory, char *errmsg)
+{
+	char value[128];
+
+	snprintf(cg->path, PATH_MAX, "%s/moj-%d-%d",
+			cg->parent, (int)getpid(), cg->seq++);
+
+	/* 切换到超级用户，注意父进程中是暂时放弃了超级用户权限的 */
+	setreuid(geteuid(), getuid());
+
+	if (mkdir(cg->path, 0755) == -1 &&
+			(errno != EEXIST || rmdir(cg->path) == -1 ||
+			 mkdir(cg->path, 0755) == -1)) {
+		snprintf(errmsg, ERR_MSG_MAX, "**cg_create** mkdir %s error: %s",
+				cg->path, strerror(errno));
+		cg->path[0] = '\0';
+		setreuid(geteuid(), getuid());
+		return -1;
+	}
+
+	snprintf(value, sizeof(value), "%d", CG_PIDS_MAX);
+	if (cg_write(cg->path, "pids.max", value, errmsg) != 0)
+		goto errexit;
+	if (cg_write(cg->path, "cpu.max", CG_CPU_MAX, errmsg) != 0)
+		goto errexit;
+	snprintf(value, sizeof(value), "%lld", (long long)memory * 1024);
+	if (cg_write(cg->path, "memory.max", value, errmsg) != 0)
+		goto errexit;
+	cg_write(cg->path, "memory.swap.max", "0", NULL);
+	cg_write(cg->path, "memory.oom.group", "1", NULL);
+
+	if (cg->io[0] != '\0') {
+		snprintf(value, sizeof(value),
+				"%s rbps=%d wbps=%d riops=%d wiops=%d", cg->io,
+				CG_IO_BPS, CG_IO_BPS, CG_IO_IOPS, CG_IO_IOPS);
+		if (cg_write(cg->path, "io.max", value, errmsg) != 0)
+			goto errexit;
+	}
+
+	setreuid(geteuid(), getuid());
+	return 0;
+
+errexit:
+	rmdir(cg->path);
+	cg->path[0] = '\0';
+	setreuid(geteuid(), getuid());
+	return -1;
+}
+
+/*
+ * 接口函数：cg_attach
+ * 功能：把进程移入当前的叶子组
+ * 参数：cg为cgroup，pid为进程ID，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：在用户程序停止时调用，之后派生的进程都在组内
+ */
+int
+cg_attach(struct cgroup *cg, pid_t pid, char *errmsg)
+{
+	char value[32];
+	int ret;
+
+	snprintf(value, sizeof(value), "%d", (int)pid);
+	setreuid(geteuid(), getuid());
+	ret = cg_write(cg->path, "cgroup.procs", value, errmsg);
+	setreuid(geteuid(), getuid());
+	return ret;
+}
+
+/*
+ * 接口函数：cg_account
+ * 功能：按组内全部进程的资源使用修正用户程序的时间和内存
+ * 参数：cg为cgroup，time和memory为由rusage得到的时间（毫秒）和内存（kb），
+ *   组内的使用更大时替换
+ * 返回值：无
+ * 注意：时间取cpu.stat的usage_usec；内存取memory.peak减去memory.stat中
+ *   仍然计入组内的文件页（页缓存和tmpfs），与跟踪得到的内存一样
+ *   只统计进程本身的内存，写大文件的程序不会因为页缓存而内存偏大
+ */
+void
+cg_account(struct cgroup *cg, int *time, int *memory)
+{
+	long long value, file;
+
+	if (cg_read(cg->path, "cpu.stat", "usage_usec", &value) == 0 &&
+			value / 1000 > *time)
+		*time = value / 1000;
+	if (cg_read(cg->path, "memory.peak", NULL, &value) == 0) {
+		if (cg_read(cg->path, "memory.stat", "file", &file) == 0)
+			value = file < value ? value - file : 0;
+		if (value / 1024 > *memory)
+			*memory = value / 1024;
+	}
+}
+
+/*
+ * 接口函数：cg_oom
+ * 功能：判断叶子组中是否有进程因为内存限制被杀死
+ * 参数：cg为cgroup
+ * 返回值：有返回1，没有返回0
+ */
+int
+cg_oom(struct cgroup *cg)
+{
+	long long value;
+
+	return cg_read(cg->path, "memory.events", "oom_kill", &value) == 0 &&
+		value > 0;
+}
+
+/*
+ * 接口函数：cg_destroy
+ * 功能：杀死叶子组中剩余的进程并删除该组
+ * 参数：cg为cgroup
+ * 返回值：无
+ * 注意：cgroup.kill一次杀死组内全部进程，用户程序派生的进程无法逃脱；
+ *   等待CG_KILL_WAIT毫秒后仍有进程则不删除
+ */
+void
+cg_destroy(struct cgroup *cg)
+{
+	long long populated = 1;
+	int i;
+
+	if (cg->path[0] == '\0')
+		return;
+
+	setreuid(geteuid(), getuid());
+	cg_write(cg->path, "cgroup.kill", "1", NULL);
+	for (i = 0; i < CG_KILL_WAIT; ++i) {
+		if (cg_read(cg->path, "cgroup.events", "populated",
+					&populated) != 0 || populated == 0)
+			break;
+		poll(NULL, 0, 1);
+	}
+	rmdir(cg->path);
+	setreuid(geteuid(), getuid());
+
+	cg->path[0] = '\0';
+}
+
+/*
+ * 局部函数：cg_has
+ * 功能：判断以空白分隔的控制器列表中是否有指定的控制器
+ * 参数：list为控制器列表，name为控制器名称
+ * 返回值：有返回1，没有返回0
+ */
+static int
+cg_has(const char *list, const char *name)
+{
+	const char *p;
+	size_t len = strlen(name);
+
+	for (p = strstr(list, name); p != NULL; p = strstr(p + 1, name))
+		if ((p == list || p[-1] == ' ') &&
+				(p[len] == '\0' || p[len] == ' ' || p[len] == '\n'))
+			return 1;
+	return 0;
+}
+
+/*
+ * 局部函数：cg_write
+ * 功能：写组中的一个接口文件
+ * 参数：dir为组目录，file为接口文件，value为写入的值，
+ *   errmsg接收错误信息，为NULL则忽略错误
+ * 返回值：成功返回0，出错返回-1
+ */
+static int
+cg_write(const char *dir, const char *file, const char *value,
+		char *errmsg)
+{
+	char path[PATH_MAX];
+	int fd;
+
+	snprintf(path, PATH_MAX, "%s/%s", dir, file);
+	if ((fd = open(path, O_WRONLY)) == -1 ||
+			write(fd, value, strlen(value)) != (ssize_t)strlen(value)) {
+		if (errmsg != NULL)
+			snprintf(errmsg, ERR_MSG_MAX, "**cg_write** %s error: %s",
+					path, strerror(errno));
+		if (fd != -1)
+			close(fd);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
+
+/*
+ * 局部函数：cg_read
+ * 功能：读组中的一个接口文件的数值
+ * 参数：dir为组目录，file为接口文件，key为"键 值"格式中的键，
+ *   为NULL则读取第一个数值，value接收数值
+ * 返回值：成功返回0，出错返回-1
+ */
+static int
+cg_read(const char *dir, const char *file, const char *key,
+		long long *value)
+{
+	char path[PATH_MAX], buf[1024], *p;
+	size_t len;
+	int fd, n;
+
+	snprintf(path, PATH_MAX, "%s/%s", dir, file);
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return -1;
+	n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (n <= 0)
+		return -1;
+	buf[n] = '\0';
+
+	if (key == NULL)
+		return sscanf(buf, "%lld", value) == 1 ? 0 : -1;
+
+	len = strlen(key);
+	for (p = buf; p != NULL && *p != '\0'; p = strchr(p, '\n')) {
+		if (*p == '\n')
+			++p;
+		if (strncmp(p, key, len) == 0 && p[len] == ' ')
+			return sscanf(p + len, "%lld", value) == 1 ? 0 : -1;
+	}
+	return -1;
+}
+
+/*
+ * 局部函数：cg_device
+ * 功能：确定basedir所在的磁盘，填写cg->io
+ * 参数：cg为cgroup，basedir为用户程序的工作目录
+ * 返回值：无
+ * 注意：io.max只接受整个磁盘，分区要换成所在的磁盘；
+ *   不在块设备上（如tmpfs）则不限制IO
+ */
+static void
+cg_device(struct cgroup *cg, const char *basedir)
+{
+	char path[PATH_MAX], dev[32];
+	struct stat st;
+	int fd, n;
+
+	if (stat(basedir, &st) == -1)
+		return;
+
+	snprintf(path, PATH_MAX, "/sys/dev/block/%u:%u/partition",
+			major(st.st_dev), minor(st.st_dev));
+	if (access(path, F_OK) == 0)
+		snprintf(path, PATH_MAX, "/sys/dev/block/%u:%u/../dev",
+				major(st.st_dev), minor(st.st_dev));
+	else
+		snprintf(path, PATH_MAX, "/sys/dev/block/%u:%u/dev",
+				major(st.st_dev), minor(st.st_dev));
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return;
+	n = read(fd, dev, sizeof(dev) - 1);
+	close(fd);
+	if (n <= 0)
+		return;
+	dev[n] = '\0';
+	dev[strcspn(dev, "\n")] = '\0';
+	snprintf(cg->io, sizeof(cg->io), "%s", dev);
+}
@@ -0,0 +1,55 @@
+/***************************************************************
+ * 文件名：cgroup.h
+ * 模块功能：每组测试在一个cgroup v2的叶子组中运行用户程序，
+ *   限制进程数、CPU、内存和磁盘IO，统计组内全部进程的资源使用
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#ifndef CGROUP_H
+#define CGROUP_H
+
+/*
+ * 叶子组的限制：进程数，CPU带宽（最多一个CPU），磁盘IO的带宽和次数
+ */
+#define CG_PIDS_MAX 32
+#define CG_CPU_MAX "100000 100000"
+#define CG_IO_BPS 33554432
+#define CG_IO_IOPS 1000
+
+/*
+ * 结束叶子组时等待其中的进程全部退出的时间，单位毫秒
+ */
+#define CG_KILL_WAIT 1000
+
+/*
+ * 评测期间使用的cgroup，由cg_init初始化
+ */
+struct cgroup
+{
+	const char *parent;		/* 父组目录，已经启用cpu，memory，pids控制器 */
+	char io[32];			/* basedir所在磁盘的设备号，空串为不限制IO */
+	char path[PATH_MAX];	/* 当前测试的叶子组，空串为没有 */
+	int seq;				/* 叶子组的序号 */
+};
+
+int cg_init(struct cgroup *cg, const char *parent, const char *basedir,
+		char *errmsg);
+int cg_create(struct cgroup *cg, int memory, char *errmsg);
+int cg_attach(struct cgroup *cg, pid_t pid, char *errmsg);
+void cg_account(struct cgroup *cg, int *time, int *memory);
+int cg_oom(struct cgroup *cg);
+void cg_destroy(struct cgroup *cg);
+
+#endif
@@ -0,0 +1,319 @@
+/*************************************************
+ * 源文件：checker.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "checker.h"
+
+/*
+ * 局部函数声明
+ */
+static int chk_send(struct checker *chk, const char *buf, int len,
+		int *fds, int nfds);
+static int chk_recv(struct checker *chk, char *buf, int size);
+static int chk_poll_recv(int fd, char *buf, int len, struct timespec *end);
+static void chk_kill(struct checker *chk);
+
+/*
+ * 接口函数：chk_start
+ * 功能：启动常驻的检查程序
+ * 参数：chk为待初始化的结构，path为检查程序路径，
+ *   timeout为单次检查的时间限制（毫秒），errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：检查程序以评测程序的实际用户身份运行，没有超级权限；
+ *   套接字在检查程序中为描述符CHK_FD，标准输入输出和出错都是/dev/null，
+ *   协议见doc/HowTo_checker.txt
+ */
+int
+chk_start(struct checker *chk, const char *path, int timeout, char *errmsg)
+{
+	int sv[2], nullfd;
+	uid_t uid;
+
+	chk->pid = -1;
+	chk->path = path;
+	chk->timeout = timeout > 0 ? timeout : CHK_DEFAULT_TIME;
+
+	/* 套接字不能被之后派生的用户程序继承 */
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**chk_start** socketpair error: %s", strerror(errno));
+		return -1;
+	}
+
+	if ((chk->pid = fork()) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**chk_start** fork error: %s", strerror(errno));
+		close(sv[0]);
+		close(sv[1]);
+		return -1;
+
+	} else if (chk->pid == 0) {
+		close(sv[0]);
+
+		/* 先换回超级用户，再把三个用户ID都设置为评测程序的用户 */
+		uid = geteuid();
+		if (setreuid(geteuid(), getuid()) == -1 || setuid(uid) == -1)
+			_exit(1);
+
+		/* dup2得到的描述符没有FD_CLOEXEC，已经是CHK_FD时要清除 */
+		if (sv[1] == CHK_FD) {
+			if (fcntl(CHK_FD, F_SETFD, 0) == -1)
+				_exit(1);
+		} else {
+			if (dup2(sv[1], CHK_FD) == -1)
+				_exit(1);
+			close(sv[1]);
+		}
+		/* 标准输出是评测结果的通道，检查程序的输出全部丢弃 */
+		if ((nullfd = open("/dev/null", O_RDWR)) == -1 ||
+				dup2(nullfd, STDIN_FILENO) == -1 ||
+				dup2(nullfd, STDOUT_FILENO) == -1 ||
+				dup2(nullfd, STDERR_FILENO) == -1)
+			_exit(1);
+		if (nullfd > STDERR_FILENO)
+			close(nullfd);
+
+		execl(path, path, (char *)0);
+		_exit(1);
+	}
+
+	close(sv[1]);
+	chk->sock = sv[0];
+	return 0;
+}
+
+/*
+ * 接口函数：chk_judge
+ * 功能：请求检查程序检查一组测试的输出
+ * 参数：chk为检查程序，index为测试序号，infd, ansfd, outfd为输入、
+ *   答案和用户输出的描述符，随请求一起传递给检查程序，msg接收检查信息
+ * 返回值：enum estatus中的AC，PE，WA，检查程序出错为EXIT_EE
+ * 注意：检查程序出错或超时后被杀掉，下一次请求时重新启动
+ */
+enum estatus
+chk_judge(struct checker *chk, int index, int infd, int ansfd, int outfd,
+		char *msg)
+{
+	int n, fds[3];
+	char buf[ERR_MSG_MAX];
+
+	msg[0] = '\0';
+	if (chk->pid == -1 && chk_start(chk, chk->path, chk->timeout, msg) != 0)
+		return EXIT_IE;
+
+	/* 三个描述符都从头开始读 */
+	lseek(infd, 0, SEEK_SET);
+	lseek(ansfd, 0, SEEK_SET);
+	lseek(outfd, 0, SEEK_SET);
+	fds[0] = infd;
+	fds[1] = ansfd;
+	fds[2] = outfd;
+
+	n = snprintf(buf, sizeof(buf), "case %d\n", index);
+	if (chk_send(chk, buf, n, fds, 3) != 0) {
+		snprintf(msg, ERR_MSG_MAX,
+				"**chk_judge** send to %s error: %s",
+				chk->path, strerror(errno));
+		chk_kill(chk);
+		return EXIT_EE;
+	}
+
+	if ((n = chk_recv(chk, buf, sizeof(buf) - 1)) <= 0) {
+		snprintf(msg, ERR_MSG_MAX, "**chk_judge** checker %s %s",
+				chk->path, n == 0 ? "timeout" : "exited");
+		chk_kill(chk);
+		return EXIT_EE;
+	}
+	buf[n] = '\0';
+
+	/* 应答的第一个字符是结果，其后是可选的检查信息 */
+	snprintf(msg, ERR_MSG_MAX, "%s", buf[1] == ' ' ? buf + 2 : buf + 1);
+	switch (buf[0]) {
+		case '0' : return EXIT_AC;
+		case '1' : return EXIT_PE;
+		case '2' : return EXIT_WA;
+		default :
+			snprintf(msg, ERR_MSG_MAX,
+					"**chk_judge** checker %s output unrecognisable",
+					chk->path);
+			return EXIT_EE;
+	}
+}
+
+/*
+ * 接口函数：chk_stop
+ * 功能：关闭套接字，通知检查程序退出，等待一个请求时限后强制结束
+ * 参数：chk为检查程序
+ * 返回值：无
+ */
+void
+chk_stop(struct checker *chk)
+{
+	int i;
+
+	if (chk->pid == -1)
+		return;
+
+	close(chk->sock);
+	for (i = 0; i < chk->timeout / 10; ++i) {
+		if (waitpid(chk->pid, NULL, WNOHANG) != 0) {
+			chk->pid = -1;
+			return;
+		}
+		usleep(10000);
+	}
+	kill(chk->pid, SIGKILL);
+	waitpid(chk->pid, NULL, 0);
+	chk->pid = -1;
+}
+
+/*
+ * 接口函数：chk_remain
+ * 功能：计算距离截止时间的毫秒数
+ * 参数：end为CLOCK_MONOTONIC的截止时间
+ * 返回值：剩余毫秒数，已过截止时间返回0
+ * 注意：case模块等待检查程序时也使用
+ */
+int
+chk_remain(const struct timespec *end)
+{
+	long ms;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (end->tv_sec - now.tv_sec) * 1000 +
+		(end->tv_nsec - now.tv_nsec) / 1000000;
+	return ms > 0 ? ms : 0;
+}
+
+/*
+ * 局部函数：chk_send
+ * 功能：发送一帧请求，附带描述符
+ * 参数：chk为检查程序，buf和len为请求内容，fds和nfds为附带的描述符
+ * 返回值：成功返回0，出错返回-1
+ * 注意：帧为4字节网络字节序的长度加内容，描述符附在整个帧上；
+ *   使用MSG_NOSIGNAL，检查程序退出时不会收到SIGPIPE
+ */
+static int
+chk_send(struct checker *chk, const char *buf, int len, int *fds, int nfds)
+{
+	char frame[4 + ERR_MSG_MAX];
+	char ctrl[CMSG_SPACE(sizeof(int) * 3)];
+	struct iovec iov;
+	struct msghdr mh;
+	struct cmsghdr *cm;
+
+	frame[0] = len >> 24;
+	frame[1] = len >> 16;
+	frame[2] = len >> 8;
+	frame[3] = len;
+	memcpy(frame + 4, buf, len);
+
+	iov.iov_base = frame;
+	iov.iov_len = len + 4;
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_control = ctrl;
+	mh.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+
+	cm = CMSG_FIRSTHDR(&mh);
+	cm->cmsg_level = SOL_SOCKET;
+	cm->cmsg_type = SCM_RIGHTS;
+	cm->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+	memcpy(CMSG_DATA(cm), fds, sizeof(int) * nfds);
+
+	if (sendmsg(chk->sock, &mh, MSG_NOSIGNAL) != len + 4)
+		return -1;
+	return 0;
+}
+
+/*
+ * 局部函数：chk_recv
+ * 功能：在时间限制内接收一帧应答
+ * 参数：chk为检查程序，buf和size为接收缓冲区
+ * 返回值：返回应答内容的长度，超时返回0，出错或检查程序退出返回-1
+ * 注意：超出缓冲区的内容被截断
+ */
+static int
+chk_recv(struct checker *chk, char *buf, int size)
+{
+	int n, len;
+	unsigned char hdr[4];
+	char frame[4 + ERR_MSG_MAX];
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += chk->timeout / 1000;
+	end.tv_nsec += chk->timeout % 1000 * 1000000L;
+	if (end.tv_nsec >= 1000000000L) {
+		++end.tv_sec;
+		end.tv_nsec -= 1000000000L;
+	}
+
+	/* SOCK_SEQPACKET保留消息边界，一次读取整帧 */
+	if ((n = chk_poll_recv(chk->sock, frame, sizeof(frame), &end)) <= 0)
+		return n;
+	if (n < 4)
+		return -1;
+
+	memcpy(hdr, frame, 4);
+	len = hdr[0] << 24 | hdr[1] << 16 | hdr[2] << 8 | hdr[3];
+	if (len < 1 || len > n - 4)
+		return -1;
+	if (len > size)
+		len = size;
+	memcpy(buf, frame + 4, len);
+	return len;
+}
+
+/*
+ * 局部函数：chk_poll_recv
+ * 功能：用poll等待数据，直到截止时间，再接收一个消息
+ * 参数：fd为描述符，buf和len为缓冲区，end为截止时间
+ * 返回值：读到的字节数，超时返回0，出错或对端关闭返回-1
+ */
+static int
+chk_poll_recv(int fd, char *buf, int len, struct timespec *end)
+{
+	int n, ms;
+	struct pollfd pfd;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (1) {
+		if ((ms = chk_remain(end)) <= 0)
+			return 0;
+		n = poll(&pfd, 1, ms);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			return -1;
+		if (n == 0)
+			return 0;
+
+		n = recv(fd, buf, len, 0);
+		if (n == -1 && errno == EINTR)
+			continue;
+		return n > 0 ? n : -1;
+	}
+}
+
+/*
+ * 局部函数：chk_kill
+ * 功能：强制结束检查程序
+ * 参数：chk为检查程序
+ * 返回值：无
+ */
+static void
+chk_kill(struct checker *chk)
+{
+	if (chk->pid == -1)
+		return;
+
+	close(chk->sock);
+	kill(chk->pid, SIGKILL);
+	waitpid(chk->pid, NULL, 0);
+	chk->pid = -1;
+}
@@ -0,0 +1,55 @@
+/***************************************************************
+ * 文件名：checker.h
+ * 模块功能：管理常驻的答案检查程序，每次评测只启动一次，
+ *   通过分帧的请求/应答协议检查每组测试的输出
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifndef CHECKER_H
+#define CHECKER_H
+
+/*
+ * 检查程序使用的控制描述符
+ */
+#define CHK_FD 3
+
+/*
+ * 默认的单次检查时间限制，单位毫秒
+ */
+#define CHK_DEFAULT_TIME 5000
+
+/*
+ * 常驻的检查程序
+ */
+struct checker
+{
+	pid_t pid;				/* 检查程序的进程ID，-1为没有运行 */
+	int sock;				/* 与检查程序通讯的套接字 */
+	const char *path;		/* 检查程序路径 */
+	int timeout;			/* 单次检查的时间限制，单位毫秒 */
+};
+
+int chk_start(struct checker *chk, const char *path, int timeout,
+		char *errmsg);
+enum estatus chk_judge(struct checker *chk, int index,
+		int infd, int ansfd, int outfd, char *msg);
+void chk_stop(struct checker *chk);
+int chk_remain(const struct timespec *end);
+
+#endif
@@ -1,7 +1,7 @@
 /*************************************************
  * 源文件：child.c
  * 版本：v0.1.0
- * 最后修改：2012-08-18
+ * 最后修改：2026-10-18
  ************************************************/
 #include "child.h"
 
@@ -9,9 +9,11 @@
  * 局部函数声明
  */
 static int child_redirect_io(int infd, int outfd, char *errmsg);
-static int child_set_directory(const char *basedir, char *errmsg);
+static int child_set_directory(const char *basedir, const char *rootfs,
+		char *errmsg);
 static int child_set_rlimit(int time, int fsize, char *errmsg);
 static int child_set_permission(int who, char *errmsg);
+static int child_set_affinity(int cpu, char *errmsg);
 
 /*
  * 接口函数：child_run_process
@@ -33,10 +35,26 @@ child_run_process(struct childin *chd)
 	/* 调用下面四个函数对子进程进行相应设置 */
 	if (child_redirect_io(chd->infd, chd->outfd, errmsg) != 0)
 		goto errexit;
-	if (child_set_directory(chd->basedir, errmsg) != 0) 
+
+	/* 控制描述符放到固定的位置，报错的管道不能被覆盖 */
+	if (chd->ctlfd != -1) {
+		if (chd->pfd[1] == CHILD_CTL_FD)
+			chd->pfd[1] = dup(CHILD_CTL_FD);
+		if (dup2(chd->ctlfd, CHILD_CTL_FD) == -1) {
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**child_run_process** dup2 error: %s",
+					strerror(errno));
+			goto errexit;
+		}
+		if (chd->ctlfd != CHILD_CTL_FD)
+			close(chd->ctlfd);
+	}
+	if (child_set_directory(chd->basedir, chd->rootfs, errmsg) != 0)
 		goto errexit;
 	if (child_set_rlimit(chd->time, chd->fsize, errmsg) != 0)
 		goto errexit;
+	if (chd->cpu != -1 && child_set_affinity(chd->cpu, errmsg) != 0)
+		goto errexit;
 	if (child_set_permission(chd->who, errmsg) != 0)
 		goto errexit;
 
@@ -52,12 +70,12 @@ child_run_process(struct childin *chd)
 	
 	/* 执行用户程序，函数返回则代表出错 */
 	execvp(chd->command[0], chd->command);
-	exit(2);
+	_exit(2);
 
 errexit:
 	write(chd->pfd[1], errmsg, strlen(errmsg));
 	close(chd->pfd[1]);
-	exit(1);
+	_exit(1);
 }
 
 /*
@@ -93,12 +111,17 @@ child_redirect_io(int infd, int outfd, char *errmsg)
 /*
  * 局部函数：child_set_directory
  * 功能：设置子进程的工作目录和根目录
- * 参数：basedir即是工作目录也是跟目录，errmsg接收错误信息
+ * 参数：basedir为工作目录，rootfs不为NULL时为根目录，
+ *   此时basedir在根目录中的位置是SBX_BOX，errmsg接收错误信息
  * 返回值：成功返回0，错误返回-1，错误信息写道errmsg
+ * 注意：使用rootfs时子进程必须由sbx_fork创建
  */
 static int
-child_set_directory(const char *basedir, char *errmsg)
+child_set_directory(const char *basedir, const char *rootfs, char *errmsg)
 {
+	if (rootfs != NULL)
+		return sbx_enter(rootfs, basedir, errmsg);
+
 	if (chdir(basedir) == -1) {
 		snprintf(errmsg, ERR_MSG_MAX,
 				"**child_set_directory** chdir error: %s",
@@ -106,36 +129,6 @@ child_set_directory(const char *basedir, char *errmsg)
 		return -1;
 	}
 
-	/* 切换到超级用户，注意父进程中是暂时放弃了超级用户权限的 */
-	/*
-	if (setreuid(geteuid(), getuid()) == -1) {
-		snprintf(errmsg, ERR_MSG_MAX,
-				"**child_set_directory** setreuid[1] error: %s",
-				strerror(errno));
-		return -1;
-	}
-	*/
-
-	/* chroot需要超级权限 */
-	/*
-	if (chroot(basedir) == -1) {
-		snprintf(errmsg, ERR_MSG_MAX,
-				"**child_set_directory** chroot error: %s",
-				strerror(errno));
-		return -1;
-	}
-	*/
-
-	/* 切换回到普通用户 */
-	/*
-	if (setreuid(geteuid(), getuid()) == -1) {
-		snprintf(errmsg, ERR_MSG_MAX,
-				"**child_set_directory** setreuid[2] error: %s",
-				strerror(errno));
-		return -1;
-	}
-	*/
-
 	return 0;
 }
 
@@ -220,3 +213,33 @@ child_set_permission(int who, char *errmsg)
 
 	return 0;
 }
+
+/*
+ * 局部函数：child_set_affinity
+ * 功能：把子进程绑定到一个CPU上，不受其他评测和检查程序的干扰
+ * 参数：cpu为CPU编号，errmsg接收错误信息
+ * 返回值：成功返回0，错误返回-1，错误写到errmsg
+ */
+static int
+child_set_affinity(int cpu, char *errmsg)
+{
+	unsigned long mask[CHILD_CPU_MAX / (8 * sizeof(unsigned long))];
+	int bits = 8 * sizeof(unsigned long);
+
+	if (cpu < 0 || cpu >= CHILD_CPU_MAX) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**child_set_affinity** bad cpu %d", cpu);
+		return -1;
+	}
+
+	memset(mask, 0, sizeof(mask));
+	mask[cpu / bits] |= 1UL << (cpu % bits);
+	if (syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**child_set_affinity** sched_setaffinity error: %s",
+				strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
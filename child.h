@@ -2,9 +2,10 @@
  * 文件名：child.h
  * 模块功能：该模块在fork之后马上接管子进程，做完设置后执行用户程序
  * 版本：v0.1.0
- * 最后修改：2012-08-14
+ * 最后修改：2026-10-18
  *******************************************************************/
 #include "global.h"
+#include "sandbox.h"
 #include <errno.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -15,10 +16,21 @@
 #include <sys/types.h>
 #include <sys/ptrace.h>
 #include <sys/resource.h>
+#include <sys/syscall.h>
 
 #ifndef CHILD_H
 #define CHILD_H
 
+/*
+ * 控制描述符在用户进程中的编号，见childin的ctlfd
+ */
+#define CHILD_CTL_FD 3
+
+/*
+ * 绑定CPU时支持的最大CPU编号
+ */
+#define CHILD_CPU_MAX 1024
+
 /*
  * childin包含了该模块所需要的全部输入数据
  */
@@ -32,6 +44,9 @@ struct childin
 	const char *basedir;	/* 用户程序的工作目录和根目录 */
 	char * const *command;	/* execve的参数 */
 	int who;				/* 执行用户程序的uid和gid */
+	int ctlfd;				/* 不为-1则作为CHILD_CTL_FD传给用户程序，用于zygote */
+	const char *rootfs;		/* 不为NULL则在命名空间中以它为根目录，见sandbox.h */
+	int cpu;				/* 不为-1则把用户进程绑定到该CPU上 */
 };
 void child_run_process(struct childin *chd);
 
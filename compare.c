@@ -0,0 +1,550 @@
+/*************************************************
+ * 源文件：compare.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "compare.h"
+
+/*
+ * 不计顺序比较时的一行或一个记号，指向mmap的缓冲区，不拷贝内容
+ */
+struct cmpitem
+{
+	uint64_t hash;
+	const char *ptr;
+	long len;
+};
+
+/*
+ * 局部函数声明
+ */
+static enum estatus cmp_string(const char *str1, long len1,
+		const char *str2, long len2, int icase);
+static enum estatus cmp_token(const char *str1, long len1,
+		const char *str2, long len2, const struct cmpmode *mode);
+static enum estatus cmp_multiset(const char *str1, long len1,
+		const char *str2, long len2, int lines);
+static int cmp_next_token(const char *str, long len, long *pos,
+		const char **tok);
+static int cmp_next_line(const char *str, long len, long *pos,
+		const char **line);
+static long cmp_collect(const char *str, long len, int lines,
+		struct cmpitem *items);
+static void cmp_radix_sort(struct cmpitem *items, struct cmpitem *tmp,
+		long n);
+static int cmp_item_order(const void *a, const void *b);
+static int cmp_parse_number(const char *tok, int len, double *val);
+static int cmp_is_nonprint(char c);
+static int cmp_is_space(char c);
+static char cmp_fold(char c, int icase);
+
+/*
+ * 接口函数：cmp_parse
+ * 功能：解析比较方式的描述
+ * 参数：spec为描述，可以是strict, token, icase, lineset, tokenset,
+ *   float, float:<eps>或者float:<abseps>:<releps>，
+ *   只给一个误差时绝对和相对误差相同，
+ *   mode接收解析结果，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ */
+int
+cmp_parse(const char *spec, struct cmpmode *mode, char *errmsg)
+{
+	char *end;
+
+	memset(mode, 0, sizeof(struct cmpmode));
+	mode->abseps = mode->releps = 1e-6;
+
+	if (strcmp(spec, "strict") == 0)
+		mode->kind = CMP_STRICT;
+	else if (strcmp(spec, "token") == 0)
+		mode->kind = CMP_TOKEN;
+	else if (strcmp(spec, "icase") == 0)
+		mode->kind = CMP_ICASE;
+	else if (strcmp(spec, "lineset") == 0)
+		mode->kind = CMP_LINESET;
+	else if (strcmp(spec, "tokenset") == 0)
+		mode->kind = CMP_TOKENSET;
+	else if (strncmp(spec, "float", 5) == 0 &&
+			(spec[5] == '\0' || spec[5] == ':')) {
+		mode->kind = CMP_FLOAT;
+		if (spec[5] == '\0')
+			return 0;
+
+		mode->abseps = mode->releps = strtod(spec + 6, &end);
+		if (*end == ':')
+			mode->releps = strtod(end + 1, &end);
+		if (*end != '\0' || mode->abseps < 0 || mode->releps < 0) {
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**cmp_parse** bad epsilon: %s", spec);
+			return -1;
+		}
+	} else {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**cmp_parse** unknown compare mode: %s", spec);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * 接口函数：cmp_compare
+ * 功能：按照比较方式比较用户输出和答案
+ * 参数：mode为比较方式，为NULL则为严格比较，
+ *   out和outlen为用户输出，ans和anslen为答案
+ * 返回值：enum estatus（定义在global.h）中的AC，PE或者WA，
+ *   不计顺序的比较分配空间失败时返回EXIT_IE
+ * 注意：缓冲区不要求以'\0'结尾，可以直接使用mmap的文件内容
+ */
+enum estatus
+cmp_compare(const struct cmpmode *mode,
+		const char *out, long outlen, const char *ans, long anslen)
+{
+	if (mode == NULL)
+		return cmp_string(out, outlen, ans, anslen, 0);
+
+	switch (mode->kind) {
+		case CMP_TOKEN :
+		case CMP_FLOAT : return cmp_token(out, outlen, ans, anslen, mode);
+		case CMP_ICASE : return cmp_string(out, outlen, ans, anslen, 1);
+		case CMP_LINESET :
+			return cmp_multiset(out, outlen, ans, anslen, 1);
+		case CMP_TOKENSET :
+			return cmp_multiset(out, outlen, ans, anslen, 0);
+		default :		 return cmp_string(out, outlen, ans, anslen, 0);
+	}
+}
+
+/*
+ * 局部函数：cmp_string
+ * 功能：将两个字符串进行比较，判断是AC，PE还是WA
+ * 参数：字符串str1长度为len1，字符串str2长度为len2，
+ *   icase为1则忽略字母大小写
+ * 返回值：enum estatus（定义在global.h）中的AC，PE或者WA
+ */
+static enum estatus
+cmp_string(const char *str1, long len1, const char *str2, long len2,
+		int icase)
+{
+	long i, j;
+
+	/* 去掉字符串尾部的不可打印字符 */
+	for (i = len1 - 1; i >= 0; --i)
+		if (!cmp_is_nonprint(str1[i]))
+				break;
+	if (i < 0)
+		return EXIT_WA;
+	else
+		len1 = i + 1;
+
+	for (j = len2 - 1; j >= 0; --j)
+		if (!cmp_is_nonprint(str2[j]))
+			break;
+	if (j < 0)
+		return EXIT_WA;
+	else
+		len2 = j + 1;
+
+	/* 进行一次整体比较，如果全部相同，则AC */
+	for (i = 0, j = 0; i < len1 && j < len2; ++i, ++j)
+		if (cmp_fold(str1[i], icase) != cmp_fold(str2[j], icase))
+			break;
+	if (i >= len1 && j >= len2)
+		return EXIT_AC;
+
+	/* 跳过不可打印字符进行一次比较，相同则PE，否则WA */
+	for (i = 0, j = 0; i < len1 && j < len2;) {
+		if (cmp_is_nonprint(str1[i])) {
+			++i;
+			continue;
+		}
+		if (cmp_is_nonprint(str2[j])) {
+			++j;
+			continue;
+		}
+
+		if (cmp_fold(str1[i], icase) != cmp_fold(str2[j], icase))
+			return EXIT_WA;
+		
+		++i;
+		++j;
+	}
+
+	/* 全部比较完才是PE，否则其中之一是子串，WA */
+	if (i >= len1 && j >= len2)
+		return EXIT_PE;
+	
+	return EXIT_WA;
+}
+
+/*
+ * 局部函数：cmp_token
+ * 功能：以空白分隔记号，逐个比较两个字符串的记号
+ * 参数：字符串str1长度为len1，字符串str2长度为len2，mode为比较方式
+ * 返回值：EXIT_AC或者EXIT_WA，记号比较不区分PE
+ * 注意：CMP_FLOAT下两个记号都是数值则按误差比较，否则逐字符比较
+ */
+static enum estatus
+cmp_token(const char *str1, long len1, const char *str2, long len2,
+		const struct cmpmode *mode)
+{
+	int n1, n2;
+	long pos1 = 0, pos2 = 0;
+	const char *tok1, *tok2;
+	double v1, v2, diff;
+
+	while (1) {
+		n1 = cmp_next_token(str1, len1, &pos1, &tok1);
+		n2 = cmp_next_token(str2, len2, &pos2, &tok2);
+		if (n1 == 0 || n2 == 0)
+			return n1 == n2 ? EXIT_AC : EXIT_WA;
+
+		if (n1 == n2 && memcmp(tok1, tok2, n1) == 0)
+			continue;
+		if (mode->kind != CMP_FLOAT)
+			return EXIT_WA;
+
+		if (!cmp_parse_number(tok1, n1, &v1) ||
+				!cmp_parse_number(tok2, n2, &v2))
+			return EXIT_WA;
+
+		/* 答案为基准，满足绝对误差或者相对误差之一即可 */
+		diff = v1 > v2 ? v1 - v2 : v2 - v1;
+		if (diff <= mode->abseps)
+			continue;
+		if (diff <= mode->releps * (v2 < 0 ? -v2 : v2))
+			continue;
+		return EXIT_WA;
+	}
+}
+
+/*
+ * 局部函数：cmp_multiset
+ * 功能：判断两个字符串的行或记号作为多重集合是否相等
+ * 参数：字符串str1长度为len1，字符串str2长度为len2，
+ *   lines为1则按行，为0则按记号
+ * 返回值：EXIT_AC或者EXIT_WA，分配空间失败返回EXIT_IE
+ * 注意：每行或每个记号只记录摘要和位置，按摘要基数排序后顺序比较，
+ *   时间和空间都与行数成线性关系；摘要相同时仍比较内容
+ */
+static enum estatus
+cmp_multiset(const char *str1, long len1, const char *str2, long len2,
+		int lines)
+{
+	long i, j, k, n1, n2;
+	enum estatus code = EXIT_AC;
+	struct cmpitem *it1, *it2, *tmp;
+
+	/* 先数一遍个数，个数不同就不需要分配空间 */
+	n1 = cmp_collect(str1, len1, lines, NULL);
+	n2 = cmp_collect(str2, len2, lines, NULL);
+	if (n1 != n2)
+		return EXIT_WA;
+	if (n1 == 0)
+		return EXIT_AC;
+
+	it1 = malloc(sizeof(struct cmpitem) * n1);
+	it2 = malloc(sizeof(struct cmpitem) * n2);
+	tmp = malloc(sizeof(struct cmpitem) * n1);
+	if (it1 == NULL || it2 == NULL || tmp == NULL) {
+		free(it1);
+		free(it2);
+		free(tmp);
+		return EXIT_IE;
+	}
+
+	cmp_collect(str1, len1, lines, it1);
+	cmp_collect(str2, len2, lines, it2);
+	cmp_radix_sort(it1, tmp, n1);
+	cmp_radix_sort(it2, tmp, n2);
+
+	for (i = 0; i < n1 && code == EXIT_AC; i = j) {
+		/* 找出摘要相同的一段 */
+		for (j = i + 1; j < n1 && it1[j].hash == it1[i].hash; ++j)
+			;
+		for (k = i; k < j; ++k)
+			if (it2[k].hash != it1[i].hash)
+				break;
+		if (k < j || (j < n2 && it2[j].hash == it1[i].hash)) {
+			code = EXIT_WA;
+			break;
+		}
+
+		/* 段内按内容排序后逐个比较，处理摘要冲突 */
+		if (j - i > 1) {
+			qsort(it1 + i, j - i, sizeof(struct cmpitem), cmp_item_order);
+			qsort(it2 + i, j - i, sizeof(struct cmpitem), cmp_item_order);
+		}
+		for (k = i; k < j; ++k)
+			if (cmp_item_order(&it1[k], &it2[k]) != 0) {
+				code = EXIT_WA;
+				break;
+			}
+	}
+
+	free(it1);
+	free(it2);
+	free(tmp);
+	return code;
+}
+
+/*
+ * 局部函数：cmp_collect
+ * 功能：切分出字符串中的所有行或记号，计算每一项的摘要
+ * 参数：str和len为字符串，lines为1则按行，为0则按记号，
+ *   items接收结果，为NULL则只计数
+ * 返回值：行或记号的个数
+ * 注意：摘要为64位FNV-1a
+ */
+static long
+cmp_collect(const char *str, long len, int lines, struct cmpitem *items)
+{
+	int n, i;
+	long pos = 0, cnt = 0;
+	const char *p;
+	uint64_t h;
+
+	while (1) {
+		if (lines)
+			n = cmp_next_line(str, len, &pos, &p);
+		else
+			n = cmp_next_token(str, len, &pos, &p);
+		if (n < 0 || (!lines && n == 0))
+			break;
+		if (n == 0)
+			continue;
+
+		if (items != NULL) {
+			h = 14695981039346656037ULL;
+			for (i = 0; i < n; ++i) {
+				h ^= (unsigned char)p[i];
+				h *= 1099511628211ULL;
+			}
+			items[cnt].hash = h;
+			items[cnt].ptr = p;
+			items[cnt].len = n;
+		}
+		++cnt;
+	}
+
+	return cnt;
+}
+
+/*
+ * 局部函数：cmp_radix_sort
+ * 功能：按摘要对各项进行LSD基数排序，每趟8位
+ * 参数：items为待排序的项，tmp为同样大小的临时空间，n为项数
+ * 返回值：无
+ * 注意：某一位上所有项都相同的一趟直接跳过
+ */
+static void
+cmp_radix_sort(struct cmpitem *items, struct cmpitem *tmp, long n)
+{
+	int shift, b;
+	long i, cnt[256], sum;
+	struct cmpitem *src = items, *dst = tmp, *swap;
+
+	for (shift = 0; shift < 64; shift += 8) {
+		memset(cnt, 0, sizeof(cnt));
+		for (i = 0; i < n; ++i)
+			++cnt[(src[i].hash >> shift) & 0xff];
+		if (cnt[(src[0].hash >> shift) & 0xff] == n)
+			continue;
+
+		for (b = 0, sum = 0; b < 256; ++b) {
+			i = cnt[b];
+			cnt[b] = sum;
+			sum += i;
+		}
+		for (i = 0; i < n; ++i)
+			dst[cnt[(src[i].hash >> shift) & 0xff]++] = src[i];
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != items)
+		memcpy(items, src, sizeof(struct cmpitem) * n);
+}
+
+/*
+ * 局部函数：cmp_item_order
+ * 功能：qsort的比较函数，按内容比较两项
+ * 参数：a和b指向struct cmpitem
+ * 返回值：同memcmp
+ */
+static int
+cmp_item_order(const void *a, const void *b)
+{
+	int r;
+	const struct cmpitem *x = a, *y = b;
+
+	r = memcmp(x->ptr, y->ptr, x->len < y->len ? x->len : y->len);
+	if (r != 0)
+		return r;
+	if (x->len != y->len)
+		return x->len < y->len ? -1 : 1;
+	return 0;
+}
+
+/*
+ * 局部函数：cmp_next_token
+ * 功能：从pos开始查找下一个记号
+ * 参数：str和len为字符串，pos为当前位置，返回时指向记号之后，
+ *   tok接收记号的开始位置
+ * 返回值：记号的长度，没有记号返回0
+ */
+static int
+cmp_next_token(const char *str, long len, long *pos, const char **tok)
+{
+	long i = *pos, start;
+
+	while (i < len && cmp_is_space(str[i]))
+		++i;
+	start = i;
+	while (i < len && !cmp_is_space(str[i]))
+		++i;
+
+	*pos = i;
+	*tok = str + start;
+	return i - start;
+}
+
+/*
+ * 局部函数：cmp_next_line
+ * 功能：从pos开始取下一行，去掉行尾的空白
+ * 参数：str和len为字符串，pos为当前位置，返回时指向下一行的开始，
+ *   line接收行的开始位置
+ * 返回值：去掉行尾空白之后的长度，没有更多的行返回-1
+ */
+static int
+cmp_next_line(const char *str, long len, long *pos, const char **line)
+{
+	long start = *pos, end;
+	const char *nl;
+
+	if (start >= len)
+		return -1;
+
+	nl = memchr(str + start, '\n', len - start);
+	end = nl != NULL ? nl - str : len;
+	*pos = nl != NULL ? end + 1 : len;
+
+	while (end > start && cmp_is_space(str[end - 1]))
+		--end;
+	*line = str + start;
+	return end - start;
+}
+
+/*
+ * 局部函数：cmp_parse_number
+ * 功能：就地解析一个十进制数，记号不需要以'\0'结尾
+ * 参数：tok和len为记号，val接收数值
+ * 返回值：整个记号是一个数返回1，否则返回0
+ * 注意：最多保留19位有效数字，对于误差比较已经足够；
+ *   不接受nan和inf，这样的记号只能逐字符相同
+ */
+static int
+cmp_parse_number(const char *tok, int len, double *val)
+{
+	int i = 0, neg = 0, digits = 0, expneg = 0;
+	int exp = 0, e = 0;
+	uint64_t mant = 0;
+	double v, p, base;
+
+	if (i < len && (tok[i] == '+' || tok[i] == '-'))
+		neg = tok[i++] == '-';
+
+	/* 整数部分，超出的有效数字只计入指数 */
+	for (; i < len && tok[i] >= '0' && tok[i] <= '9'; ++i, ++digits) {
+		if (mant < 1000000000000000000ULL)
+			mant = mant * 10 + (tok[i] - '0');
+		else
+			++exp;
+	}
+
+	/* 小数部分 */
+	if (i < len && tok[i] == '.') {
+		for (++i; i < len && tok[i] >= '0' && tok[i] <= '9'; ++i, ++digits) {
+			if (mant < 1000000000000000000ULL) {
+				mant = mant * 10 + (tok[i] - '0');
+				--exp;
+			}
+		}
+	}
+	if (digits == 0)
+		return 0;
+
+	/* 指数部分 */
+	if (i < len && (tok[i] == 'e' || tok[i] == 'E')) {
+		if (++i < len && (tok[i] == '+' || tok[i] == '-'))
+			expneg = tok[i++] == '-';
+		if (i >= len || tok[i] < '0' || tok[i] > '9')
+			return 0;
+		for (; i < len && tok[i] >= '0' && tok[i] <= '9'; ++i)
+			if (e < 100000)
+				e = e * 10 + (tok[i] - '0');
+		exp += expneg ? -e : e;
+	}
+	if (i != len)
+		return 0;
+
+	/* 用平方乘计算10的幂，溢出为无穷大也是正确的比较结果 */
+	v = (double)mant;
+	p = 1.0;
+	base = 10.0;
+	for (e = exp < 0 ? -exp : exp; mant != 0 && e > 0; e >>= 1) {
+		if (e & 1)
+			p *= base;
+		base *= base;
+	}
+	v = exp < 0 ? v / p : v * p;
+
+	*val = neg ? -v : v;
+	return 1;
+}
+
+/*
+ * 局部函数：cmp_is_nonprint
+ * 功能：判断一个字符是否是可打印字符
+ * 参数：c为待判断的字符
+ * 返回值：不可打印字符返回1，可打印返回0
+ * 注意：仅tab，空格和换行视为不可打印字符
+ */
+static int
+cmp_is_nonprint(char c)
+{
+	if (c == '\n' || c == '\t' || c == ' ')
+		return 1;
+	return 0;
+}
+
+/*
+ * 局部函数：cmp_is_space
+ * 功能：判断一个字符是否是记号之间的分隔符
+ * 参数：c为待判断的字符
+ * 返回值：是分隔符返回1，否则返回0
+ * 注意：比cmp_is_nonprint多了'\r'，'\v'和'\f'
+ */
+static int
+cmp_is_space(char c)
+{
+	return c == ' ' || c == '\n' || c == '\t' ||
+		c == '\r' || c == '\v' || c == '\f';
+}
+
+/*
+ * 局部函数：cmp_fold
+ * 功能：忽略大小写时把大写字母转换为小写
+ * 参数：c为字符，icase为0则原样返回
+ * 返回值：转换后的字符
+ */
+static char
+cmp_fold(char c, int icase)
+{
+	if (icase && c >= 'A' && c <= 'Z')
+		return c - 'A' + 'a';
+	return c;
+}
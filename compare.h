@@ -0,0 +1,44 @@
+/***************************************************************
+ * 文件名：compare.h
+ * 模块功能：在进程内比较用户程序输出和答案文件，
+ *   提供严格、按记号、浮点容差、忽略大小写和不计顺序几种比较方式
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef COMPARE_H
+#define COMPARE_H
+
+/*
+ * 比较方式
+ */
+enum cmpkind
+{
+	CMP_STRICT,				/* 逐字符比较，空白不同判PE */
+	CMP_TOKEN,				/* 以空白分隔的记号逐个比较 */
+	CMP_FLOAT,				/* 记号比较，数值允许误差 */
+	CMP_ICASE,				/* 同CMP_STRICT，但忽略字母大小写 */
+	CMP_LINESET,			/* 行的多重集合相等，不计顺序 */
+	CMP_TOKENSET,			/* 记号的多重集合相等，不计顺序 */
+};
+
+/*
+ * 一个题目的比较方式和参数
+ */
+struct cmpmode
+{
+	enum cmpkind kind;
+	double abseps;			/* CMP_FLOAT的绝对误差 */
+	double releps;			/* CMP_FLOAT的相对误差 */
+};
+
+int cmp_parse(const char *spec, struct cmpmode *mode, char *errmsg);
+enum estatus cmp_compare(const struct cmpmode *mode,
+		const char *out, long outlen, const char *ans, long anslen);
+
+#endif
@@ -0,0 +1,561 @@
+/*************************************************
+ * 源文件：compile.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "compile.h"
+
+/*
+ * 等待编译器结束时的轮询间隔，单位毫秒
+ */
+#define COMPILE_POLL_SLICE 10
+
+/*
+ * 局部函数声明
+ */
+static int compile_version(const char *cc, unsigned char *hash,
+		char *errmsg);
+static int compile_pch(const struct compilation *cp, char **flags,
+		int nflag, const unsigned char *vhash, char *dir);
+static int compile_exec(const struct compilation *cp, char **argv,
+		const char *dir, int who, long fsize, int outfd, int *status);
+static int compile_copy(const char *from, const char *to, mode_t mode);
+static int compile_save(const char *from, const char *path);
+static void compile_clean(const char *dir);
+static const char * compile_ext(const char *src);
+static int compile_fail(struct result *res, enum estatus code);
+
+/*
+ * 接口函数：compile_start
+ * 功能：编译用户的源程序，生成cp->exe
+ * 参数：cp为编译条件，res接收编译失败的结果和编译的附加行
+ * 返回值：编译成功返回0；失败返回-1，res->code为EXIT_CE，
+ *   参数错误为EXIT_EE，其他错误为EXIT_IE，信息在res->msg中
+ * 注意：源程序复制到临时目录中编译，编译器以cp->who的身份运行，
+ *   有墙上时间、内存和输出文件大小的限制；缓存键包括源程序的内容、
+ *   编译器及其--version输出和编译选项，编译错误也被缓存；
+ *   C++源程序包含bits/stdc++.h时使用缓存目录中共享的预编译头文件
+ */
+int
+compile_start(const struct compilation *cp, struct result *res)
+{
+	int i, n, fd, nflag, status, ret;
+	char work[PATH_MAX], src[PATH_MAX], out[PATH_MAX];
+	char path[PATH_MAX], pch[PATH_MAX], hex[HASH_HEX];
+	char *errmsg = res->msg, buf[65536];
+	char flagbuf[PATH_MAX], *flags[COMPILE_ARGS], *argv[COMPILE_ARGS + 8];
+	unsigned char vhash[HASH_LEN], shash[HASH_LEN], key[HASH_LEN];
+	const char *ext = compile_ext(cp->src);
+	struct hashctx ctx;
+	struct timespec begin, end;
+	int stdcpp = 0;
+
+	/* 拆分编译选项 */
+	snprintf(flagbuf, PATH_MAX, "%s", cp->cflags != NULL ? cp->cflags : "");
+	nflag = 0;
+	for (flags[0] = strtok(flagbuf, " \t"); flags[nflag] != NULL;
+			flags[nflag] = strtok(NULL, " \t")) {
+		if (++nflag >= COMPILE_ARGS) {
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**compile_start** too many compiler flags.");
+			return compile_fail(res, EXIT_EE);
+		}
+	}
+
+	if (compile_version(cp->cc, vhash, errmsg) != 0)
+		return compile_fail(res, EXIT_EE);
+
+	/* 编译器以用户的身份运行，临时目录只允许写入和进入 */
+	snprintf(work, PATH_MAX, "/tmp/moj-cc-XXXXXX");
+	if (mkdtemp(work) == NULL) {
+		snprintf(errmsg, ERR_MSG_MAX, "**compile_start** mkdtemp error: %s",
+				strerror(errno));
+		return compile_fail(res, EXIT_IE);
+	}
+	chmod(work, S_IRWXU | S_IWGRP | S_IXGRP | S_IWOTH | S_IXOTH);
+
+	/* 复制源程序，同时计算摘要 */
+	snprintf(src, PATH_MAX, "%s/main%s", work, ext);
+	if (compile_copy(cp->src, src, S_IRUSR | S_IRGRP | S_IROTH) != 0) {
+		snprintf(errmsg, ERR_MSG_MAX, "**compile_start** copy %s error: %s",
+				cp->src, strerror(errno));
+		compile_clean(work);
+		return compile_fail(res, EXIT_IE);
+	}
+	if (hash_file(src, shash, errmsg) != 0) {
+		compile_clean(work);
+		return compile_fail(res, EXIT_IE);
+	}
+
+	hash_init(&ctx);
+	hash_update(&ctx, COMPILE_VERSION, strlen(COMPILE_VERSION) + 1);
+	hash_update(&ctx, cp->cc, strlen(cp->cc) + 1);
+	hash_update(&ctx, vhash, HASH_LEN);
+	for (i = 0; i < nflag; ++i)
+		hash_update(&ctx, flags[i], strlen(flags[i]) + 1);
+	hash_update(&ctx, ext, strlen(ext) + 1);
+	hash_update(&ctx, shash, HASH_LEN);
+	/* 内存不足导致的编译错误也会被缓存，内存限制参与摘要 */
+	hash_update(&ctx, &cp->memory, sizeof(cp->memory));
+	hash_final(&ctx, key);
+	hash_hex(key, hex);
+
+	/* 缓存中有可执行文件则直接使用，有编译错误则直接返回 */
+	path[0] = '\0';
+	if (cp->cache != NULL) {
+		snprintf(path, PATH_MAX, "%s/%.2s/%s", cp->cache, hex, hex);
+		if (compile_copy(path, cp->exe, S_IRWXU | S_IRGRP | S_IXGRP |
+					S_IROTH | S_IXOTH) == 0) {
+			compile_clean(work);
+			exit_extra(res, "compile cached");
+			return 0;
+		}
+		snprintf(out, PATH_MAX, "%s.ce", path);
+		if ((fd = open(out, O_RDONLY)) != -1) {
+			n = read(fd, errmsg, ERR_MSG_MAX - 1);
+			close(fd);
+			errmsg[n > 0 ? n : 0] = '\0';
+			compile_clean(work);
+			return compile_fail(res, EXIT_CE);
+		}
+	}
+
+	/* 只有源程序以万能头文件开头时预编译头文件才有用 */
+	if ((fd = open(src, O_RDONLY)) != -1) {
+		n = read(fd, buf, sizeof(buf) - 1);
+		buf[n > 0 ? n : 0] = '\0';
+		stdcpp = strstr(buf, "bits/stdc++.h") != NULL;
+		close(fd);
+	}
+
+	n = 0;
+	argv[n++] = (char *)cp->cc;
+	for (i = 0; i < nflag; ++i)
+		argv[n++] = flags[i];
+	if (cp->cache != NULL && stdcpp && strstr(cp->cc, "++") != NULL &&
+			compile_pch(cp, flags, nflag, vhash, pch) == 0) {
+		argv[n++] = "-I";
+		argv[n++] = pch;
+	}
+	argv[n++] = "-o";
+	argv[n++] = "main";
+	argv[n++] = src + strlen(work) + 1;
+	argv[n] = NULL;
+
+	/* 编译器的标准输出和标准出错都写到消息文件 */
+	snprintf(out, PATH_MAX, "%s/message", work);
+	if ((fd = open(out, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR))
+			== -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**compile_start** open %s error: %s",
+				out, strerror(errno));
+		compile_clean(work);
+		return compile_fail(res, EXIT_IE);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	ret = compile_exec(cp, argv, work, cp->who, COMPILE_FSIZE, fd, &status);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	n = pread(fd, errmsg, ERR_MSG_MAX - 1, 0);
+	errmsg[n > 0 ? n : 0] = '\0';
+	close(fd);
+
+	if (ret == -1) {
+		compile_clean(work);
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**compile_start** cannot run %s.", cp->cc);
+		return compile_fail(res, EXIT_IE);
+	}
+	if (ret == 1) {
+		compile_clean(work);
+		snprintf(errmsg, ERR_MSG_MAX,
+				"compilation timeout after %d ms", cp->time);
+		return compile_fail(res, EXIT_CE);
+	}
+
+	snprintf(src, PATH_MAX, "%s/main", work);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+			access(src, F_OK) != 0) {
+		/* 正常退出的编译错误是确定的，可以缓存；被信号杀死的不缓存 */
+		if (path[0] != '\0' && WIFEXITED(status)) {
+			snprintf(src, PATH_MAX, "%s.ce", path);
+			compile_save(out, src);
+		}
+		compile_clean(work);
+		if (errmsg[0] == '\0')
+			snprintf(errmsg, ERR_MSG_MAX, "compiler killed by signal %d",
+					WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+		return compile_fail(res, EXIT_CE);
+	}
+
+	if (compile_copy(src, cp->exe, S_IRWXU | S_IRGRP | S_IXGRP |
+				S_IROTH | S_IXOTH) != 0) {
+		snprintf(errmsg, ERR_MSG_MAX, "**compile_start** copy %s error: %s",
+				cp->exe, strerror(errno));
+		compile_clean(work);
+		return compile_fail(res, EXIT_IE);
+	}
+	if (path[0] != '\0')
+		compile_save(src, path);
+	compile_clean(work);
+
+	exit_extra(res, "compile %ldms", (end.tv_sec - begin.tv_sec) * 1000 +
+			(end.tv_nsec - begin.tv_nsec) / 1000000);
+	return 0;
+}
+
+/*
+ * 局部函数：compile_fail
+ * 功能：记录编译失败的状态
+ * 参数：res为结果，信息已经写入res->msg，code为状态
+ * 返回值：总是返回-1，供compile_start直接返回
+ */
+static int
+compile_fail(struct result *res, enum estatus code)
+{
+	res->code = code;
+	return -1;
+}
+
+/*
+ * 局部函数：compile_version
+ * 功能：计算编译器"--version"输出的摘要
+ * 参数：cc为编译器，hash接收摘要，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：编译器升级之后摘要改变，旧的缓存条目自然失效
+ */
+static int
+compile_version(const char *cc, unsigned char *hash, char *errmsg)
+{
+	int pfd[2], n, status, nullfd;
+	char buf[4096];
+	struct hashctx ctx;
+	pid_t pid;
+	uid_t uid;
+
+	if (pipe(pfd) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**compile_version** pipe error: %s", strerror(errno));
+		return -1;
+	}
+
+	if ((pid = fork()) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**compile_version** fork error: %s", strerror(errno));
+		close(pfd[0]);
+		close(pfd[1]);
+		return -1;
+
+	} else if (pid == 0) {
+		/* 先换回超级用户，再把三个用户ID都设置为评测程序的用户 */
+		uid = geteuid();
+		if (setreuid(geteuid(), getuid()) == -1 || setuid(uid) == -1)
+			_exit(1);
+		close(pfd[0]);
+		if (dup2(pfd[1], STDOUT_FILENO) == -1)
+			_exit(1);
+		if ((nullfd = open("/dev/null", O_RDWR)) != -1) {
+			dup2(nullfd, STDIN_FILENO);
+			dup2(nullfd, STDERR_FILENO);
+		}
+		execlp(cc, cc, "--version", (char *)0);
+		_exit(1);
+	}
+
+	close(pfd[1]);
+	hash_init(&ctx);
+	while ((n = read(pfd[0], buf, sizeof(buf))) > 0)
+		hash_update(&ctx, buf, n);
+	close(pfd[0]);
+	hash_final(&ctx, hash);
+
+	if (waitpid(pid, &status, 0) == -1 ||
+			!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**compile_version** %s --version failed.", cc);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：compile_pch
+ * 功能：找到或生成与编译器和编译选项对应的bits/stdc++.h预编译头文件
+ * 参数：cp为编译条件，flags和nflag为编译选项，vhash为编译器版本的摘要，
+ *   dir接收预编译头文件所在的目录，用作-I参数
+ * 返回值：成功返回0，失败返回-1，失败时不使用预编译头文件
+ * 注意：预编译头文件放在"<缓存>/pch/<摘要>/bits/stdc++.h.gch"，
+ *   GCC在每个包含目录中先找.gch文件，选项不兼容时会自动忽略它；
+ *   生成时编译的是固定的内容，以评测程序的用户身份运行，
+ *   先在临时目录中生成再改名，并发的评测不会用到不完整的文件
+ */
+static int
+compile_pch(const struct compilation *cp, char **flags, int nflag,
+		const unsigned char *vhash, char *dir)
+{
+	int i, n, fd, status;
+	char path[PATH_MAX], tmp[PATH_MAX], hex[HASH_HEX];
+	char *argv[COMPILE_ARGS + 8];
+	const char *stub = "#include <bits/stdc++.h>\n";
+	unsigned char key[HASH_LEN];
+	struct hashctx ctx;
+
+	hash_init(&ctx);
+	hash_update(&ctx, COMPILE_VERSION, strlen(COMPILE_VERSION) + 1);
+	hash_update(&ctx, "pch", 4);
+	hash_update(&ctx, cp->cc, strlen(cp->cc) + 1);
+	hash_update(&ctx, vhash, HASH_LEN);
+	for (i = 0; i < nflag; ++i)
+		hash_update(&ctx, flags[i], strlen(flags[i]) + 1);
+	hash_final(&ctx, key);
+	hash_hex(key, hex);
+
+	snprintf(dir, PATH_MAX, "%s/pch/%s", cp->cache, hex);
+	snprintf(path, PATH_MAX, "%s/bits/stdc++.h.gch", dir);
+	if (access(path, R_OK) == 0)
+		return 0;
+
+	snprintf(path, PATH_MAX, "%s/pch", cp->cache);
+	if (mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) == -1 &&
+			errno != EEXIST)
+		return -1;
+	snprintf(tmp, PATH_MAX, "%s/pch/.tmp-XXXXXX", cp->cache);
+	if (mkdtemp(tmp) == NULL)
+		return -1;
+	chmod(tmp, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
+
+	snprintf(path, PATH_MAX, "%s/bits", tmp);
+	mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
+	snprintf(path, PATH_MAX, "%s/stdc++.h", tmp);
+	if ((fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR))
+			== -1 || write(fd, stub, strlen(stub)) != (ssize_t)strlen(stub)) {
+		if (fd != -1)
+			close(fd);
+		compile_clean(tmp);
+		return -1;
+	}
+	close(fd);
+
+	n = 0;
+	argv[n++] = (char *)cp->cc;
+	for (i = 0; i < nflag; ++i)
+		argv[n++] = flags[i];
+	argv[n++] = "-x";
+	argv[n++] = "c++-header";
+	argv[n++] = "stdc++.h";
+	argv[n++] = "-o";
+	argv[n++] = "bits/stdc++.h.gch";
+	argv[n] = NULL;
+
+	if ((fd = open("/dev/null", O_WRONLY)) == -1) {
+		compile_clean(tmp);
+		return -1;
+	}
+	n = compile_exec(cp, argv, tmp, 0, COMPILE_PCH_FSIZE, fd, &status);
+	close(fd);
+
+	/* 占位的头文件不能留在包含目录中 */
+	unlink(path);
+	if (n == 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+			rename(tmp, dir) == 0)
+		return 0;
+
+	/* 生成失败，或者其他评测先生成了同样的文件，则使用已有的 */
+	snprintf(path, PATH_MAX, "%s/bits", tmp);
+	compile_clean(path);
+	compile_clean(tmp);
+	snprintf(path, PATH_MAX, "%s/bits/stdc++.h.gch", dir);
+	return access(path, R_OK) == 0 ? 0 : -1;
+}
+
+/*
+ * 局部函数：compile_exec
+ * 功能：在限制之下运行编译器
+ * 参数：cp为编译条件，argv为编译器的参数，dir为工作目录，
+ *   who不为0则以该用户的身份运行，否则以评测程序的用户身份运行，
+ *   fsize为输出文件大小的限制，outfd接收标准输出和标准出错，status接收退出状态
+ * 返回值：编译器结束返回0，超时返回1，无法运行返回-1
+ * 注意：编译器在独立的进程组中运行，超时的时候整个进程组被杀死；
+ *   临时文件也写在dir中
+ */
+static int
+compile_exec(const struct compilation *cp, char **argv,
+		const char *dir, int who, long fsize, int outfd, int *status)
+{
+	int nullfd;
+	struct rlimit rl;
+	struct timespec now, end;
+	pid_t pid;
+	uid_t uid;
+
+	if ((pid = fork()) == -1)
+		return -1;
+
+	if (pid == 0) {
+		setpgid(0, 0);
+
+		/* 先换回超级用户，再设置为目标用户 */
+		uid = who != 0 ? (uid_t)who : geteuid();
+		if (setreuid(geteuid(), getuid()) == -1)
+			_exit(1);
+		if (who != 0 && setgid(who) == -1)
+			_exit(1);
+		if (setuid(uid) == -1)
+			_exit(1);
+
+		if (chdir(dir) == -1)
+			_exit(1);
+		if ((nullfd = open("/dev/null", O_RDONLY)) == -1 ||
+				dup2(nullfd, STDIN_FILENO) == -1 ||
+				dup2(outfd, STDOUT_FILENO) == -1 ||
+				dup2(outfd, STDERR_FILENO) == -1)
+			_exit(1);
+		umask(S_IWGRP | S_IWOTH);
+		setenv("TMPDIR", dir, 1);
+
+		rl.rlim_cur = rl.rlim_max = cp->time / 1000 + 1;
+		setrlimit(RLIMIT_CPU, &rl);
+		rl.rlim_cur = rl.rlim_max = (rlim_t)cp->memory * 1024;
+		setrlimit(RLIMIT_AS, &rl);
+		rl.rlim_cur = rl.rlim_max = fsize;
+		setrlimit(RLIMIT_FSIZE, &rl);
+
+		execvp(argv[0], argv);
+		_exit(127);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += cp->time / 1000;
+	end.tv_nsec += (cp->time % 1000) * 1000000L;
+	if (end.tv_nsec >= 1000000000L) {
+		++end.tv_sec;
+		end.tv_nsec -= 1000000000L;
+	}
+
+	while (waitpid(pid, status, WNOHANG) == 0) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (now.tv_sec > end.tv_sec ||
+				(now.tv_sec == end.tv_sec && now.tv_nsec >= end.tv_nsec)) {
+			kill(-pid, SIGKILL);
+			kill(pid, SIGKILL);
+			waitpid(pid, status, 0);
+			return 1;
+		}
+		poll(NULL, 0, COMPILE_POLL_SLICE);
+	}
+
+	if (WIFEXITED(*status) && WEXITSTATUS(*status) == 127)
+		return -1;
+	return 0;
+}
+
+/*
+ * 局部函数：compile_copy
+ * 功能：复制文件，目标文件被替换
+ * 参数：from为源路径，to为目标路径，mode为目标文件的权限
+ * 返回值：成功返回0，出错返回-1，errno为出错原因
+ */
+static int
+compile_copy(const char *from, const char *to, mode_t mode)
+{
+	int in, out, n;
+	char buf[65536];
+
+	if ((in = open(from, O_RDONLY)) == -1)
+		return -1;
+	unlink(to);
+	if ((out = open(to, O_CREAT | O_WRONLY | O_TRUNC, mode)) == -1) {
+		close(in);
+		return -1;
+	}
+	fchmod(out, mode);
+
+	while ((n = read(in, buf, sizeof(buf))) > 0) {
+		if (write(out, buf, n) != n) {
+			n = -1;
+			break;
+		}
+	}
+
+	close(in);
+	if (close(out) == -1)
+		n = -1;
+	if (n == -1) {
+		unlink(to);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：compile_save
+ * 功能：把文件存入编译缓存
+ * 参数：from为源路径，path为缓存中的路径
+ * 返回值：成功返回0，出错返回-1
+ * 注意：先写临时文件再改名，并发的评测不会读到不完整的条目；
+ *   保存失败只是少了一个缓存条目，不影响评测结果
+ */
+static int
+compile_save(const char *from, const char *path)
+{
+	char dir[PATH_MAX], tmp[PATH_MAX];
+
+	snprintf(dir, PATH_MAX, "%s", path);
+	*strrchr(dir, '/') = '\0';
+	if (mkdir(dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) == -1 &&
+			errno != EEXIST)
+		return -1;
+
+	snprintf(tmp, PATH_MAX, "%s.%d", path, getpid());
+	if (compile_copy(from, tmp, S_IRUSR | S_IRGRP | S_IROTH) != 0)
+		return -1;
+	if (rename(tmp, path) == -1) {
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：compile_clean
+ * 功能：删除临时目录中的文件和目录本身，不递归
+ * 参数：dir为临时目录
+ * 返回值：无
+ */
+static void
+compile_clean(const char *dir)
+{
+	DIR *dp;
+	struct dirent *de;
+	char path[PATH_MAX];
+
+	if ((dp = opendir(dir)) != NULL) {
+		while ((de = readdir(dp)) != NULL) {
+			if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+				continue;
+			snprintf(path, PATH_MAX, "%s/%s", dir, de->d_name);
+			unlink(path);
+		}
+		closedir(dp);
+	}
+	rmdir(dir);
+}
+
+/*
+ * 局部函数：compile_ext
+ * 功能：取源程序的后缀，编译器按后缀识别语言
+ * 参数：src为源程序路径
+ * 返回值：包括'.'的后缀，没有后缀返回".cpp"
+ */
+static const char *
+compile_ext(const char *src)
+{
+	const char *base, *dot;
+
+	base = strrchr(src, '/');
+	base = base != NULL ? base + 1 : src;
+	dot = strrchr(base, '.');
+	if (dot == NULL || dot == base || strlen(dot) > 8)
+		return ".cpp";
+	return dot;
+}
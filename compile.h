@@ -0,0 +1,71 @@
+/***************************************************************
+ * 文件名：compile.h
+ * 模块功能：评测之前编译用户的源程序，编译结果按源程序、
+ *   编译器版本和编译选项的摘要缓存，C++的万能头文件预编译后共享
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include "hash.h"
+#include "exit.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#ifndef COMPILE_H
+#define COMPILE_H
+
+/*
+ * 编译缓存条目格式的版本，改变格式时递增，使旧条目失效
+ */
+#define COMPILE_VERSION "moj-compile-1"
+
+/*
+ * 默认的编译器和编译限制：墙上时间（毫秒），内存（kb），输出文件大小（字节）
+ */
+#define COMPILE_CC "g++"
+#define COMPILE_TIME 10000
+#define COMPILE_MEMORY (2 * 1024 * 1024)
+#define COMPILE_FSIZE (64L << 20)
+
+/*
+ * 预编译头文件比可执行文件大得多，单独限制
+ */
+#define COMPILE_PCH_FSIZE (1L << 30)
+
+/*
+ * 编译选项的参数个数上限
+ */
+#define COMPILE_ARGS 64
+
+/*
+ * 编译阶段的输入条件
+ */
+struct compilation
+{
+	const char *src;		/* 源程序文件 */
+	const char *cc;			/* 编译器，按PATH查找 */
+	const char *cflags;		/* 以空白分隔的编译选项，可以为NULL */
+	const char *exe;		/* 可执行文件的路径 */
+	const char *cache;		/* 编译缓存目录，NULL为不缓存 */
+	int time;				/* 墙上时间限制，单位毫秒 */
+	int memory;				/* 内存限制，单位kb */
+	int who;				/* 编译器以该用户的身份运行 */
+};
+
+int compile_start(const struct compilation *cp, struct result *res);
+
+#endif
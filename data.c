@@ -1,7 +1,7 @@
 /*************************************************
  * 源文件：data.c
  * 版本：v0.1.0
- * 最后修改：2012-08-15
+ * 最后修改：2026-10-18
  ************************************************/
 #include "data.h"
 
@@ -9,14 +9,13 @@
  * 局部函数声明
  */
 static int is_comment_line(const char *line);
-
-/*
- * 局部数据：data_list和data_index
- * 作用：存储输入和答案文件路径，data_index为data_list中的元素个数
- * 被使用：dd_前缀的相关函数
- */
-static char **data_list;
-static int data_index;
+static int is_option_line(const char *line);
+static int dd_push(struct dataset *ds, const char *str, int len, char *errmsg);
+static int dd_resolve(struct dataset *ds, const char *ddpath,
+		const char *store, char *errmsg);
+static int dd_load_manifest(struct dataset *ds, const char *ddpath,
+		char *errmsg);
+static int dd_entry_cmp(const void *a, const void *b);
 
 /*
  * 局部函数：is_comment_line
@@ -35,25 +34,80 @@ is_comment_line(const char *line)
 }
 
 /*
- * 接口函数：dd_init
- * 功能：从布局描述文件读取输入和答案文件的布局配置
- * 参数：ddpath为布局文件所在的目录，errmsg用于接收错误信息
- * 返回值：成功返回0，出错返回-1
+ * 局部函数：is_option_line
+ * 功能：判断字符串line是否是一个题目选项行
+ * 参数：用户提供的字符串，不做参数检查
+ * 返回值：是选项行返回1，否返回0
+ * 判断方法：字符串首字符是'@'，格式为"@键 值"，例如"@compare float:1e-6"
  */
-int
-dd_init(const char *ddpath, char *errmsg)
+static int
+is_option_line(const char *line)
+{
+	return line[0] == '@';
+}
+
+/*
+ * 局部函数：dd_push
+ * 功能：把一个字符串追加到数据集的字符串区
+ * 参数：ds为数据集，str和len为字符串及其长度，errmsg接收错误信息
+ * 返回值：成功返回字符串在字符串区中的偏移，出错返回-1
+ * 注意：字符串区可能被移动，打开完成之前只能保存偏移，不能保存指针
+ */
+static int
+dd_push(struct dataset *ds, const char *str, int len, char *errmsg)
+{
+	size_t size;
+	char *tmp;
+	int off;
+
+	if (ds->used + len + 1 > ds->size) {
+		size = ds->size == 0 ? 4096 : ds->size;
+		while (ds->used + len + 1 > size)
+			size *= 2;
+		if (size > INT_MAX || (tmp = realloc(ds->arena, size)) == NULL) {
+			sprintf(errmsg, "**dd_push** realloc error.");
+			return -1;
+		}
+		ds->arena = tmp;
+		ds->size = size;
+	}
+
+	off = ds->used;
+	memcpy(ds->arena + off, str, len);
+	ds->arena[off + len] = '\0';
+	ds->used += len + 1;
+	return off;
+}
+
+/*
+ * 接口函数：dd_open
+ * 功能：从布局描述文件读取输入和答案文件的布局配置，得到一个数据集
+ * 参数：ddpath为布局文件所在的目录，store为数据仓库目录，
+ *   为NULL则使用@store选项，errmsg用于接收错误信息
+ * 返回值：成功返回引用计数为1的数据集，出错返回空指针
+ * 注意：以"sha256:"开头的数据行是仓库引用，转换为仓库中的路径；
+ *   以'!'开头的数据行是生成程序和参数，程序的相对路径相对于ddpath；
+ *   数据目录中有清单文件时一并读入，清单是可选的；
+ *   第一个有效数据行给出的行数只用来截断多余的行，数组按实际读到的行数扩充
+ */
+struct dataset *
+dd_open(const char *ddpath, const char *store, char *errmsg)
 {
 	FILE *fd;
-	int len, n, cnt = 0;	/* cnt为当前处理行号，从1开始 */
-	int rest;  				/* 有多少行有效数据	*/
+	int len, off;
+	size_t n = 0;
+	int rest = 0;  			/* 有多少行有效数据	*/
+	int size = 0;			/* lines数组的大小 */
 	char file[PATH_MAX];
-	char *line, *tmp;
+	char *line = NULL;
+	int *tmp;
 	char flag = 0;			/* 读到第一个有效数据行的标记 */
-	
+	struct dataset *ds;
+
 	if (strlen(ddpath) + strlen("/data.conf") >= PATH_MAX) {
 		sprintf(errmsg,
-				"**dd_init** %s too long.", ddpath);
-		return -1;
+				"**dd_open** %s too long.", ddpath);
+		return NULL;
 	}
 
 	if (ddpath[strlen(ddpath) - 1] == '/')
@@ -61,122 +115,430 @@ dd_init(const char *ddpath, char *errmsg)
 	else
 		sprintf(file, "%s/%s", ddpath, "data.conf");
 
+	if ((ds = calloc(1, sizeof(struct dataset))) == NULL) {
+		sprintf(errmsg, "**dd_open** calloc error.");
+		return NULL;
+	}
+	ds->refs = 1;
+
 	fd = fopen(file, "r");
 	if (fd == NULL) {
 		snprintf(errmsg, ERR_MSG_MAX,
-				"**dd_init** fopen %s error: %s",
+				"**dd_open** fopen %s error: %s",
 				file, strerror(errno));
-		return -1;
+		goto errexit;
 	}
 
-	while (1) {
-		len = getline(&line, &n, fd);
-		if (len == -1)
-			break;
-
-		++cnt;
-
+	while ((len = getline(&line, &n, fd)) != -1) {
 		if (is_comment_line(line))
 			continue;
 
 		/* 去掉最后的换行符 */
-		line[len - 1] = '\0';
-		--len;
+		if (line[len - 1] == '\n') {
+			line[len - 1] = '\0';
+			--len;
+		}
+
+		/*
+		 * 选项行可以出现在任何位置，不计入有效数据行，存为"键\0值"；
+		 * 连同行尾的'\0'一起追加，没有值的选项其值为空字符串
+		 */
+		if (is_option_line(line)) {
+			if (ds->nopt >= DD_OPT_MAX)
+				continue;
+			line[1 + strcspn(line + 1, " \t")] = '\0';
+			if ((off = dd_push(ds, line + 1, len, errmsg)) == -1)
+				goto errexit;
+			ds->opts[ds->nopt++] = off;
+			continue;
+		}
 
 		/* 读到第一行有效数据，表明接下来还有多少行有效数据 */
 		if (flag == 0) {
 			flag = 1;
-			
 			rest = atoi(line);
-			data_list = (char **)malloc(sizeof(char *) * rest);
-			if (data_list == NULL) {
-				sprintf(errmsg, "**dd_init** malloc[1] error.");
-				fclose(fd);
-				free(line);
-				return -1;
-			}
-			memset(data_list, 0, sizeof(sizeof(char *) * rest));
 			continue;
 		}
 
 		/* 如果配置文件指定的行数跟实际的有效行数不同 */
-		if (data_index >= rest)
+		if (ds->count >= rest)
 			continue;
 
-		tmp = (char *)malloc(len + 1);
-		if (tmp == NULL) {
-			sprintf(errmsg, "**dd_init** malloc[2] error.");
-			fclose(fd);
-			free(line);
-			return -1;
+		if (ds->count == size) {
+			size = size == 0 ? 64 : size * 2;
+			if ((tmp = realloc(ds->lines, sizeof(int) * size)) == NULL) {
+				sprintf(errmsg, "**dd_open** realloc error.");
+				goto errexit;
+			}
+			ds->lines = tmp;
 		}
-
-		strcpy(tmp, line);
-		data_list[data_index++] = tmp;
+		if ((off = dd_push(ds, line, len, errmsg)) == -1)
+			goto errexit;
+		ds->lines[ds->count++] = off;
 	}
 
 	fclose(fd);
+	fd = NULL;
+	if (dd_resolve(ds, ddpath, store, errmsg) != 0 ||
+			dd_load_manifest(ds, ddpath, errmsg) != 0)
+		goto errexit;
+	free(line);
+	return ds;
+
+errexit:
+	if (fd != NULL)
+		fclose(fd);
 	free(line);
+	dd_close(ds);
+	return NULL;
+}
+
+/*
+ * 局部函数：dd_resolve
+ * 功能：把数据行中的仓库引用转换为仓库中的文件路径，
+ *   把生成程序的相对路径转换为相对于数据目录的路径
+ * 参数：ds为正在打开的数据集，ddpath为布局文件所在的目录，store为仓库目录，
+ *   为NULL则使用@store选项，相对路径相对于ddpath，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：转换后的路径追加到字符串区，原来的数据行不再被引用
+ */
+static int
+dd_resolve(struct dataset *ds, const char *ddpath, const char *store,
+		char *errmsg)
+{
+	int i, off;
+	char dir[PATH_MAX], path[PATH_MAX];
+	const char *entry;
+
+	/* @store选项在字符串区中，追加路径时可能被移动，先得到仓库目录 */
+	if (store == NULL)
+		store = dd_get_option(ds, "store");
+	dir[0] = '\0';
+	if (store != NULL && store[0] != '\0') {
+		if (store[0] == '/')
+			snprintf(dir, PATH_MAX, "%s", store);
+		else
+			snprintf(dir, PATH_MAX, "%s/%s", ddpath, store);
+	}
+
+	for (i = 0; i < ds->count; ++i) {
+		entry = ds->arena + ds->lines[i];
+
+		/* 生成程序："!程序 参数..." */
+		if (entry[0] == '!') {
+			if (entry[1] == '/')
+				continue;
+			if (snprintf(path, PATH_MAX, "!%s/%s", ddpath, entry + 1)
+					>= PATH_MAX) {
+				snprintf(errmsg, ERR_MSG_MAX,
+						"**dd_resolve** %s too long.", entry);
+				return -1;
+			}
+
+		} else if (store_is_ref(entry)) {
+			if (dir[0] == '\0') {
+				snprintf(errmsg, ERR_MSG_MAX,
+						"**dd_resolve** %s: no store.", entry);
+				return -1;
+			}
+			if (store_path(dir, entry, path, errmsg) != 0)
+				return -1;
+
+		} else {
+			continue;
+		}
+
+		if ((off = dd_push(ds, path, strlen(path), errmsg)) == -1)
+			return -1;
+		ds->lines[i] = off;
+	}
 	return 0;
 }
 
 /*
- * 接口函数：dd_end
- * 功能：释放为data_list分配的空间
- * 参数：无
+ * 接口函数：dd_retain
+ * 功能：增加数据集的引用计数，供另一个使用者（例如另一个线程）共享
+ * 参数：ds为已打开的数据集
+ * 返回值：ds
+ * 注意：打开之后数据集是只读的，多个线程可以同时查询，不需要加锁
+ */
+struct dataset *
+dd_retain(struct dataset *ds)
+{
+	__atomic_add_fetch(&ds->refs, 1, __ATOMIC_RELAXED);
+	return ds;
+}
+
+/*
+ * 接口函数：dd_close
+ * 功能：减少数据集的引用计数，最后一个使用者释放全部空间
+ * 参数：ds为数据集，可以为空指针
  * 返回值：无
+ * 注意：之后该使用者不能再使用ds以及从中得到的字符串和清单项
  */
 void
-dd_end()
+dd_close(struct dataset *ds)
 {
-	int i;
-
-	if (data_list == NULL)
+	if (ds == NULL)
+		return;
+	if (__atomic_sub_fetch(&ds->refs, 1, __ATOMIC_ACQ_REL) != 0)
 		return;
 
-	for (i = 0; i < data_index; ++i)
-		free(data_list[i]);
-	free(data_list);
+	free(ds->lines);
+	free(ds->entries);
+	free(ds->arena);
+	free(ds);
 }
 
 /*
  * 接口函数：dd_get_input
  * 功能：获取输入文件的文件名
- * 参数：index为匹配对的序号，每个匹配对由输入和答案文件组成
+ * 参数：ds为数据集，index为匹配对的序号，每个匹配对由输入和答案文件组成
  * 返回值：如果序号有效，则返回字符串指针，否则返回空指针
  */
 const char * 
-dd_get_input(int index)
+dd_get_input(const struct dataset *ds, int index)
 {
-	if (index >= data_index / 2 || index < 0)
+	if (index >= ds->count / 2 || index < 0)
 		return NULL;
-	return data_list[index * 2];
+	return ds->arena + ds->lines[index * 2];
 }
 
 /*
  * 接口函数：dd_get_answer
  * 功能：获取答案文件的文件名
- * 参数：index为匹配对的序号，每个匹配对由输入和答案文件组成
+ * 参数：ds为数据集，index为匹配对的序号，每个匹配对由输入和答案文件组成
  * 返回值：如果序号有效，则返回字符串指针，否则返回空指针
  */
 const char * 
-dd_get_answer(int index)
+dd_get_answer(const struct dataset *ds, int index)
 {
-	if (index >= data_index / 2 || index < 0)
+	if (index >= ds->count / 2 || index < 0)
 		return NULL;
-	return data_list[index * 2 + 1];
+	return ds->arena + ds->lines[index * 2 + 1];
 }
 
 /*
  * 接口函数：dd_get_count
  * 功能：获取输入和答案的匹配对的个数
- * 参数：无
+ * 参数：ds为数据集
  * 返回值：返回匹配对个数
  */
 int
-dd_get_count()
+dd_get_count(const struct dataset *ds)
+{
+	return ds->count / 2;
+}
+
+/*
+ * 接口函数：dd_get_option
+ * 功能：获取data.conf中的题目选项
+ * 参数：ds为数据集，key为选项名，例如"compare"
+ * 返回值：存在则返回选项值，值为空时返回空字符串，不存在返回空指针
+ */
+const char *
+dd_get_option(const struct dataset *ds, const char *key)
+{
+	int i;
+
+	for (i = 0; i < ds->nopt; ++i)
+		if (strcmp(ds->arena + ds->opts[i], key) == 0)
+			return dd_get_option_value(ds, i);
+	return NULL;
+}
+
+/*
+ * 接口函数：dd_get_option_count
+ * 功能：获取data.conf中题目选项的个数
+ * 参数：ds为数据集
+ * 返回值：选项个数
+ */
+int
+dd_get_option_count(const struct dataset *ds)
+{
+	return ds->nopt;
+}
+
+/*
+ * 接口函数：dd_get_option_key
+ * 功能：按出现顺序获取题目选项的键，值由dd_get_option_value获取
+ * 参数：ds为数据集，index为选项序号
+ * 返回值：序号有效返回键，否则返回空指针
+ */
+const char *
+dd_get_option_key(const struct dataset *ds, int index)
+{
+	if (index < 0 || index >= ds->nopt)
+		return NULL;
+	return ds->arena + ds->opts[index];
+}
+
+/*
+ * 接口函数：dd_get_option_value
+ * 功能：按出现顺序获取题目选项的值，用于可以重复出现的选项，例如@subtask
+ * 参数：ds为数据集，index为选项序号
+ * 返回值：序号有效返回值，值为空时返回空字符串，否则返回空指针
+ */
+const char *
+dd_get_option_value(const struct dataset *ds, int index)
+{
+	const char *val;
+
+	if (index < 0 || index >= ds->nopt)
+		return NULL;
+
+	/* 跳过键和值之间的空白 */
+	val = ds->arena + ds->opts[index];
+	val += strlen(val) + 1;
+	while (*val == ' ' || *val == '\t')
+		++val;
+	return val;
+}
+
+/*
+ * 接口函数：dd_get_entry_count
+ * 功能：获取清单中的文件个数
+ * 参数：ds为数据集
+ * 返回值：文件个数，没有清单返回0
+ */
+int
+dd_get_entry_count(const struct dataset *ds)
+{
+	return ds->nentry;
+}
+
+/*
+ * 接口函数：dd_find_entry
+ * 功能：在清单中查找文件
+ * 参数：ds为数据集，path为文件的绝对路径
+ * 返回值：找到返回清单项，否则返回空指针
+ */
+const struct ddentry *
+dd_find_entry(const struct dataset *ds, const char *path)
+{
+	struct ddentry key;
+
+	if (ds->nentry == 0)
+		return NULL;
+	key.path = path;
+	return bsearch(&key, ds->entries, ds->nentry,
+			sizeof(struct ddentry), dd_entry_cmp);
+}
+
+/*
+ * 接口函数：dd_get_digest
+ * 功能：从清单获取文件内容的摘要，不读取文件
+ * 参数：ds为数据集，path为文件路径，hash接收摘要
+ * 返回值：清单中有该文件且大小和修改时间未变返回0，否则返回-1
+ */
+int
+dd_get_digest(const struct dataset *ds, const char *path, unsigned char *hash)
+{
+	const struct ddentry *ent;
+	struct stat st;
+
+	if ((ent = dd_find_entry(ds, path)) == NULL || stat(path, &st) == -1)
+		return -1;
+	if (st.st_size != ent->size || st.st_mtim.tv_sec != ent->mtime_sec ||
+			st.st_mtim.tv_nsec != ent->mtime_nsec)
+		return -1;
+
+	memcpy(hash, ent->hash, HASH_LEN);
+	return 0;
+}
+
+/*
+ * 局部函数：dd_load_manifest
+ * 功能：读取数据目录中的清单文件
+ * 参数：ds为正在打开的数据集，ddpath为数据目录，errmsg接收错误信息
+ * 返回值：成功或没有清单返回0，出错返回-1
+ * 注意：格式不对的行被忽略，清单只用来减少计算摘要；
+ *   这是打开的最后一步，之后字符串区不再移动，清单项中才保存指针
+ */
+static int
+dd_load_manifest(struct dataset *ds, const char *ddpath, char *errmsg)
+{
+	FILE *fd;
+	int i, off, dlen, size = 0;
+	ssize_t len;
+	size_t n = 0;
+	char *line = NULL;
+	char dir[PATH_MAX], file[PATH_MAX], hex[HASH_HEX];
+	struct ddentry *ent;
+	int *offs = NULL, *otmp;	/* 打开过程中各清单项路径的偏移 */
+
+	if (realpath(ddpath, dir) == NULL)
+		return 0;
+	snprintf(file, PATH_MAX, "%s/%s", dir, DD_MANIFEST);
+	if ((fd = fopen(file, "r")) == NULL)
+		return 0;
+	dlen = strlen(dir);
+
+	while ((len = getline(&line, &n, fd)) != -1) {
+		if (line[len - 1] == '\n')
+			line[--len] = '\0';
+
+		/* 扩充清单数组 */
+		if (ds->nentry == size) {
+			size = size == 0 ? 256 : size * 2;
+			ent = realloc(ds->entries, sizeof(struct ddentry) * size);
+			otmp = realloc(offs, sizeof(int) * size);
+			if (ent != NULL)
+				ds->entries = ent;
+			if (otmp != NULL)
+				offs = otmp;
+			if (ent == NULL || otmp == NULL) {
+				sprintf(errmsg, "**dd_load_manifest** realloc error.");
+				goto errexit;
+			}
+		}
+
+		ent = &ds->entries[ds->nentry];
+		off = 0;
+		if (sscanf(line, "%64s %lld %ld.%ld %n", hex, &ent->size,
+					&ent->mtime_sec, &ent->mtime_nsec, &off) != 4 ||
+				off == 0 || line[off] == '\0' ||
+				strchr(line + off, '/') != NULL ||
+				hash_unhex(hex, ent->hash) != 0)
+			continue;
+
+		/* 路径为"数据目录/文件名"，追加到字符串区，过长的忽略 */
+		if (snprintf(file, PATH_MAX, "%s/%s", dir, line + off) >= PATH_MAX)
+			continue;
+		if ((offs[ds->nentry] = dd_push(ds, file, strlen(file), errmsg)) == -1)
+			goto errexit;
+		++ds->nentry;
+	}
+
+	for (i = 0; i < ds->nentry; ++i) {
+		ds->entries[i].path = ds->arena + offs[i];
+		ds->entries[i].name = ds->entries[i].path + dlen + 1;
+	}
+	fclose(fd);
+	free(line);
+	free(offs);
+	qsort(ds->entries, ds->nentry, sizeof(struct ddentry), dd_entry_cmp);
+	return 0;
+
+errexit:
+	ds->nentry = 0;
+	fclose(fd);
+	free(line);
+	free(offs);
+	return -1;
+}
+
+/*
+ * 局部函数：dd_entry_cmp
+ * 功能：按路径比较两个清单项，提供给qsort和bsearch
+ * 参数：a和b为清单项
+ * 返回值：同strcmp
+ */
+static int
+dd_entry_cmp(const void *a, const void *b)
 {
-	return data_index / 2;
+	return strcmp(((const struct ddentry *)a)->path,
+			((const struct ddentry *)b)->path);
 }
 
 /*
@@ -190,17 +552,17 @@ dd_test_print(const char *ddpath)
 {
 	int i;
 	char errmsg[ERR_MSG_MAX];
+	struct dataset *ds;
 
-	if (dd_init(ddpath, errmsg) != 0) {
+	if ((ds = dd_open(ddpath, NULL, errmsg)) == NULL) {
 		printf("%s\n", errmsg);
-		dd_end();
 		return;
 	}	
 
-	for (i = 0; i < dd_get_count(); ++i) {
-		printf("%s\n", dd_get_input(i));
-		printf("%s\n", dd_get_answer(i));
+	for (i = 0; i < dd_get_count(ds); ++i) {
+		printf("%s\n", dd_get_input(ds, i));
+		printf("%s\n", dd_get_answer(ds, i));
 	}
 
-	dd_end();
+	dd_close(ds);
 }
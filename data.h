@@ -2,24 +2,74 @@
  * 文件名：data.h
  * 模块功能：读取输入和答案文件配置，为tester模块服务
  * 版本：v0.1.0
- * 最后修改：2012-08-15
+ * 最后修改：2026-10-18
  **************************************************************/
 #include "global.h"
+#include "store.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
 
 #ifndef DATA_H
 #define DATA_H
 
+/*
+ * 数据目录中由ojdlck生成的清单文件，每行为"<摘要> <大小> <秒>.<纳秒> <文件名>"
+ */
+#define DD_MANIFEST "data.manifest"
+
+/*
+ * 清单中的一个文件
+ */
+struct ddentry
+{
+	const char *path;		/* 数据目录的绝对路径加文件名 */
+	const char *name;		/* path中的文件名部分 */
+	long long size;			/* 文件大小 */
+	long mtime_sec;			/* 修改时间 */
+	long mtime_nsec;
+	unsigned char hash[HASH_LEN];	/* 文件内容的摘要 */
+};
+
+/*
+ * 一个数据目录打开后的数据集，打开之后只读，由引用计数管理
+ * 所有字符串都在一块连续的字符串区中，数据行和选项保存偏移
+ */
+#define DD_OPT_MAX 32
+struct dataset
+{
+	int refs;				/* 引用计数，原子增减 */
+	int count;				/* 有效数据行个数，匹配对个数为count/2 */
+	int *lines;				/* 各数据行在字符串区中的偏移 */
+	int nopt;				/* 选项个数 */
+	int opts[DD_OPT_MAX];	/* 各选项"键\0值"在字符串区中的偏移 */
+	int nentry;				/* 清单中的文件个数 */
+	struct ddentry *entries;	/* 清单，按路径排序，path指向字符串区 */
+	char *arena;			/* 字符串区 */
+	size_t used;			/* 字符串区已使用的长度 */
+	size_t size;			/* 字符串区的大小 */
+};
+
 /*
  * 数据目录相关
  */
-int dd_init(const char *ddpath, char *errmsg);
-void dd_end();
-const char * dd_get_input(int index);
-const char * dd_get_answer(int index);
-int dd_get_count();
+struct dataset * dd_open(const char *ddpath, const char *store, char *errmsg);
+struct dataset * dd_retain(struct dataset *ds);
+void dd_close(struct dataset *ds);
+const char * dd_get_input(const struct dataset *ds, int index);
+const char * dd_get_answer(const struct dataset *ds, int index);
+int dd_get_count(const struct dataset *ds);
+const char * dd_get_option(const struct dataset *ds, const char *key);
+int dd_get_option_count(const struct dataset *ds);
+const char * dd_get_option_key(const struct dataset *ds, int index);
+const char * dd_get_option_value(const struct dataset *ds, int index);
+int dd_get_entry_count(const struct dataset *ds);
+const struct ddentry * dd_find_entry(const struct dataset *ds,
+		const char *path);
+int dd_get_digest(const struct dataset *ds, const char *path,
+		unsigned char *hash);
 
 #endif
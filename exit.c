@@ -1,58 +1,174 @@
 /*************************************************
  * 源文件：exit.c
  * 版本：v0.1.0
- * 最后修改：2012-08-18
+ * 最后修改：2026-10-18
  ************************************************/
 #include "exit.h"
 
 /*
- * 接口函数：exit_func
+ * 接口函数：exit_init
+ * 功能：初始化一个结果，没有附加行
+ * 参数：res为待初始化的结果
+ * 返回值：无
+ */
+void
+exit_init(struct result *res)
+{
+	res->code = EXIT_IE;
+	res->time = 0;
+	res->memory = 0;
+	res->msg[0] = '\0';
+	res->extra_len = 0;
+	res->extra[0] = '\0';
+}
+
+/*
+ * 接口函数：exit_extra
+ * 功能：登记一行附加信息，在结果之后输出
+ * 参数：res为结果，fmt和后面的参数同printf，不需要换行符
+ * 返回值：无
+ * 注意：缓冲区满了之后的附加行被丢弃
+ */
+void
+exit_extra(struct result *res, const char *fmt, ...)
+{
+	int n;
+	va_list ap;
+
+	if (res->extra_len >= EXTRA_MAX - 1)
+		return;
+
+	va_start(ap, fmt);
+	n = vsnprintf(res->extra + res->extra_len,
+			EXTRA_MAX - res->extra_len - 1, fmt, ap);
+	va_end(ap);
+
+	/* 被截断的行也只保留能放下的部分 */
+	if (n < 0)
+		return;
+	if (n > EXTRA_MAX - res->extra_len - 2)
+		n = EXTRA_MAX - res->extra_len - 2;
+	res->extra_len += n;
+	res->extra[res->extra_len++] = '\n';
+	res->extra[res->extra_len] = '\0';
+}
+
+/*
+ * 接口函数：exit_format
+ * 功能：把结果格式化为命令行程序的输出
+ * 参数：res为结果，buf和len为输出缓冲区
+ * 返回值：写入的长度，不包括结尾的'\0'
+ * 注意：第一行为状态码，第二行为结果名称，之后按状态不同为时间和内存，
+ *   或者一行信息，最后是附加行
+ */
+int
+exit_format(const struct result *res, char *buf, int len)
+{
+	int n;
+
+	switch (res->code) {
+		/* 有时间和内存 */
+		case EXIT_AC :	n = snprintf(buf, len, "%d\nAccepted\n%dms\n%dkb\n",
+								res->code, res->time, res->memory);
+						break;
+
+		/* 只有名称 */
+		case EXIT_PE :	n = snprintf(buf, len, "%d\nPresentation Error\n",
+								res->code);
+						break;
+		case EXIT_WA :	n = snprintf(buf, len, "%d\nWrong Answer\n",
+								res->code);
+						break;
+		case EXIT_TLE :	n = snprintf(buf, len, "%d\nTime Limit Exceeded\n",
+								res->code);
+						break;
+		case EXIT_MLE :	n = snprintf(buf, len, "%d\nMemory Limit Exceeded\n",
+								res->code);
+						break;
+		case EXIT_OLE :	n = snprintf(buf, len, "%d\nOutput Limit Exceeded\n",
+								res->code);
+						break;
+
+		/* 有一行信息 */
+		case EXIT_IE :	n = snprintf(buf, len, "%d\nInternal Error\n%s\n",
+								res->code, res->msg);
+						break;
+		case EXIT_EE :	n = snprintf(buf, len, "%d\nExternal Error\n%s\n",
+								res->code, res->msg);
+						break;
+		case EXIT_CE :	n = snprintf(buf, len, "%d\nCompile Error\n%s\n",
+								res->code, res->msg);
+						break;
+		case EXIT_RE1 :
+		case EXIT_RE2 :	n = snprintf(buf, len, "%d\nRuntime Error\n%s\n",
+								res->code, res->msg);
+						break;
+
+		/* 未知的状态只有状态码 */
+		default :		n = snprintf(buf, len, "%d\n", res->code);
+						break;
+	}
+	if (n >= len)
+		return len - 1;
+
+	/* 附加行在结果之后输出，不影响原有的输出格式 */
+	n += snprintf(buf + n, len - n, "%s", res->extra);
+	return n < len ? n : len - 1;
+}
+
+/*
+ * 接口函数：exit_result
  * 功能：打印结果，退出程序
- * 参数：code表明退出状态，根据不同的状态，提取不同的参数
+ * 参数：res为结果
  * 返回值：无
  * 注意：应该先判断程序的退出值，0表示正常退出，否则出现了不可预知的错误
  */
 void
+exit_result(const struct result *res)
+{
+	static char buf[ERR_MSG_MAX + EXTRA_MAX + 128];
+
+	exit_format(res, buf, sizeof(buf));
+	fputs(buf, stdout);
+
+	/* 退出值为0表明程序正常退出 */
+	exit(0);
+}
+
+/*
+ * 接口函数：exit_func
+ * 功能：打印没有附加行的结果，退出程序
+ * 参数：code表明退出状态，AC时后面是时间和内存，
+ *   IE，EE，CE和RE时后面是一行信息
+ * 返回值：无
+ * 注意：用于评测开始之前的错误，例如参数错误
+ */
+void
 exit_func(enum estatus code, ...)
 {
-	int time, memory;
-	const char *msg;
+	static struct result res;
 	va_list ap;
 
-	printf("%d\n", code);
+	exit_init(&res);
+	res.code = code;
 
 	va_start(ap, code);
 	switch (code) {
-		/* 有三个参数 */
-		case EXIT_AC :		printf("Accepted\n");
-							time = va_arg(ap, int);
-							memory = va_arg(ap, int);
-							printf("%dms\n%dkb\n", time, memory);
-							break;
-
-		/* 只有一个参数 */
-		case EXIT_PE : 		printf("Presentation Error\n"); 	break;
-		case EXIT_WA :		printf("Wrong Answer\n"); 			break;
-		case EXIT_TLE :		printf("Time Limit Exceeded\n"); 	break;
-		case EXIT_MLE :		printf("Memory Limit Exceeded\n"); 	break;
-		case EXIT_OLE : 	printf("Output Limit Exceeded\n"); 	break;
-
-		/* 有两个参数 */
-		case EXIT_IE :		printf("Internal Error\n%s\n",
-									va_arg(ap, char *));
-							break;
-		case EXIT_EE :		printf("External Error\n%s\n",
-									va_arg(ap, char *));
-							break;
-		case EXIT_RE1 :		printf("Runtime Error\n%s\n",
-									va_arg(ap, char *));
-							break;
-		case EXIT_RE2 :		printf("Runtime Error\n%s\n",
-									va_arg(ap, char *));
-							break;
+		case EXIT_AC :	res.time = va_arg(ap, int);
+						res.memory = va_arg(ap, int);
+						break;
+
+		case EXIT_IE :
+		case EXIT_EE :
+		case EXIT_CE :
+		case EXIT_RE1 :
+		case EXIT_RE2 :	snprintf(res.msg, ERR_MSG_MAX, "%s",
+								va_arg(ap, char *));
+						break;
+
+		default :		break;
 	}
 	va_end(ap);
 
-	/* 退出值为0表明程序正常退出 */
-	exit(0);
+	exit_result(&res);
 }
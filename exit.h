@@ -1,8 +1,9 @@
 /***************************************************************
  * 文件名：exit.h
- * 模块功能：打印结果并退出程序，模块提供的函数是程序的唯一出口
+ * 模块功能：评测结果及其输出；库函数把结果填入struct result，
+ *   exit_result打印结果并退出程序，是命令行程序的唯一出口
  * 版本：v0.1.0
- * 最后修改：2012-08-15
+ * 最后修改：2026-10-18
  **************************************************************/
 #include "global.h"
 #include <stdio.h>
@@ -12,6 +13,28 @@
 #ifndef EXIT_H
 #define EXIT_H
 
+/*
+ * 附加信息缓冲区的长度
+ */
+#define EXTRA_MAX 16384
+
+/*
+ * 一次评测的结果
+ */
+struct result
+{
+	enum estatus code;
+	int time;				/* 结果为AC时的时间，单位毫秒 */
+	int memory;				/* 结果为AC时的内存，单位kb */
+	char msg[ERR_MSG_MAX];	/* IE，EE，CE和RE的信息 */
+	int extra_len;			/* extra中已使用的长度 */
+	char extra[EXTRA_MAX];	/* 在结果之后输出的附加行，每行以换行符结束 */
+};
+
+void exit_init(struct result *res);
+void exit_extra(struct result *res, const char *fmt, ...);
+int exit_format(const struct result *res, char *buf, int len);
+void exit_result(const struct result *res);
 void exit_func(enum estatus code, ...);
 
 #endif
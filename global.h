@@ -32,6 +32,7 @@ enum estatus
 
 	EXIT_IE,		/* 程序内部错误					  */
 	EXIT_EE,		/* 程序外部错误，如配置错误		  */
+	EXIT_CE,		/* 编译错误，只在有编译阶段时出现	  */
 };
 
 #endif
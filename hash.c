@@ -0,0 +1,257 @@
+/*************************************************
+ * 源文件：hash.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "hash.h"
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/*
+ * 局部函数声明
+ */
+static void hash_block(struct hashctx *ctx, const unsigned char *blk);
+
+/*
+ * 局部数据：hash_k
+ * 作用：SHA-256的轮常量
+ */
+static const uint32_t hash_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/*
+ * 接口函数：hash_init
+ * 功能：初始化摘要计算的中间状态
+ * 参数：ctx为中间状态
+ * 返回值：无
+ */
+void
+hash_init(struct hashctx *ctx)
+{
+	ctx->state[0] = 0x6a09e667;
+	ctx->state[1] = 0xbb67ae85;
+	ctx->state[2] = 0x3c6ef372;
+	ctx->state[3] = 0xa54ff53a;
+	ctx->state[4] = 0x510e527f;
+	ctx->state[5] = 0x9b05688c;
+	ctx->state[6] = 0x1f83d9ab;
+	ctx->state[7] = 0x5be0cd19;
+	ctx->bytes = 0;
+	ctx->used = 0;
+}
+
+/*
+ * 接口函数：hash_update
+ * 功能：把一段数据加入摘要计算
+ * 参数：ctx为中间状态，data和len为数据及其长度
+ * 返回值：无
+ */
+void
+hash_update(struct hashctx *ctx, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	size_t n;
+
+	ctx->bytes += len;
+
+	/* 先补满上次剩余的不完整块 */
+	if (ctx->used > 0) {
+		n = 64 - ctx->used < len ? 64 - ctx->used : len;
+		memcpy(ctx->buf + ctx->used, p, n);
+		ctx->used += n;
+		p += n;
+		len -= n;
+		if (ctx->used < 64)
+			return;
+		hash_block(ctx, ctx->buf);
+		ctx->used = 0;
+	}
+
+	for (; len >= 64; p += 64, len -= 64)
+		hash_block(ctx, p);
+
+	memcpy(ctx->buf, p, len);
+	ctx->used = len;
+}
+
+/*
+ * 接口函数：hash_final
+ * 功能：结束摘要计算，输出HASH_LEN个字节的摘要
+ * 参数：ctx为中间状态，out接收摘要
+ * 返回值：无
+ */
+void
+hash_final(struct hashctx *ctx, unsigned char *out)
+{
+	int i;
+	uint64_t bits = ctx->bytes * 8;
+
+	ctx->buf[ctx->used++] = 0x80;
+	if (ctx->used > 56) {
+		memset(ctx->buf + ctx->used, 0, 64 - ctx->used);
+		hash_block(ctx, ctx->buf);
+		ctx->used = 0;
+	}
+	memset(ctx->buf + ctx->used, 0, 56 - ctx->used);
+	for (i = 0; i < 8; ++i)
+		ctx->buf[56 + i] = bits >> (56 - i * 8);
+	hash_block(ctx, ctx->buf);
+
+	for (i = 0; i < 8; ++i) {
+		out[i * 4] = ctx->state[i] >> 24;
+		out[i * 4 + 1] = ctx->state[i] >> 16;
+		out[i * 4 + 2] = ctx->state[i] >> 8;
+		out[i * 4 + 3] = ctx->state[i];
+	}
+}
+
+/*
+ * 接口函数：hash_file
+ * 功能：计算一个文件内容的摘要
+ * 参数：path为文件路径，out接收摘要，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ */
+int
+hash_file(const char *path, unsigned char *out, char *errmsg)
+{
+	int fd, n;
+	char buf[65536];
+	struct hashctx ctx;
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**hash_file** open %s error: %s", path, strerror(errno));
+		return -1;
+	}
+
+	hash_init(&ctx);
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+		hash_update(&ctx, buf, n);
+	if (n == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**hash_file** read %s error: %s", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	close(fd);
+	hash_final(&ctx, out);
+	return 0;
+}
+
+/*
+ * 接口函数：hash_hex
+ * 功能：把摘要转换为小写十六进制字符串
+ * 参数：hash为摘要，hex接收字符串，长度至少为HASH_HEX
+ * 返回值：无
+ */
+void
+hash_hex(const unsigned char *hash, char *hex)
+{
+	int i;
+	static const char digits[] = "0123456789abcdef";
+
+	for (i = 0; i < HASH_LEN; ++i) {
+		hex[i * 2] = digits[hash[i] >> 4];
+		hex[i * 2 + 1] = digits[hash[i] & 0xf];
+	}
+	hex[HASH_LEN * 2] = '\0';
+}
+
+/*
+ * 接口函数：hash_unhex
+ * 功能：把64位小写十六进制字符串转换为摘要
+ * 参数：hex为字符串，可以更长，只转换前64个字符，hash接收摘要
+ * 返回值：成功返回0，有非法字符返回-1
+ */
+int
+hash_unhex(const char *hex, unsigned char *hash)
+{
+	int i, v, c;
+
+	for (i = 0; i < HASH_LEN * 2; ++i) {
+		c = hex[i];
+		if (c >= '0' && c <= '9')
+			v = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			v = c - 'a' + 10;
+		else
+			return -1;
+
+		if (i % 2 == 0)
+			hash[i / 2] = v << 4;
+		else
+			hash[i / 2] |= v;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：hash_block
+ * 功能：处理一个64字节的数据块
+ * 参数：ctx为中间状态，blk为数据块
+ * 返回值：无
+ */
+static void
+hash_block(struct hashctx *ctx, const unsigned char *blk)
+{
+	int i;
+	uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+
+	for (i = 0; i < 16; ++i)
+		w[i] = (uint32_t)blk[i * 4] << 24 | (uint32_t)blk[i * 4 + 1] << 16 |
+			(uint32_t)blk[i * 4 + 2] << 8 | blk[i * 4 + 3];
+	for (i = 16; i < 64; ++i)
+		w[i] = w[i - 16] + w[i - 7] +
+			(ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+			(ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10));
+
+	a = ctx->state[0];
+	b = ctx->state[1];
+	c = ctx->state[2];
+	d = ctx->state[3];
+	e = ctx->state[4];
+	f = ctx->state[5];
+	g = ctx->state[6];
+	h = ctx->state[7];
+
+	for (i = 0; i < 64; ++i) {
+		t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) +
+			((e & f) ^ (~e & g)) + hash_k[i] + w[i];
+		t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) +
+			((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	ctx->state[0] += a;
+	ctx->state[1] += b;
+	ctx->state[2] += c;
+	ctx->state[3] += d;
+	ctx->state[4] += e;
+	ctx->state[5] += f;
+	ctx->state[6] += g;
+	ctx->state[7] += h;
+}
@@ -0,0 +1,42 @@
+/***************************************************************
+ * 文件名：hash.h
+ * 模块功能：计算数据和文件内容的SHA-256摘要
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifndef HASH_H
+#define HASH_H
+
+/*
+ * 摘要的字节数和十六进制字符串长度（含结束符）
+ */
+#define HASH_LEN 32
+#define HASH_HEX (HASH_LEN * 2 + 1)
+
+/*
+ * 计算摘要的中间状态
+ */
+struct hashctx
+{
+	uint32_t state[8];
+	uint64_t bytes;			/* 已处理的总字节数 */
+	unsigned char buf[64];	/* 未满一块的数据 */
+	size_t used;			/* buf中的字节数 */
+};
+
+void hash_init(struct hashctx *ctx);
+void hash_update(struct hashctx *ctx, const void *data, size_t len);
+void hash_final(struct hashctx *ctx, unsigned char *out);
+int hash_file(const char *path, unsigned char *out, char *errmsg);
+void hash_hex(const unsigned char *hash, char *hex);
+int hash_unhex(const char *hex, unsigned char *hash);
+
+#endif
@@ -0,0 +1,487 @@
+/*************************************************
+ * 源文件：host.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "host.h"
+
+/*
+ * 类别的名称，与enum hostclass对应
+ */
+static const char *host_names[HOST_CLASSES] = {
+	"contest", "practice", "rejudge"
+};
+
+/*
+ * 局部函数声明
+ */
+static int host_sibling(int cpu, const unsigned long *allowed);
+static int host_isset(const unsigned long *mask, int cpu);
+static long host_available(void);
+static struct hostjob ** host_pick(struct host *h, struct hostjob **head);
+static long host_waited(const struct hostjob *job, const struct timespec *now);
+static int host_percentile(struct host *h, int cls, int p);
+static int host_cmpint(const void *a, const void *b);
+static int host_present(const char *path);
+
+/*
+ * 接口函数：host_init
+ * 功能：清点本进程可用的CPU，划分测量核和杂务核
+ * 参数：h为待初始化的调度器，nhk为杂务核（物理核）的个数，
+ *   policy为同一类别内的排队策略，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：同一物理核上的超线程算一个核；前nhk个物理核的全部线程为杂务核，
+ *   运行评测程序、检查程序和编译器；其余每个物理核只用第一个线程测量
+ *   用户程序，其他线程空闲，避免超线程之间的干扰；
+ *   物理核不多于nhk个时测量核与杂务核重叠，计时不再隔离
+ */
+int
+host_init(struct host *h, int nhk, enum hostpolicy policy, char *errmsg)
+{
+	unsigned long allowed[HOST_CPU_WORDS];
+	int phys[HOST_CPU_MAX], rep[HOST_CPU_MAX];
+	int cpu, i, nphys = 0, bits = 8 * sizeof(unsigned long);
+
+	memset(h, 0, sizeof(struct host));
+	h->policy = policy;
+	memset(allowed, 0, sizeof(allowed));
+	if (syscall(SYS_sched_getaffinity, 0, sizeof(allowed), allowed) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**host_init** sched_getaffinity error: %s", strerror(errno));
+		return -1;
+	}
+
+	/* 每个物理核以其中编号最小的可用线程代表 */
+	for (cpu = 0; cpu < HOST_CPU_MAX; ++cpu) {
+		if (!host_isset(allowed, cpu))
+			continue;
+		rep[cpu] = host_sibling(cpu, allowed);
+		if (rep[cpu] == cpu)
+			phys[nphys++] = cpu;
+	}
+	if (nphys == 0) {
+		snprintf(errmsg, ERR_MSG_MAX, "**host_init** no cpu.");
+		return -1;
+	}
+
+	if (nhk < 1)
+		nhk = 1;
+	if (nphys <= nhk) {
+		h->shared = 1;
+		memcpy(h->hkmask, allowed, sizeof(allowed));
+		for (i = 0; i < nphys; ++i)
+			h->cores[h->ncore++] = phys[i];
+		return 0;
+	}
+
+	for (cpu = 0; cpu < HOST_CPU_MAX; ++cpu) {
+		if (!host_isset(allowed, cpu))
+			continue;
+		for (i = 0; i < nhk; ++i)
+			if (rep[cpu] == phys[i])
+				h->hkmask[cpu / bits] |= 1UL << (cpu % bits);
+	}
+	for (i = nhk; i < nphys; ++i)
+		h->cores[h->ncore++] = phys[i];
+
+	return 0;
+}
+
+/*
+ * 接口函数：host_parse
+ * 功能：解析一个评测请求
+ * 参数：job接收结果，line为请求行"<类别> <moj的参数>..."，errmsg接收错误信息
+ * 返回值：成功返回0，格式错误返回-1
+ * 注意：申报的内存取-m，有--src时取-m和--cm的较大者，再加上HOST_JOB_MEMORY；
+ *   预计耗时取--stats目录中该题目的历史平均，没有则为HOST_COST_DEFAULT；
+ *   --cpu和--calibration由mojd决定，请求中不能出现
+ */
+int
+host_parse(struct hostjob *job, const char *line, char *errmsg)
+{
+	char *tok;
+	long memory = -1, cmemory = COMPILE_MEMORY;
+	const char *stats = NULL, *datadir = NULL;
+	int i, src = 0;
+
+	snprintf(job->line, HOST_LINE, "%s", line);
+	job->argc = 0;
+	job->pid = -1;
+	job->core = -1;
+	job->next = NULL;
+
+	if ((tok = strtok(job->line, " \t\r\n")) == NULL) {
+		snprintf(errmsg, ERR_MSG_MAX, "**host_parse** empty request.");
+		return -1;
+	}
+	for (i = 0; i < HOST_CLASSES; ++i)
+		if (strcmp(tok, host_names[i]) == 0)
+			break;
+	if (i == HOST_CLASSES) {
+		snprintf(errmsg, ERR_MSG_MAX, "**host_parse** bad class %s", tok);
+		return -1;
+	}
+	job->cls = i;
+
+	while ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+		if (job->argc == HOST_ARGS - 1) {
+			snprintf(errmsg, ERR_MSG_MAX, "**host_parse** too many arguments.");
+			return -1;
+		}
+		job->argv[job->argc++] = tok;
+	}
+	job->argv[job->argc] = NULL;
+
+	for (i = 0; i < job->argc; ++i) {
+		if (strcmp(job->argv[i], "--cpu") == 0 ||
+				strcmp(job->argv[i], "--calibration") == 0) {
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**host_parse** %s is reserved.", job->argv[i]);
+			return -1;
+		}
+		if (strcmp(job->argv[i], "--src") == 0)
+			src = 1;
+		if (i + 1 < job->argc && strcmp(job->argv[i], "-m") == 0)
+			memory = atol(job->argv[i + 1]);
+		if (i + 1 < job->argc && strcmp(job->argv[i], "--cm") == 0)
+			cmemory = atol(job->argv[i + 1]);
+		if (i + 1 < job->argc && strcmp(job->argv[i], "--stats") == 0)
+			stats = job->argv[i + 1];
+		if (i + 1 < job->argc && strcmp(job->argv[i], "--datadir") == 0)
+			datadir = job->argv[i + 1];
+	}
+	if (memory <= 0) {
+		snprintf(errmsg, ERR_MSG_MAX, "**host_parse** no -m argument.");
+		return -1;
+	}
+
+	job->memory = (src && cmemory > memory ? cmemory : memory) +
+		HOST_JOB_MEMORY;
+	job->cost = -1;
+	if (stats != NULL && datadir != NULL)
+		job->cost = order_expect(stats, datadir);
+	if (job->cost < 0)
+		job->cost = HOST_COST_DEFAULT;
+	clock_gettime(CLOCK_MONOTONIC, &job->arrive);
+	return 0;
+}
+
+/*
+ * 接口函数：host_submit
+ * 功能：把评测加入其类别的等待队列末尾
+ * 参数：h为调度器，job为host_parse解析过的评测
+ * 返回值：无
+ */
+void
+host_submit(struct host *h, struct hostjob *job)
+{
+	struct hostjob **pp;
+
+	for (pp = &h->queue[job->cls]; *pp != NULL; pp = &(*pp)->next)
+		;
+	job->next = NULL;
+	*pp = job;
+}
+
+/*
+ * 接口函数：host_next
+ * 功能：选出下一个可以启动的评测，分配测量核并预留内存
+ * 参数：h为调度器
+ * 返回值：可以启动的评测，已经从队列中取出；没有则返回NULL
+ * 注意：只考虑优先级最高的类别中的一个评测，FIFO策略下为最早到达的，
+ *   SEJF策略下见host_pick；内存不够时等待，
+ *   不让后面较小的评测插队，大的评测不会饿死；
+ *   预留按申报的内存计算，MemAvailable中已经包括运行中评测的实际使用，
+ *   两者重复计算，是保守的；没有运行中的评测时总是允许，避免永远等待
+ */
+struct hostjob *
+host_next(struct host *h)
+{
+	struct hostjob *job, **pp = NULL;
+	struct timespec now;
+	int i, core = -1;
+
+	for (i = 0; i < h->ncore && core == -1; ++i)
+		if (!h->busy[i])
+			core = i;
+	if (core == -1)
+		return NULL;
+
+	for (i = 0; i < HOST_CLASSES && pp == NULL; ++i)
+		if (h->queue[i] != NULL)
+			pp = host_pick(h, &h->queue[i]);
+	if (pp == NULL)
+		return NULL;
+	job = *pp;
+
+	if (h->running > 0 && host_available() - h->reserved -
+			HOST_MEM_RESERVE < job->memory)
+		return NULL;
+
+	*pp = job->next;
+	job->next = NULL;
+	job->core = core;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	h->lat[job->cls][h->nlat[job->cls]++ % HOST_LAT_SAMPLES] =
+		host_waited(job, &now);
+	h->busy[core] = 1;
+	h->reserved += job->memory;
+	++h->running;
+	return job;
+}
+
+/*
+ * 接口函数：host_release
+ * 功能：评测结束，归还测量核和内存
+ * 参数：h为调度器，job为host_next返回的评测
+ * 返回值：无
+ */
+void
+host_release(struct host *h, struct hostjob *job)
+{
+	h->busy[job->core] = 0;
+	h->reserved -= job->memory;
+	--h->running;
+	job->core = -1;
+}
+
+/*
+ * 接口函数：host_status
+ * 功能：输出调度器的状态
+ * 参数：h为调度器，buf和len为输出缓冲区
+ * 返回值：写入的长度
+ * 注意：排队延迟为最近HOST_LAT_SAMPLES个启动的评测从到达到启动的时间
+ */
+int
+host_status(struct host *h, char *buf, int len)
+{
+	struct hostjob *job;
+	int i, n, waiting[HOST_CLASSES];
+
+	for (i = 0; i < HOST_CLASSES; ++i)
+		for (waiting[i] = 0, job = h->queue[i]; job != NULL; job = job->next)
+			++waiting[i];
+
+	n = snprintf(buf, len, "cores %d running %d shared %d\n"
+			"memory reserved %ld available %ld\n"
+			"queue %s %d %s %d %s %d\n",
+			h->ncore, h->running, h->shared,
+			h->reserved, host_available(),
+			host_names[HOST_CONTEST], waiting[HOST_CONTEST],
+			host_names[HOST_PRACTICE], waiting[HOST_PRACTICE],
+			host_names[HOST_REJUDGE], waiting[HOST_REJUDGE]);
+	for (i = 0; i < HOST_CLASSES && n < len; ++i)
+		n += snprintf(buf + n, len - n, "latency %s p50 %d p99 %d n %ld\n",
+				host_names[i], host_percentile(h, i, 50),
+				host_percentile(h, i, 99), h->nlat[i]);
+	return n < len ? n : len - 1;
+}
+
+/*
+ * 接口函数：host_probe
+ * 功能：回答协调器的探测，给出题目数据是否在本机以及负载
+ * 参数：h为调度器，datadir为题目数据目录，为NULL则只给出负载，
+ *   store为数据仓库目录，可以为NULL，buf和len为输出缓冲区
+ * 返回值：写入的长度
+ * 注意：输出一行"probe cases <组数> present <本机具备的组数>
+ *   running <运行数> waiting <等待数> cores <测量核数>"；
+ *   一组测试的输入和答案文件都可读才算具备，生成的数据看生成程序；
+ *   读不了data.conf时组数为0
+ */
+int
+host_probe(struct host *h, const char *datadir, const char *store,
+		char *buf, int len)
+{
+	struct hostjob *job;
+	struct dataset *ds;
+	char errmsg[ERR_MSG_MAX];
+	int i, n, cases = 0, present = 0, waiting = 0;
+
+	if (datadir != NULL) {
+		if ((ds = dd_open(datadir, store, errmsg)) != NULL) {
+			cases = dd_get_count(ds);
+			for (i = 0; i < cases; ++i)
+				present += host_present(dd_get_input(ds, i)) &&
+					host_present(dd_get_answer(ds, i));
+			dd_close(ds);
+		}
+	}
+	for (i = 0; i < HOST_CLASSES; ++i)
+		for (job = h->queue[i]; job != NULL; job = job->next)
+			++waiting;
+
+	n = snprintf(buf, len, "probe cases %d present %d running %d "
+			"waiting %d cores %d\n",
+			cases, present, h->running, waiting, h->ncore);
+	return n < len ? n : len - 1;
+}
+
+/*
+ * 局部函数：host_pick
+ * 功能：在一个类别的等待队列中选出下一个评测
+ * 参数：h为调度器，head为非空的等待队列
+ * 返回值：指向选中评测的指针，即它的前一个评测的next或者队列头
+ * 注意：SEJF策略下选预计耗时减去已等待时间乘以HOST_AGING最小的，
+ *   轻的题目不再被排在前面的重题挡住；等待越久越靠前，重题不会饿死；
+ *   相等时选先到达的
+ */
+static struct hostjob **
+host_pick(struct host *h, struct hostjob **head)
+{
+	struct hostjob **pp, **best = head;
+	struct timespec now;
+	long score, min = 0;
+
+	if (h->policy == HOST_FIFO)
+		return head;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for (pp = head; *pp != NULL; pp = &(*pp)->next) {
+		score = (*pp)->cost - host_waited(*pp, &now) * HOST_AGING;
+		if (pp == head || score < min) {
+			min = score;
+			best = pp;
+		}
+	}
+	return best;
+}
+
+/*
+ * 局部函数：host_waited
+ * 功能：计算评测已经等待的时间
+ * 参数：job为评测，now为当前的CLOCK_MONOTONIC时间
+ * 返回值：等待的毫秒数
+ */
+static long
+host_waited(const struct hostjob *job, const struct timespec *now)
+{
+	return (now->tv_sec - job->arrive.tv_sec) * 1000 +
+		(now->tv_nsec - job->arrive.tv_nsec) / 1000000;
+}
+
+/*
+ * 局部函数：host_percentile
+ * 功能：计算一个类别最近的排队延迟的分位数
+ * 参数：h为调度器，cls为类别，p为百分位
+ * 返回值：延迟，单位毫秒；没有启动过评测返回0
+ */
+static int
+host_percentile(struct host *h, int cls, int p)
+{
+	int sorted[HOST_LAT_SAMPLES];
+	int n = h->nlat[cls] < HOST_LAT_SAMPLES ? h->nlat[cls] : HOST_LAT_SAMPLES;
+
+	if (n == 0)
+		return 0;
+	memcpy(sorted, h->lat[cls], sizeof(int) * n);
+	qsort(sorted, n, sizeof(int), host_cmpint);
+	return sorted[(n - 1) * p / 100];
+}
+
+/*
+ * 局部函数：host_cmpint
+ * 功能：qsort使用的整数比较函数
+ * 参数：a和b指向两个整数
+ * 返回值：a小于、等于、大于b分别返回负数、0、正数
+ */
+static int
+host_cmpint(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * 局部函数：host_present
+ * 功能：判断一个数据文件在本机是否可读
+ * 参数：path为data.conf中的数据行，以'!'开头时为生成程序和参数
+ * 返回值：可读返回1，否则返回0
+ */
+static int
+host_present(const char *path)
+{
+	char prog[PATH_MAX];
+
+	if (path[0] != '!')
+		return access(path, R_OK) == 0;
+	snprintf(prog, PATH_MAX, "%s", path + 1);
+	prog[strcspn(prog, " \t")] = '\0';
+	return access(prog, R_OK) == 0;
+}
+
+/*
+ * 局部函数：host_sibling
+ * 功能：找出与cpu同一物理核的可用线程中编号最小的
+ * 参数：cpu为CPU编号，allowed为可用CPU的掩码
+ * 返回值：线程的编号，读不到拓扑时返回cpu本身
+ */
+static int
+host_sibling(int cpu, const unsigned long *allowed)
+{
+	char path[PATH_MAX], list[256], *p;
+	FILE *fp;
+	int lo, hi, c, min = cpu;
+
+	snprintf(path, PATH_MAX,
+			"/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+	if ((fp = fopen(path, "r")) == NULL)
+		return cpu;
+	if (fgets(list, sizeof(list), fp) == NULL) {
+		fclose(fp);
+		return cpu;
+	}
+	fclose(fp);
+
+	/* 格式为"0,4"或者"0-1" */
+	for (p = list; *p != '\0'; ) {
+		if (!isdigit((unsigned char)*p)) {
+			++p;
+			continue;
+		}
+		lo = hi = strtol(p, &p, 10);
+		if (*p == '-')
+			hi = strtol(p + 1, &p, 10);
+		for (c = lo; c <= hi && c < HOST_CPU_MAX; ++c)
+			if (c < min && host_isset(allowed, c))
+				min = c;
+	}
+	return min;
+}
+
+/*
+ * 局部函数：host_isset
+ * 功能：判断CPU是否在掩码中
+ * 参数：mask为掩码，cpu为CPU编号
+ * 返回值：在返回1，不在返回0
+ */
+static int
+host_isset(const unsigned long *mask, int cpu)
+{
+	int bits = 8 * sizeof(unsigned long);
+
+	return (mask[cpu / bits] >> (cpu % bits)) & 1;
+}
+
+/*
+ * 局部函数：host_available
+ * 功能：读取系统的可用内存
+ * 参数：无
+ * 返回值：/proc/meminfo中的MemAvailable，单位kb，读不到返回0
+ */
+static long
+host_available(void)
+{
+	char line[256];
+	long kb = 0;
+	FILE *fp;
+
+	if ((fp = fopen("/proc/meminfo", "r")) == NULL)
+		return 0;
+	while (fgets(line, sizeof(line), fp) != NULL)
+		if (sscanf(line, "MemAvailable: %ld", &kb) == 1)
+			break;
+	fclose(fp);
+	return kb;
+}
@@ -0,0 +1,121 @@
+/***************************************************************
+ * 文件名：host.h
+ * 模块功能：评测机的调度器，管理CPU核和内存，
+ *   按优先级排队并决定何时启动哪个评测，统计排队延迟，由mojd使用
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include "compile.h"
+#include "order.h"
+#include "data.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#ifndef HOST_H
+#define HOST_H
+
+/*
+ * 支持的最大CPU编号和对应的掩码长度
+ */
+#define HOST_CPU_MAX 1024
+#define HOST_CPU_WORDS (HOST_CPU_MAX / (8 * sizeof(unsigned long)))
+
+/*
+ * 一个评测请求的最大长度和参数个数
+ */
+#define HOST_LINE 4096
+#define HOST_ARGS 128
+
+/*
+ * 评测程序和检查程序等在用户程序之外使用的内存，
+ *   以及始终留给系统的内存，单位kb
+ */
+#define HOST_JOB_MEMORY 65536
+#define HOST_MEM_RESERVE 262144
+
+/*
+ * 没有历史统计的题目的预计耗时，以及等待时间抵消预计耗时的比例，单位毫秒；
+ *   等待1毫秒抵消HOST_AGING毫秒，重题不会饿死
+ */
+#define HOST_COST_DEFAULT 2000
+#define HOST_AGING 1
+
+/*
+ * 每个类别保留的最近排队延迟的个数，用于计算分位数
+ */
+#define HOST_LAT_SAMPLES 1024
+
+/*
+ * 同一类别内的排队策略
+ */
+enum hostpolicy
+{
+	HOST_FIFO,				/* 按到达顺序 */
+	HOST_SEJF				/* 预计耗时减去已等待时间最小的优先 */
+};
+
+/*
+ * 评测的类别，数值小的优先
+ */
+enum hostclass
+{
+	HOST_CONTEST,
+	HOST_PRACTICE,
+	HOST_REJUDGE,
+	HOST_CLASSES
+};
+
+/*
+ * 一个评测，参数转交给moj
+ */
+struct hostjob
+{
+	int fd;					/* 客户端连接，moj的输出写回这里 */
+	enum hostclass cls;		/* 类别 */
+	long memory;			/* 申报的内存，单位kb */
+	long cost;				/* 预计耗时，单位毫秒 */
+	int argc;
+	char *argv[HOST_ARGS];	/* moj的参数，指向line */
+	char line[HOST_LINE];
+	pid_t pid;				/* 运行中的moj进程 */
+	int core;				/* 分配的测量核，在host的cores中的下标 */
+	struct timespec arrive;	/* 到达时间 */
+	struct hostjob *next;
+};
+
+/*
+ * 评测机的资源和等待队列
+ */
+struct host
+{
+	int ncore;				/* 测量核的个数 */
+	int cores[HOST_CPU_MAX];	/* 测量核的CPU编号 */
+	int busy[HOST_CPU_MAX];	/* 测量核是否被占用 */
+	unsigned long hkmask[HOST_CPU_WORDS];	/* 杂务核的掩码 */
+	int shared;				/* 为1则核数不够，测量核与杂务核重叠 */
+	long reserved;			/* 运行中的评测申报的内存之和，单位kb */
+	int running;			/* 运行中的评测数 */
+	struct hostjob *queue[HOST_CLASSES];	/* 各类别的等待队列 */
+	enum hostpolicy policy;	/* 同一类别内的排队策略 */
+	int lat[HOST_CLASSES][HOST_LAT_SAMPLES];	/* 最近的排队延迟，单位毫秒 */
+	long nlat[HOST_CLASSES];	/* 各类别启动过的评测数 */
+};
+
+int host_init(struct host *h, int nhk, enum hostpolicy policy, char *errmsg);
+int host_parse(struct hostjob *job, const char *line, char *errmsg);
+void host_submit(struct host *h, struct hostjob *job);
+struct hostjob * host_next(struct host *h);
+void host_release(struct host *h, struct hostjob *job);
+int host_status(struct host *h, char *buf, int len);
+int host_probe(struct host *h, const char *datadir, const char *store,
+		char *buf, int len);
+
+#endif
@@ -2,32 +2,37 @@
  * 源文件：main.c
  * 模块功能：程序入口，进行参数解释和模块初始化
  * 版本：v0.1.0
- * 最后修改：2012-08-15
+ * 最后修改：2026-10-18
  ************************************************/
 #include "global.h"
 #include "exit.h"
-#include "tester.h"
+#include "moj.h"
+#include "calib.h"
+#include "batch.h"
 #include <limits.h>
 
 /*
  * 局部函数声明
  */
 static int parse_arguments(int argc, char *argv[],
-		struct condition *cond, char *errmsg);
+		struct condition *cond, struct batch *bt, char *errmsg);
 static int
-check_arguments(struct condition *cond, char *errmsg);
+check_arguments(struct condition *cond, const struct batch *bt, char *errmsg);
 
 /*
  * 主函数：main
- * 功能：检查程序的权限，进行参数解释，调用tester模块
+ * 功能：检查程序的权限，进行参数解释，调用moj_judge评测并打印结果
  * 参数：不解释
  * 返回值：无
  */
 int
 main(int argc, char *argv[])
 {
+	static struct result res;
 	struct condition cond;
+	struct batch bt;
 	char errmsg[ERR_MSG_MAX];
+	long overhead;
 
 	/* 保证euid为0，egid不为0 */
 	if (geteuid() != 0) {
@@ -55,11 +60,28 @@ main(int argc, char *argv[])
 		exit_func(EXIT_IE, errmsg);
 	}
 
+	/* 校准模式：测量跟踪开销，写入校准文件后退出 */
+	if (argc == 3 && strcmp(argv[1], "--calibrate") == 0) {
+		if (calib_measure(&overhead, errmsg) != 0 ||
+				calib_save(argv[2], overhead, errmsg) != 0)
+			exit_func(EXIT_IE, errmsg);
+		printf("%ld\n", overhead);
+		return 0;
+	}
+
 	/* 参数解释和检测 */
-	if (parse_arguments(argc, argv, &cond, errmsg) != 0)
+	if (parse_arguments(argc, argv, &cond, &bt, errmsg) != 0)
 		exit_func(EXIT_EE, errmsg);
 
-	tester_start(&cond);
+	/* 批量模式：每个提交输出一个结果，见doc/HowTo_batch.txt */
+	if (bt.list != NULL) {
+		if (bat_run(&cond, &bt, errmsg) != 0)
+			exit_func(EXIT_EE, errmsg);
+		return 0;
+	}
+
+	moj_judge(&cond, &res);
+	exit_result(&res);
 
 	/* 程序不应该由这里结束 */
 	return 1;
@@ -70,16 +92,19 @@ main(int argc, char *argv[])
  * 功能：解释命令行参数
  * 参数：argc, argv同main函数的参数
  * 		cond为需要填充的结构体，见tester.h
+ * 		bt为批量模式的参数，见batch.h
  * 		errmsg为错误信息
  * 返回值：正确返回0，错误返回1，错误信息写入errmsg
  */
 static int
 parse_arguments(int argc, char *argv[],
-		struct condition *cond, char *errmsg)
+		struct condition *cond, struct batch *bt, char *errmsg)
 {
 	int i;
 	
-	memset(cond, 0, sizeof(struct condition));
+	moj_defaults(cond);
+	bt->list = NULL;
+	bt->jobs = 1;
 	for (i = 0; i < argc - 1; ++i) {
 		if (strcmp(argv[i], "-t") == 0)
 			cond->time = atoi(argv[++i]);
@@ -89,6 +114,10 @@ parse_arguments(int argc, char *argv[],
 			cond->fsize = atoi(argv[++i]);
 		else if (strcmp(argv[i], "--who") == 0)
 			cond->who = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--memtrace") == 0)
+			cond->memtrace = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--checker-time") == 0)
+			cond->chktime = atoi(argv[++i]);
 
 		else if (strcmp(argv[i], "--basedir") == 0)
 			cond->basedir = argv[++i];
@@ -96,11 +125,73 @@ parse_arguments(int argc, char *argv[],
 			cond->datadir = argv[++i];
 		else if (strcmp(argv[i], "--magic") == 0)
 			cond->magic = argv[++i];
+		else if (strcmp(argv[i], "--cache") == 0)
+			cond->cache = argv[++i];
+		else if (strcmp(argv[i], "--cache-policy") == 0)
+			cond->cache_policy = argv[++i];
+		else if (strcmp(argv[i], "--store") == 0)
+			cond->store = argv[++i];
+		else if (strcmp(argv[i], "--gencache") == 0)
+			cond->gencache = argv[++i];
+		else if (strcmp(argv[i], "--calibration") == 0)
+			cond->calibration = argv[++i];
+		else if (strcmp(argv[i], "--cpu") == 0)
+			cond->cpu = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--cgroup") == 0)
+			cond->cgroup = argv[++i];
+		else if (strcmp(argv[i], "--rootfs") == 0)
+			cond->rootfs = argv[++i];
+		else if (strcmp(argv[i], "--zygote") == 0)
+			cond->zygote = 1;
+		else if (strcmp(argv[i], "--src") == 0)
+			cond->src = argv[++i];
+		else if (strcmp(argv[i], "--cc") == 0)
+			cond->cc = argv[++i];
+		else if (strcmp(argv[i], "--cflags") == 0)
+			cond->cflags = argv[++i];
+		else if (strcmp(argv[i], "--exe") == 0)
+			cond->exe = argv[++i];
+		else if (strcmp(argv[i], "--ccache") == 0)
+			cond->ccache = argv[++i];
+		else if (strcmp(argv[i], "--ct") == 0)
+			cond->ctime = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--cm") == 0)
+			cond->cmemory = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--compare") == 0)
+			cond->compare = argv[++i];
+		else if (strcmp(argv[i], "--cases") == 0)
+			cond->cases = argv[++i];
+		else if (strcmp(argv[i], "--progress") == 0)
+			cond->progress = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--batch") == 0)
+			bt->list = argv[++i];
+		else if (strcmp(argv[i], "--jobs") == 0)
+			bt->jobs = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--score") == 0) {
+			++i;
+			if (strcmp(argv[i], "all") == 0)
+				cond->score = SCR_ALL;
+			else if (strcmp(argv[i], "skip") == 0)
+				cond->score = SCR_SKIP;
+			else
+				cond->score = -1;
+		}
+		else if (strcmp(argv[i], "--stats") == 0)
+			cond->stats = argv[++i];
+		else if (strcmp(argv[i], "--order") == 0) {
+			++i;
+			if (strcmp(argv[i], "adaptive") == 0)
+				cond->adaptive = 1;
+			else if (strcmp(argv[i], "canonical") == 0)
+				cond->adaptive = 0;
+			else
+				cond->adaptive = -1;
+		}
 		
 		else if (strcmp(argv[i], "--end") == 0)
 			cond->command = argv + i + 1;
 	}
-	return check_arguments(cond, errmsg);
+	return check_arguments(cond, bt, errmsg);
 }
 
 /*
@@ -110,8 +201,11 @@ parse_arguments(int argc, char *argv[],
  * 返回值：同parse_arguments
  */
 static int
-check_arguments(struct condition *cond, char *errmsg)
+check_arguments(struct condition *cond, const struct batch *bt, char *errmsg)
 {
+	static char exe[PATH_MAX], run[PATH_MAX];
+	static char *command[2];
+
 	if (cond->time <= 0) {
 		sprintf(errmsg, "**check_arguments** -t argument error.");
 		return 1;
@@ -132,7 +226,37 @@ check_arguments(struct condition *cond, char *errmsg)
 		return 1;
 	}
 
-	if (cond->basedir == NULL) {
+	if (cond->memtrace < 0) {
+		sprintf(errmsg, "**check_arguments** --memtrace argument error.");
+		return 1;
+	}
+
+	if (cond->chktime < 0) {
+		sprintf(errmsg, "**check_arguments** --checker-time argument error.");
+		return 1;
+	}
+
+	if (cond->adaptive < 0 || (cond->adaptive && cond->stats == NULL)) {
+		sprintf(errmsg, "**check_arguments** --order argument error.");
+		return 1;
+	}
+
+	/* 批量模式下basedir，magic和命令来自提交列表，不能有编译和进度事件 */
+	if (bt->list != NULL) {
+		if (bt->jobs <= 0 || bt->jobs > BAT_JOBS_MAX || (cond->cpu >= 0 &&
+					cond->cpu + bt->jobs > CHILD_CPU_MAX)) {
+			sprintf(errmsg, "**check_arguments** --jobs argument error.");
+			return 1;
+		}
+		if (cond->basedir != NULL || cond->magic != NULL ||
+				cond->command != NULL || cond->src != NULL ||
+				cond->progress != -1) {
+			sprintf(errmsg, "**check_arguments** --batch argument error.");
+			return 1;
+		}
+	}
+
+	if (cond->basedir == NULL && bt->list == NULL) {
 		sprintf(errmsg, "**check_arguments** --basedir argument error.");
 		return 1;
 	}
@@ -142,12 +266,64 @@ check_arguments(struct condition *cond, char *errmsg)
 		return 1;
 	}
 
-	if (cond->magic == NULL) {
+	if (cond->magic == NULL && bt->list == NULL) {
 		sprintf(errmsg, "**check_arguments** --magic argument error.");
 		return 1;
 	}
 
-	if (cond->command == NULL) {
+	if (cond->ctime <= 0) {
+		sprintf(errmsg, "**check_arguments** --ct argument error.");
+		return 1;
+	}
+
+	if (cond->cmemory <= 0) {
+		sprintf(errmsg, "**check_arguments** --cm argument error.");
+		return 1;
+	}
+
+	if (cond->cpu < -1 || cond->cpu >= CHILD_CPU_MAX) {
+		sprintf(errmsg, "**check_arguments** --cpu argument error.");
+		return 1;
+	}
+
+	if (cond->cases != NULL && (cond->cases[0] == '\0' ||
+				strspn(cond->cases, "0123456789,-") != strlen(cond->cases))) {
+		sprintf(errmsg, "**check_arguments** --cases argument error.");
+		return 1;
+	}
+
+	/* 只运行部分测试时不能评分 */
+	if ((int)cond->score < 0 ||
+			(cond->score != SCR_OFF && cond->cases != NULL)) {
+		sprintf(errmsg, "**check_arguments** --score argument error.");
+		return 1;
+	}
+
+	/* 标准输入和标准输出另有用途，不能作为进度事件的描述符 */
+	if (cond->progress != -1 && cond->progress <= STDOUT_FILENO) {
+		sprintf(errmsg, "**check_arguments** --progress argument error.");
+		return 1;
+	}
+
+	/* 编译生成的可执行文件默认为"<magic>.bin"，没有--end时运行它 */
+	if (cond->src != NULL) {
+		if (cond->exe == NULL) {
+			snprintf(exe, sizeof(exe), "%s.bin", cond->magic);
+			cond->exe = exe;
+		}
+		if (cond->exe[0] == '\0' || cond->exe[0] == '/' ||
+				strlen(cond->exe) + 3 > sizeof(run)) {
+			sprintf(errmsg, "**check_arguments** --exe argument error.");
+			return 1;
+		}
+		if (cond->command == NULL) {
+			snprintf(run, sizeof(run), "./%s", cond->exe);
+			command[0] = run;
+			cond->command = command;
+		}
+	}
+
+	if (cond->command == NULL && bt->list == NULL) {
 		sprintf(errmsg, "**check_arguments** --end argument error.");
 		return 1;
 	}
@@ -0,0 +1,68 @@
+/*************************************************
+ * 源文件：moj.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "moj.h"
+
+/*
+ * 接口函数：moj_defaults
+ * 功能：把评测条件设为默认值
+ * 参数：cond为待初始化的评测条件
+ * 返回值：无
+ * 注意：之后由调用者填写限制、目录和命令等必需的字段
+ */
+void
+moj_defaults(struct condition *cond)
+{
+	memset(cond, 0, sizeof(struct condition));
+	cond->cc = COMPILE_CC;
+	cond->ctime = COMPILE_TIME;
+	cond->cmemory = COMPILE_MEMORY;
+	cond->cpu = -1;
+	cond->progress = -1;
+}
+
+/*
+ * 接口函数：moj_judge
+ * 功能：进行一次完整的评测，有源程序则先编译
+ * 参数：cond为评测条件，有源程序时cond->exe和cond->command必须已经设置，
+ *   res接收评测结果
+ * 返回值：无，结果和附加行在res中，exit_format可以得到与moj相同的输出
+ * 注意：出错时不退出进程，资源都已释放，可以继续评测；
+ *   调用者需要与moj相同的权限：有效用户为root，实际用户不是root，
+ *   并且已经像moj的main一样交换了两者；评测期间使用SIGALRM和SIGUSR1，
+ *   调用者不要设置它们的处理函数；
+ *   cond->dataset不为NULL则共享该数据集，见data.h
+ */
+void
+moj_judge(struct condition *cond, struct result *res)
+{
+	struct compilation cp;
+	char exe[PATH_MAX];
+
+	exit_init(res);
+
+	/* 题目的评测耗时包括编译，供mojd估计排队的评测需要多久 */
+	clock_gettime(CLOCK_MONOTONIC, &cond->begin);
+
+	/* 有源程序则先编译，编译失败即为结果 */
+	if (cond->src != NULL) {
+		cp.src = cond->src;
+		cp.cc = cond->cc;
+		cp.cflags = cond->cflags;
+		cp.cache = cond->ccache;
+		cp.time = cond->ctime;
+		cp.memory = cond->cmemory;
+		cp.who = cond->who;
+		if (cond->basedir[strlen(cond->basedir) - 1] == '/')
+			snprintf(exe, PATH_MAX, "%s%s", cond->basedir, cond->exe);
+		else
+			snprintf(exe, PATH_MAX, "%s/%s", cond->basedir, cond->exe);
+		cp.exe = exe;
+		if (compile_start(&cp, res) != 0)
+			return;
+	}
+
+	tester_start(cond, res);
+}
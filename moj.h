@@ -0,0 +1,22 @@
+/***************************************************************
+ * 文件名：moj.h
+ * 模块功能：libmoj的嵌入接口，调用者在自己的进程中评测，
+ *   得到struct result而不是解析moj的标准输出，一个进程可以评测多次
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include "tester.h"
+#include "compile.h"
+#include "exit.h"
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#ifndef MOJ_H
+#define MOJ_H
+
+void moj_defaults(struct condition *cond);
+void moj_judge(struct condition *cond, struct result *res);
+
+#endif
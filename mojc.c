@@ -0,0 +1,673 @@
+/*************************************************
+ * 源文件：mojc.c
+ * 模块功能：评测协调器，接收评测请求，按数据位置和负载分发给多台评测机
+ *   上的mojd，可以把一个评测的测试拆成几部分分别评测，失败时换机器重试，
+ *   最后合并成一个结果，协议见doc/HowTo_mojc.txt
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "global.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * 评测机的最大个数，一个评测最多拆成的部分数
+ */
+#define MOJC_NODES 64
+#define MOJC_PARTS 64
+
+/*
+ * 请求的最大长度，一部分结果的最大长度
+ */
+#define MOJC_LINE 4096
+#define MOJC_OUT 65536
+
+/*
+ * 连接评测机和等待探测回答的时间，单位毫秒
+ */
+#define MOJC_TIMEOUT 2000
+
+/*
+ * 一台评测机，探测的结果见mojd的probe请求
+ */
+struct mcnode
+{
+	char name[64];			/* "<地址>:<端口>" */
+	struct sockaddr_in sa;
+	int up;					/* 为1则探测成功 */
+	int cases;				/* 题目的测试组数 */
+	int present;			/* 本机具备数据的组数 */
+	int running;
+	int waiting;
+	int cores;
+};
+
+/*
+ * 一个评测的一部分，交给一台评测机
+ */
+struct mcpart
+{
+	int lo, hi;				/* 测试序号的范围，从1开始，lo为0表示不拆分 */
+	int node;				/* 候选评测机的下标 */
+	int tries;				/* 已经换过的评测机数 */
+	int fd;					/* 与mojd的连接，-1为没有 */
+	int done;				/* 为1则结果已经确定 */
+	int len;
+	char out[MOJC_OUT];		/* mojd返回的结果，格式同moj */
+	int code;				/* 结果的状态码 */
+	int fail;				/* 出错的测试序号，0为测试之前出错 */
+	int time, memory;		/* 结果为AC时的时间和内存 */
+};
+
+/*
+ * 协调器的全部状态
+ */
+struct mojc
+{
+	struct mcnode nodes[MOJC_NODES];
+	int nnode;
+	int split;				/* 一个评测最多拆成的部分数 */
+	int retry;				/* 一部分最多换几台评测机 */
+	int lfd[2];				/* UNIX和TCP监听套接字，-1为没有 */
+};
+
+/*
+ * 局部函数声明
+ */
+static int mojc_node(struct mcnode *node, const char *spec);
+static int mojc_listen_unix(const char *path);
+static int mojc_listen_tcp(const char *addr, int port);
+static void mojc_serve(struct mojc *mc, int fd);
+static void mojc_status(struct mojc *mc, int fd);
+static void mojc_probe(struct mojc *mc, const char *datadir, const char *store);
+static int mojc_connect(struct mcnode *node);
+static int mojc_ask(struct mcnode *node, const char *req, char *buf, int len);
+static void mojc_judge(struct mojc *mc, int fd, const char *line,
+		const char *datadir);
+static void mojc_send(struct mojc *mc, struct mcpart *part,
+		int *cand, int ncand, const char *line);
+static void mojc_parse(struct mcpart *part);
+static int mojc_cmpload(const void *a, const void *b);
+
+/*
+ * 局部数据：mojc_sort
+ * 作用：mojc_cmpload比较时使用的评测机数组
+ * 被使用：mojc_judge和mojc_cmpload
+ */
+static struct mcnode *mojc_sort;
+
+/*
+ * 主函数：main
+ * 功能：参数解释，然后接收连接，每个连接由一个子进程处理
+ * 参数：mojc [--unix path] [--tcp port] [--bind addr] --node addr:port...
+ *   [--split n] [--retry n]
+ * 返回值：出错返回1，正常情况下不返回
+ */
+int
+main(int argc, char *argv[])
+{
+	struct mojc mc;
+	struct pollfd pfds[2];
+	const char *unixpath = NULL, *bindaddr = "127.0.0.1";
+	int i, fd, port = 0;
+
+	memset(&mc, 0, sizeof(mc));
+	mc.split = 1;
+	mc.retry = 2;
+	for (i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc)
+			unixpath = argv[++i];
+		else if (strcmp(argv[i], "--tcp") == 0 && i + 1 < argc)
+			port = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc)
+			bindaddr = argv[++i];
+		else if (strcmp(argv[i], "--node") == 0 && i + 1 < argc &&
+				mc.nnode < MOJC_NODES &&
+				mojc_node(&mc.nodes[mc.nnode], argv[i + 1]) == 0)
+			++mc.nnode, ++i;
+		else if (strcmp(argv[i], "--split") == 0 && i + 1 < argc)
+			mc.split = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--retry") == 0 && i + 1 < argc)
+			mc.retry = atoi(argv[++i]);
+		else
+			unixpath = NULL, port = 0, i = argc;
+	}
+	if ((unixpath == NULL && port <= 0) || mc.nnode == 0 ||
+			mc.split < 1 || mc.split > MOJC_PARTS || mc.retry < 0) {
+		fprintf(stderr, "usage: mojc [--unix path] [--tcp port] "
+				"[--bind addr] --node addr:port... [--split n] [--retry n]\n");
+		return 1;
+	}
+
+	mc.lfd[0] = mc.lfd[1] = -1;
+	if (unixpath != NULL && (mc.lfd[0] = mojc_listen_unix(unixpath)) == -1)
+		return 1;
+	if (port > 0 && (mc.lfd[1] = mojc_listen_tcp(bindaddr, port)) == -1)
+		return 1;
+
+	/* 子进程自动回收 */
+	signal(SIGCHLD, SIG_IGN);
+	signal(SIGPIPE, SIG_IGN);
+
+	while (1) {
+		for (i = 0; i < 2; ++i) {
+			pfds[i].fd = mc.lfd[i];
+			pfds[i].events = POLLIN;
+		}
+		if (poll(pfds, 2, -1) == -1) {
+			if (errno != EINTR)
+				fprintf(stderr, "mojc: poll: %s\n", strerror(errno));
+			continue;
+		}
+		for (i = 0; i < 2; ++i) {
+			if (!pfds[i].revents || (fd = accept(mc.lfd[i], NULL, NULL)) == -1)
+				continue;
+			switch (fork()) {
+				case -1 :	dprintf(fd, "%d\nInternal Error\n"
+									"**main** fork error: %s\n",
+									EXIT_IE, strerror(errno));
+							break;
+				case 0 :	close(mc.lfd[0]);
+							close(mc.lfd[1]);
+							mojc_serve(&mc, fd);
+							_exit(0);
+			}
+			close(fd);
+		}
+	}
+}
+
+/*
+ * 局部函数：mojc_node
+ * 功能：解析评测机的地址
+ * 参数：node接收结果，spec为"<IPv4地址>:<端口>"
+ * 返回值：成功返回0，格式错误返回-1
+ */
+static int
+mojc_node(struct mcnode *node, const char *spec)
+{
+	char addr[64], *colon;
+
+	snprintf(node->name, sizeof(node->name), "%s", spec);
+	snprintf(addr, sizeof(addr), "%s", spec);
+	if ((colon = strrchr(addr, ':')) == NULL)
+		return -1;
+	*colon = '\0';
+
+	memset(&node->sa, 0, sizeof(node->sa));
+	node->sa.sin_family = AF_INET;
+	node->sa.sin_port = htons(atoi(colon + 1));
+	if (atoi(colon + 1) <= 0 ||
+			inet_pton(AF_INET, addr, &node->sa.sin_addr) != 1)
+		return -1;
+	return 0;
+}
+
+/*
+ * 局部函数：mojc_listen_unix
+ * 功能：在UNIX套接字上监听
+ * 参数：path为套接字路径，已经存在则先删除
+ * 返回值：成功返回监听描述符，出错返回-1，错误写到标准出错
+ */
+static int
+mojc_listen_unix(const char *path)
+{
+	struct sockaddr_un sa;
+	int fd;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sa.sun_path)) {
+		fprintf(stderr, "mojc: %s: path too long\n", path);
+		return -1;
+	}
+	strcpy(sa.sun_path, path);
+	unlink(path);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+			bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1 ||
+			listen(fd, SOMAXCONN) == -1) {
+		fprintf(stderr, "mojc: %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * 局部函数：mojc_listen_tcp
+ * 功能：在TCP端口上监听
+ * 参数：addr为绑定的IPv4地址，port为端口
+ * 返回值：成功返回监听描述符，出错返回-1，错误写到标准出错
+ */
+static int
+mojc_listen_tcp(const char *addr, int port)
+{
+	struct sockaddr_in sa;
+	int fd, on = 1;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons(port);
+	if (inet_pton(AF_INET, addr, &sa.sin_addr) != 1) {
+		fprintf(stderr, "mojc: bad address %s\n", addr);
+		return -1;
+	}
+
+	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) == -1 ||
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1 ||
+			bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1 ||
+			listen(fd, SOMAXCONN) == -1) {
+		fprintf(stderr, "mojc: %s:%d: %s\n", addr, port, strerror(errno));
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * 局部函数：mojc_serve
+ * 功能：在子进程中处理一个连接上的请求
+ * 参数：mc为协调器状态，fd为客户端连接
+ * 返回值：无
+ * 注意：请求格式同mojd；--cases由协调器决定，请求中出现则为EE
+ */
+static void
+mojc_serve(struct mojc *mc, int fd)
+{
+	char line[MOJC_LINE], copy[MOJC_LINE];
+	char *tok, *prev = NULL, *datadir = NULL, *store = NULL;
+	int n, len = 0;
+
+	while (len < MOJC_LINE - 1 && memchr(line, '\n', len) == NULL) {
+		if ((n = read(fd, line + len, MOJC_LINE - 1 - len)) <= 0)
+			return;
+		len += n;
+	}
+	line[len] = '\0';
+	if ((tok = strchr(line, '\n')) == NULL) {
+		dprintf(fd, "%d\nExternal Error\n**mojc_serve** request too long.\n",
+				EXIT_EE);
+		return;
+	}
+	*tok = '\0';
+	if (tok > line && tok[-1] == '\r')
+		tok[-1] = '\0';
+
+	if (strcmp(line, "status") == 0) {
+		mojc_status(mc, fd);
+		return;
+	}
+
+	snprintf(copy, MOJC_LINE, "%s", line);
+	for (tok = strtok(copy, " \t"); tok != NULL; tok = strtok(NULL, " \t")) {
+		if (strcmp(tok, "--cases") == 0) {
+			dprintf(fd, "%d\nExternal Error\n"
+					"**mojc_serve** --cases is reserved.\n", EXIT_EE);
+			return;
+		}
+		if (prev != NULL && strcmp(prev, "--datadir") == 0)
+			datadir = tok;
+		if (prev != NULL && strcmp(prev, "--store") == 0)
+			store = tok;
+		prev = tok;
+	}
+	if (datadir == NULL) {
+		dprintf(fd, "%d\nExternal Error\n"
+				"**mojc_serve** no --datadir argument.\n", EXIT_EE);
+		return;
+	}
+
+	mojc_probe(mc, datadir, store);
+	mojc_judge(mc, fd, line, datadir);
+}
+
+/*
+ * 局部函数：mojc_status
+ * 功能：探测全部评测机，每台输出一行状态
+ * 参数：mc为协调器状态，fd为客户端连接
+ * 返回值：无
+ */
+static void
+mojc_status(struct mojc *mc, int fd)
+{
+	struct mcnode *node;
+	int i;
+
+	mojc_probe(mc, NULL, NULL);
+	for (i = 0; i < mc->nnode; ++i) {
+		node = &mc->nodes[i];
+		dprintf(fd, "node %s up %d running %d waiting %d cores %d\n",
+				node->name, node->up, node->running,
+				node->waiting, node->cores);
+	}
+}
+
+/*
+ * 局部函数：mojc_probe
+ * 功能：向全部评测机发送probe请求，记录数据位置和负载
+ * 参数：mc为协调器状态，datadir为题目数据目录，为NULL则只探测负载，
+ *   store为数据仓库目录，可以为NULL
+ * 返回值：无
+ * 注意：连不上或者回答格式错误的评测机记为不可用，本次评测不使用
+ */
+static void
+mojc_probe(struct mojc *mc, const char *datadir, const char *store)
+{
+	struct mcnode *node;
+	char req[MOJC_LINE], buf[256];
+	int i;
+
+	snprintf(req, MOJC_LINE, "probe%s%s%s%s\n",
+			datadir != NULL ? " " : "", datadir != NULL ? datadir : "",
+			store != NULL ? " " : "", store != NULL ? store : "");
+	for (i = 0; i < mc->nnode; ++i) {
+		node = &mc->nodes[i];
+		node->up = mojc_ask(node, req, buf, sizeof(buf)) == 0 &&
+			sscanf(buf, "probe cases %d present %d running %d "
+					"waiting %d cores %d", &node->cases, &node->present,
+					&node->running, &node->waiting, &node->cores) == 5 &&
+			node->cores > 0;
+	}
+}
+
+/*
+ * 局部函数：mojc_connect
+ * 功能：连接一台评测机
+ * 参数：node为评测机
+ * 返回值：成功返回阻塞的连接，失败或者超过MOJC_TIMEOUT返回-1
+ */
+static int
+mojc_connect(struct mcnode *node)
+{
+	struct pollfd pfd;
+	int fd, err = 0;
+	socklen_t len = sizeof(err);
+
+	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+		return -1;
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	if (connect(fd, (struct sockaddr *)&node->sa, sizeof(node->sa)) == -1) {
+		pfd.fd = fd;
+		pfd.events = POLLOUT;
+		if (errno != EINPROGRESS || poll(&pfd, 1, MOJC_TIMEOUT) != 1 ||
+				getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1 ||
+				err != 0) {
+			close(fd);
+			return -1;
+		}
+	}
+	fcntl(fd, F_SETFL, 0);
+	return fd;
+}
+
+/*
+ * 局部函数：mojc_ask
+ * 功能：向评测机发送一个请求并读取全部回答
+ * 参数：node为评测机，req为请求行，buf和len接收回答
+ * 返回值：成功返回0，失败或者超时返回-1
+ */
+static int
+mojc_ask(struct mcnode *node, const char *req, char *buf, int len)
+{
+	struct pollfd pfd;
+	int fd, n, got = 0;
+
+	if ((fd = mojc_connect(node)) == -1)
+		return -1;
+	if (write(fd, req, strlen(req)) != (ssize_t)strlen(req)) {
+		close(fd);
+		return -1;
+	}
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (got < len - 1) {
+		if (poll(&pfd, 1, MOJC_TIMEOUT) != 1 ||
+				(n = read(fd, buf + got, len - 1 - got)) < 0) {
+			close(fd);
+			return -1;
+		}
+		if (n == 0)
+			break;
+		got += n;
+	}
+	buf[got] = '\0';
+	close(fd);
+	return got > 0 ? 0 : -1;
+}
+
+/*
+ * 局部函数：mojc_judge
+ * 功能：把评测分发给具备数据的评测机，等待全部部分的结果并合并
+ * 参数：mc为协调器状态，fd为客户端连接，line为请求行，
+ *   datadir为请求中的数据目录，只用于出错信息
+ * 返回值：无
+ * 注意：候选为具备全部数据的评测机，按(运行数+等待数)/核数从小到大；
+ *   测试按序号分成连续的几部分，部分数不超过--split、候选数和组数；
+ *   一部分出错的测试之后的部分不影响结果，直接放弃；
+ *   合并规则同tester_exit：序号最小的错误为结果，编译错误算在全部测试之前，
+ *   全部正确时时间和内存取各部分的最大值
+ */
+static void
+mojc_judge(struct mojc *mc, int fd, const char *line, const char *datadir)
+{
+	static struct mcpart parts[MOJC_PARTS];
+	struct pollfd pfds[MOJC_PARTS + 1];
+	int cand[MOJC_NODES];
+	int i, j, n, k, ncand = 0, cases, active, best = -1;
+	int time = 0, memory = 0;
+	char c;
+
+	for (i = 0; i < mc->nnode; ++i)
+		if (mc->nodes[i].up && mc->nodes[i].cases > 0 &&
+				mc->nodes[i].present == mc->nodes[i].cases)
+			cand[ncand++] = i;
+	if (ncand == 0) {
+		dprintf(fd, "%d\nExternal Error\n"
+				"**mojc_judge** no node has the data of %s\n",
+				EXIT_EE, datadir);
+		return;
+	}
+	mojc_sort = mc->nodes;
+	qsort(cand, ncand, sizeof(int), mojc_cmpload);
+
+	cases = mc->nodes[cand[0]].cases;
+	k = mc->split;
+	if (k > ncand)
+		k = ncand;
+	if (k > cases)
+		k = cases;
+
+	for (i = 0; i < k; ++i) {
+		memset(&parts[i], 0, sizeof(struct mcpart));
+		parts[i].lo = k == 1 ? 0 : cases * i / k + 1;
+		parts[i].hi = k == 1 ? 0 : cases * (i + 1) / k;
+		parts[i].node = i;
+		parts[i].fd = -1;
+		mojc_send(mc, &parts[i], cand, ncand, line);
+	}
+
+	while (1) {
+		/* 客户端断开则放弃评测，关闭连接使mojd取消等待中的部分 */
+		n = 0;
+		pfds[n].fd = fd;
+		pfds[n++].events = POLLIN;
+		for (i = 0, active = 0; i < k; ++i) {
+			pfds[n].fd = parts[i].done ? -1 : parts[i].fd;
+			pfds[n++].events = POLLIN;
+			active += !parts[i].done;
+		}
+		if (active == 0)
+			break;
+		if (poll(pfds, n, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		if (pfds[0].revents && recv(fd, &c, 1, MSG_DONTWAIT) <= 0)
+			return;
+
+		for (i = 0; i < k; ++i) {
+			if (parts[i].done || !pfds[1 + i].revents)
+				continue;
+			/* 读到结束或者缓冲区满，超出的部分丢弃 */
+			n = read(parts[i].fd, parts[i].out + parts[i].len,
+					MOJC_OUT - 1 - parts[i].len);
+			if (n > 0)
+				parts[i].len += n;
+			if (n > 0 && parts[i].len < MOJC_OUT - 1)
+				continue;
+			close(parts[i].fd);
+			parts[i].fd = -1;
+			parts[i].out[parts[i].len] = '\0';
+			mojc_parse(&parts[i]);
+
+			/* 连接中断、外部错误和内部错误换一台评测机重试 */
+			if ((parts[i].code == EXIT_EE || parts[i].code == EXIT_IE) &&
+					parts[i].tries < mc->retry) {
+				++parts[i].tries;
+				mojc_send(mc, &parts[i], cand, ncand, line);
+				continue;
+			}
+			parts[i].done = 1;
+
+			if (parts[i].code == EXIT_AC)
+				continue;
+			for (j = 0; j < k; ++j) {
+				if (!parts[j].done && parts[j].lo > parts[i].fail) {
+					if (parts[j].fd != -1)
+						close(parts[j].fd);
+					parts[j].fd = -1;
+					parts[j].done = 1;
+					parts[j].code = EXIT_AC;
+				}
+			}
+		}
+	}
+
+	for (i = 0; i < k; ++i) {
+		if (parts[i].code == EXIT_AC) {
+			if (parts[i].time > time)
+				time = parts[i].time;
+			if (parts[i].memory > memory)
+				memory = parts[i].memory;
+		} else if (best == -1 || parts[i].fail < parts[best].fail) {
+			best = i;
+		}
+	}
+
+	/* 不拆分或者有错误时原样转发，全部正确时合并 */
+	if (k == 1)
+		write(fd, parts[0].out, parts[0].len);
+	else if (best != -1)
+		write(fd, parts[best].out, parts[best].len);
+	else
+		dprintf(fd, "%d\nAccepted\n%dms\n%dkb\nparts %d\n",
+				EXIT_AC, time, memory, k);
+}
+
+/*
+ * 局部函数：mojc_send
+ * 功能：把一部分发送给它的评测机
+ * 参数：mc为协调器状态，part为这一部分，cand和ncand为候选评测机，
+ *   line为原始请求行
+ * 返回值：无
+ * 注意：第tries次重试使用候选中的下一台；连不上时立即重试，
+ *   重试次数用完则结果为EE
+ */
+static void
+mojc_send(struct mojc *mc, struct mcpart *part,
+		int *cand, int ncand, const char *line)
+{
+	struct mcnode *node;
+	char req[MOJC_LINE + 64];
+	int n;
+
+	while (1) {
+		node = &mc->nodes[cand[(part->node + part->tries) % ncand]];
+		part->len = 0;
+		if (part->lo > 0)
+			n = snprintf(req, sizeof(req), "%s --cases %d-%d\n",
+					line, part->lo, part->hi);
+		else
+			n = snprintf(req, sizeof(req), "%s\n", line);
+
+		if ((part->fd = mojc_connect(node)) != -1 &&
+				write(part->fd, req, n) == n)
+			return;
+
+		if (part->fd != -1)
+			close(part->fd);
+		part->fd = -1;
+		part->len = snprintf(part->out, MOJC_OUT, "%d\nExternal Error\n"
+				"**mojc_send** node %s is down.\n", EXIT_EE, node->name);
+		if (part->tries >= mc->retry) {
+			mojc_parse(part);
+			part->done = 1;
+			return;
+		}
+		++part->tries;
+	}
+}
+
+/*
+ * 局部函数：mojc_parse
+ * 功能：解析一部分的结果
+ * 参数：part为这一部分，out已经以'\0'结束
+ * 返回值：无
+ * 注意：没有结果或者格式错误视为外部错误；出错的序号取附加行"case <序号>"，
+ *   没有时编译错误为0，其他为这一部分的第一个序号
+ */
+static void
+mojc_parse(struct mcpart *part)
+{
+	const char *p;
+
+	part->fail = part->lo;
+	part->time = part->memory = 0;
+	if (sscanf(part->out, "%d", &part->code) != 1) {
+		part->code = EXIT_EE;
+		part->len = snprintf(part->out, MOJC_OUT, "%d\nExternal Error\n"
+				"**mojc_parse** connection lost.\n", EXIT_EE);
+		return;
+	}
+
+	if (part->code == EXIT_AC) {
+		if (sscanf(part->out, "%*d Accepted %dms %dkb",
+					&part->time, &part->memory) != 2)
+			part->code = EXIT_EE;
+		return;
+	}
+	if (part->code == EXIT_CE)
+		part->fail = 0;
+	for (p = part->out; (p = strchr(p, '\n')) != NULL; ++p)
+		if (sscanf(p + 1, "case %d", &part->fail) == 1)
+			break;
+}
+
+/*
+ * 局部函数：mojc_cmpload
+ * 功能：qsort使用的比较函数，按每个核上的评测数比较两台评测机
+ * 参数：a和b指向评测机在mojc_sort中的下标
+ * 返回值：a的负载小于、等于、大于b分别返回负数、0、正数
+ */
+static int
+mojc_cmpload(const void *a, const void *b)
+{
+	const struct mcnode *x = &mojc_sort[*(const int *)a];
+	const struct mcnode *y = &mojc_sort[*(const int *)b];
+	long lx = (long)(x->running + x->waiting) * y->cores;
+	long ly = (long)(y->running + y->waiting) * x->cores;
+
+	return lx < ly ? -1 : lx > ly;
+}
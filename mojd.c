@@ -0,0 +1,581 @@
+/*************************************************
+ * 源文件：mojd.c
+ * 模块功能：评测守护进程，接收评测请求，由host模块调度，
+ *   每个评测运行一个moj进程，协议见doc/HowTo_mojd.txt
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "global.h"
+#include "host.h"
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * 同时读取请求的连接数和等待队列的长度上限
+ */
+#define MOJD_CONNS 64
+#define MOJD_QUEUE_MAX 1024
+
+/*
+ * 正在读取请求的连接
+ */
+struct mdconn
+{
+	int fd;					/* -1为空闲 */
+	int len;
+	char buf[HOST_LINE];
+};
+
+/*
+ * 守护进程的全部状态
+ */
+struct mojd
+{
+	struct host host;
+	const char *moj;		/* moj的路径 */
+	const char *calib;		/* 校准文件，NULL为不校准 */
+	int lfd[2];				/* UNIX和TCP监听套接字，-1为没有 */
+	int sigfd[2];			/* SIGCHLD的自管道 */
+	struct mdconn conns[MOJD_CONNS];
+	struct hostjob *running;	/* 运行中的评测 */
+	int queued;				/* 等待中的评测数 */
+};
+
+/*
+ * 自管道的写端，供信号处理函数使用
+ */
+static int mojd_sigwrite = -1;
+
+/*
+ * 局部函数声明
+ */
+static int mojd_listen_unix(const char *path);
+static int mojd_listen_tcp(const char *addr, int port);
+static int mojd_calibrate(struct mojd *md);
+static void mojd_loop(struct mojd *md);
+static void mojd_accept(struct mojd *md, int lfd);
+static void mojd_read(struct mojd *md, struct mdconn *conn);
+static void mojd_request(struct mojd *md, int fd, const char *line);
+static void mojd_probe(struct mojd *md, int fd, const char *args);
+static void mojd_cancel(struct mojd *md, struct hostjob *job);
+static void mojd_start(struct mojd *md, struct hostjob *job);
+static void mojd_reap(struct mojd *md);
+static void mojd_sigchld(int signo);
+static void mojd_cloexec(int fd);
+
+/*
+ * 主函数：main
+ * 功能：参数解释，清点CPU，按需要校准，然后进入事件循环
+ * 参数：mojd [--unix path] [--tcp port] [--bind addr] [--hk n]
+ *   [--moj path] [--calibration file] [--policy fifo|sejf]
+ * 返回值：出错返回1，正常情况下不返回
+ */
+int
+main(int argc, char *argv[])
+{
+	struct mojd md;
+	const char *unixpath = NULL, *bindaddr = "127.0.0.1";
+	char errmsg[ERR_MSG_MAX];
+	int i, port = 0, nhk = 1;
+	enum hostpolicy policy = HOST_FIFO;
+
+	memset(&md, 0, sizeof(md));
+	md.moj = "moj";
+	for (i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc)
+			unixpath = argv[++i];
+		else if (strcmp(argv[i], "--tcp") == 0 && i + 1 < argc)
+			port = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc)
+			bindaddr = argv[++i];
+		else if (strcmp(argv[i], "--hk") == 0 && i + 1 < argc)
+			nhk = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--moj") == 0 && i + 1 < argc)
+			md.moj = argv[++i];
+		else if (strcmp(argv[i], "--calibration") == 0 && i + 1 < argc)
+			md.calib = argv[++i];
+		else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc &&
+				(strcmp(argv[i + 1], "fifo") == 0 ||
+				 strcmp(argv[i + 1], "sejf") == 0))
+			policy = strcmp(argv[++i], "sejf") == 0 ? HOST_SEJF : HOST_FIFO;
+		else
+			unixpath = NULL, port = 0, i = argc;
+	}
+	if (unixpath == NULL && port <= 0) {
+		fprintf(stderr, "usage: mojd [--unix path] [--tcp port] "
+				"[--bind addr] [--hk n] [--moj path] [--calibration file] "
+				"[--policy fifo|sejf]\n");
+		return 1;
+	}
+
+	if (host_init(&md.host, nhk, policy, errmsg) != 0) {
+		fprintf(stderr, "mojd: %s\n", errmsg);
+		return 1;
+	}
+	if (md.host.shared)
+		fprintf(stderr, "mojd: too few cores, timing is not isolated.\n");
+
+	/* 跟踪开销与CPU有关，在测量核上校准 */
+	if (md.calib != NULL && mojd_calibrate(&md) != 0)
+		return 1;
+
+	md.lfd[0] = md.lfd[1] = -1;
+	if (unixpath != NULL && (md.lfd[0] = mojd_listen_unix(unixpath)) == -1)
+		return 1;
+	if (port > 0 && (md.lfd[1] = mojd_listen_tcp(bindaddr, port)) == -1)
+		return 1;
+
+	for (i = 0; i < MOJD_CONNS; ++i)
+		md.conns[i].fd = -1;
+	if (pipe(md.sigfd) == -1) {
+		fprintf(stderr, "mojd: pipe: %s\n", strerror(errno));
+		return 1;
+	}
+	mojd_cloexec(md.sigfd[0]);
+	mojd_cloexec(md.sigfd[1]);
+	fcntl(md.sigfd[0], F_SETFL, O_NONBLOCK);
+	fcntl(md.sigfd[1], F_SETFL, O_NONBLOCK);
+	mojd_sigwrite = md.sigfd[1];
+	signal(SIGCHLD, mojd_sigchld);
+	signal(SIGPIPE, SIG_IGN);
+
+	mojd_loop(&md);
+	return 1;
+}
+
+/*
+ * 局部函数：mojd_listen_unix
+ * 功能：在UNIX套接字上监听
+ * 参数：path为套接字路径，已经存在则先删除
+ * 返回值：成功返回监听描述符，出错返回-1，错误写到标准出错
+ */
+static int
+mojd_listen_unix(const char *path)
+{
+	struct sockaddr_un sa;
+	int fd;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sa.sun_path)) {
+		fprintf(stderr, "mojd: %s: path too long\n", path);
+		return -1;
+	}
+	strcpy(sa.sun_path, path);
+	unlink(path);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+			bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1 ||
+			listen(fd, SOMAXCONN) == -1) {
+		fprintf(stderr, "mojd: %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	mojd_cloexec(fd);
+	return fd;
+}
+
+/*
+ * 局部函数：mojd_listen_tcp
+ * 功能：在TCP端口上监听
+ * 参数：addr为绑定的IPv4地址，port为端口
+ * 返回值：成功返回监听描述符，出错返回-1，错误写到标准出错
+ */
+static int
+mojd_listen_tcp(const char *addr, int port)
+{
+	struct sockaddr_in sa;
+	int fd, on = 1;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons(port);
+	if (inet_pton(AF_INET, addr, &sa.sin_addr) != 1) {
+		fprintf(stderr, "mojd: bad address %s\n", addr);
+		return -1;
+	}
+
+	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) == -1 ||
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1 ||
+			bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1 ||
+			listen(fd, SOMAXCONN) == -1) {
+		fprintf(stderr, "mojd: %s:%d: %s\n", addr, port, strerror(errno));
+		return -1;
+	}
+	mojd_cloexec(fd);
+	return fd;
+}
+
+/*
+ * 局部函数：mojd_calibrate
+ * 功能：启动时在第一个测量核上运行moj --calibrate
+ * 参数：md为守护进程状态
+ * 返回值：成功返回0，出错返回-1，错误写到标准出错
+ * 注意：之后每个评测都带上--calibration
+ */
+static int
+mojd_calibrate(struct mojd *md)
+{
+	unsigned long mask[HOST_CPU_WORDS];
+	int status, cpu = md->host.cores[0], bits = 8 * sizeof(unsigned long);
+	pid_t pid;
+
+	if ((pid = fork()) == -1) {
+		fprintf(stderr, "mojd: fork: %s\n", strerror(errno));
+		return -1;
+	} else if (pid == 0) {
+		memset(mask, 0, sizeof(mask));
+		mask[cpu / bits] |= 1UL << (cpu % bits);
+		syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask);
+		execlp(md->moj, md->moj, "--calibrate", md->calib, (char *)NULL);
+		fprintf(stderr, "mojd: exec %s: %s\n", md->moj, strerror(errno));
+		_exit(1);
+	}
+
+	if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) ||
+			WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "mojd: calibration failed.\n");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：mojd_loop
+ * 功能：事件循环，接收连接，读取请求，回收结束的moj，启动可以运行的评测
+ * 参数：md为守护进程状态
+ * 返回值：不返回
+ */
+static void
+mojd_loop(struct mojd *md)
+{
+	static struct pollfd pfds[3 + MOJD_CONNS + MOJD_QUEUE_MAX];
+	static struct hostjob *pjobs[MOJD_QUEUE_MAX];
+	struct hostjob *job;
+	char c;
+	int i, n, nconn, njob;
+
+	while (1) {
+		n = 0;
+		pfds[n].fd = md->sigfd[0];
+		pfds[n++].events = POLLIN;
+		for (i = 0; i < 2; ++i) {
+			pfds[n].fd = md->lfd[i];
+			pfds[n++].events = POLLIN;
+		}
+		for (i = 0; i < MOJD_CONNS; ++i) {
+			pfds[n].fd = md->conns[i].fd;
+			pfds[n++].events = POLLIN;
+		}
+		/* 等待中的客户端断开则取消评测 */
+		nconn = n;
+		njob = 0;
+		for (i = 0; i < HOST_CLASSES; ++i) {
+			for (job = md->host.queue[i]; job != NULL; job = job->next) {
+				pjobs[njob++] = job;
+				pfds[n].fd = job->fd;
+				pfds[n++].events = POLLIN;
+			}
+		}
+
+		if (poll(pfds, n, -1) == -1) {
+			if (errno != EINTR)
+				fprintf(stderr, "mojd: poll: %s\n", strerror(errno));
+			continue;
+		}
+
+		if (pfds[0].revents) {
+			while (read(md->sigfd[0], &c, 1) == 1)
+				;
+			mojd_reap(md);
+		}
+		for (i = 0; i < 2; ++i)
+			if (pfds[1 + i].revents)
+				mojd_accept(md, md->lfd[i]);
+		for (i = 0; i < MOJD_CONNS; ++i)
+			if (pfds[3 + i].revents)
+				mojd_read(md, &md->conns[i]);
+		for (i = 0; i < njob; ++i)
+			if (pfds[nconn + i].revents &&
+					(recv(pjobs[i]->fd, &c, 1, MSG_DONTWAIT) == 0 ||
+					 (pfds[nconn + i].revents & (POLLHUP | POLLERR))))
+				mojd_cancel(md, pjobs[i]);
+
+		while ((job = host_next(&md->host)) != NULL)
+			mojd_start(md, job);
+	}
+}
+
+/*
+ * 局部函数：mojd_accept
+ * 功能：接受一个连接，放入空闲的连接槽
+ * 参数：md为守护进程状态，lfd为监听描述符
+ * 返回值：无
+ */
+static void
+mojd_accept(struct mojd *md, int lfd)
+{
+	int i, fd;
+
+	if ((fd = accept(lfd, NULL, NULL)) == -1)
+		return;
+	mojd_cloexec(fd);
+
+	for (i = 0; i < MOJD_CONNS; ++i) {
+		if (md->conns[i].fd == -1) {
+			md->conns[i].fd = fd;
+			md->conns[i].len = 0;
+			return;
+		}
+	}
+	dprintf(fd, "%d\nExternal Error\n**mojd_accept** too many connections.\n",
+			EXIT_EE);
+	close(fd);
+}
+
+/*
+ * 局部函数：mojd_read
+ * 功能：读取连接上的请求，读到换行符时处理
+ * 参数：md为守护进程状态，conn为连接
+ * 返回值：无
+ */
+static void
+mojd_read(struct mojd *md, struct mdconn *conn)
+{
+	char *nl;
+	int n;
+
+	n = read(conn->fd, conn->buf + conn->len, HOST_LINE - 1 - conn->len);
+	if (n <= 0) {
+		close(conn->fd);
+		conn->fd = -1;
+		return;
+	}
+	conn->len += n;
+	conn->buf[conn->len] = '\0';
+
+	if ((nl = strchr(conn->buf, '\n')) == NULL) {
+		if (conn->len < HOST_LINE - 1)
+			return;
+		dprintf(conn->fd,
+				"%d\nExternal Error\n**mojd_read** request too long.\n",
+				EXIT_EE);
+		close(conn->fd);
+		conn->fd = -1;
+		return;
+	}
+
+	*nl = '\0';
+	mojd_request(md, conn->fd, conn->buf);
+	conn->fd = -1;
+}
+
+/*
+ * 局部函数：mojd_request
+ * 功能：处理一个请求行
+ * 参数：md为守护进程状态，fd为连接，由本函数接管，line为请求行
+ * 返回值：无
+ * 注意：status请求返回调度器状态，probe请求见mojd_probe；评测请求加入等待队列，
+ *   连接在moj结束时关闭
+ */
+static void
+mojd_request(struct mojd *md, int fd, const char *line)
+{
+	struct hostjob *job;
+	char errmsg[ERR_MSG_MAX], buf[1024];
+
+	if (strcmp(line, "status") == 0) {
+		write(fd, buf, host_status(&md->host, buf, sizeof(buf)));
+		close(fd);
+		return;
+	}
+	if (strncmp(line, "probe", 5) == 0 && (line[5] == '\0' || line[5] == ' ')) {
+		mojd_probe(md, fd, line + 5);
+		return;
+	}
+
+	if (md->queued >= MOJD_QUEUE_MAX) {
+		dprintf(fd, "%d\nExternal Error\n**mojd_request** queue full.\n",
+				EXIT_EE);
+		close(fd);
+		return;
+	}
+	if ((job = malloc(sizeof(struct hostjob))) == NULL) {
+		dprintf(fd, "%d\nInternal Error\n**mojd_request** malloc error.\n",
+				EXIT_IE);
+		close(fd);
+		return;
+	}
+	if (host_parse(job, line, errmsg) != 0) {
+		dprintf(fd, "%d\nExternal Error\n%s\n", EXIT_EE, errmsg);
+		close(fd);
+		free(job);
+		return;
+	}
+
+	job->fd = fd;
+	host_submit(&md->host, job);
+	++md->queued;
+}
+
+/*
+ * 局部函数：mojd_probe
+ * 功能：回答协调器mojc的探测请求"probe [<数据目录> [<仓库目录>]]"
+ * 参数：md为守护进程状态，fd为连接，由本函数关闭，args为probe之后的部分
+ * 返回值：无
+ * 注意：读取data.conf和检查数据文件是同步的，数据目录应该在本地磁盘上
+ */
+static void
+mojd_probe(struct mojd *md, int fd, const char *args)
+{
+	char copy[HOST_LINE], buf[256];
+	char *datadir, *store;
+
+	snprintf(copy, HOST_LINE, "%s", args);
+	datadir = strtok(copy, " \t\r");
+	store = datadir != NULL ? strtok(NULL, " \t\r") : NULL;
+	write(fd, buf, host_probe(&md->host, datadir, store, buf, sizeof(buf)));
+	close(fd);
+}
+
+/*
+ * 局部函数：mojd_cancel
+ * 功能：客户端在评测开始之前断开，从等待队列中删除
+ * 参数：md为守护进程状态，job为等待中的评测
+ * 返回值：无
+ */
+static void
+mojd_cancel(struct mojd *md, struct hostjob *job)
+{
+	struct hostjob **pp;
+
+	for (pp = &md->host.queue[job->cls]; *pp != NULL; pp = &(*pp)->next) {
+		if (*pp == job) {
+			*pp = job->next;
+			break;
+		}
+	}
+	close(job->fd);
+	free(job);
+	--md->queued;
+}
+
+/*
+ * 局部函数：mojd_start
+ * 功能：启动一个moj进程运行评测
+ * 参数：md为守护进程状态，job为host_next选出的评测
+ * 返回值：无
+ * 注意：moj本身和检查程序绑定到杂务核，用户进程由--cpu绑定到测量核；
+ *   moj的标准输出就是客户端连接
+ */
+static void
+mojd_start(struct mojd *md, struct hostjob *job)
+{
+	char *argv[HOST_ARGS + 6], cpu[16];
+	int i, n = 0, null;
+	pid_t pid;
+
+	--md->queued;
+	if ((pid = fork()) == -1) {
+		dprintf(job->fd, "%d\nInternal Error\n**mojd_start** fork error: %s\n",
+				EXIT_IE, strerror(errno));
+		host_release(&md->host, job);
+		close(job->fd);
+		free(job);
+		return;
+
+	} else if (pid == 0) {
+		signal(SIGCHLD, SIG_DFL);
+		signal(SIGPIPE, SIG_DFL);
+		syscall(SYS_sched_setaffinity, 0, sizeof(md->host.hkmask),
+				md->host.hkmask);
+		if ((null = open("/dev/null", O_RDWR)) != -1) {
+			dup2(null, STDIN_FILENO);
+			dup2(null, STDERR_FILENO);
+		}
+		dup2(job->fd, STDOUT_FILENO);
+
+		snprintf(cpu, sizeof(cpu), "%d", md->host.cores[job->core]);
+		argv[n++] = (char *)md->moj;
+		argv[n++] = "--cpu";
+		argv[n++] = cpu;
+		if (md->calib != NULL) {
+			argv[n++] = "--calibration";
+			argv[n++] = (char *)md->calib;
+		}
+		for (i = 0; i < job->argc; ++i)
+			argv[n++] = job->argv[i];
+		argv[n] = NULL;
+
+		/* _exit不刷新stdio的缓冲区，直接写描述符 */
+		execvp(md->moj, argv);
+		dprintf(STDOUT_FILENO,
+				"%d\nInternal Error\n**mojd_start** exec %s error: %s\n",
+				EXIT_IE, md->moj, strerror(errno));
+		_exit(1);
+	}
+
+	close(job->fd);
+	job->fd = -1;
+	job->pid = pid;
+	job->next = md->running;
+	md->running = job;
+}
+
+/*
+ * 局部函数：mojd_reap
+ * 功能：回收结束的moj进程，归还资源
+ * 参数：md为守护进程状态
+ * 返回值：无
+ */
+static void
+mojd_reap(struct mojd *md)
+{
+	struct hostjob **pp, *job;
+	pid_t pid;
+
+	while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+		for (pp = &md->running; *pp != NULL; pp = &(*pp)->next) {
+			if ((*pp)->pid == pid) {
+				job = *pp;
+				*pp = job->next;
+				host_release(&md->host, job);
+				free(job);
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * 局部函数：mojd_sigchld
+ * 功能：SIGCHLD信号处理函数，写自管道唤醒事件循环
+ * 参数：signo为信号编号
+ * 返回值：无
+ */
+static void
+mojd_sigchld(int signo)
+{
+	int err = errno;
+
+	if (signo == SIGCHLD)
+		write(mojd_sigwrite, "c", 1);
+	errno = err;
+}
+
+/*
+ * 局部函数：mojd_cloexec
+ * 功能：设置描述符在exec时关闭，moj不继承守护进程的描述符
+ * 参数：fd为描述符
+ * 返回值：无
+ */
+static void
+mojd_cloexec(int fd)
+{
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
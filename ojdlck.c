@@ -0,0 +1,743 @@
+/*************************************************
+ * 源文件：ojdlck.c
+ * 模块功能：检查题目数据目录的布局，生成data.conf和清单文件，
+ *   布局规则见doc/HowTo_ojdlck.txt
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "global.h"
+#include "data.h"
+#include "hash.h"
+#include "store.h"
+#include "source.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/*
+ * 数据目录中的文件类型，以文件名后缀标识，压缩后缀不计
+ */
+enum dltype
+{
+	DL_IN,			/* 单组输入文件 */
+	DL_OUT,			/* 单组答案文件 */
+	DL_EXE,			/* 单组答案程序 */
+	DL_ALLOUT,		/* 全局答案文件 */
+	DL_ALLEXE,		/* 全局答案程序 */
+	DL_TYPES
+};
+
+/*
+ * 数据目录中的一个文件
+ */
+struct dlfile
+{
+	char *name;				/* 文件名 */
+	char *base;				/* 去掉类型后缀和压缩后缀的文件名 */
+	enum dltype type;
+	int packed;				/* 是否为压缩文件 */
+	char *command;			/* .gen文件中的生成命令，其他文件为NULL */
+	struct stat st;
+	unsigned char hash[HASH_LEN];
+	int reused;				/* 摘要来自旧的清单 */
+	int nul;				/* 文本文件中有'\0'字符 */
+	char ref[STORE_REF_MAX];	/* 仓库引用，需要--store */
+	char errmsg[ERR_MSG_MAX];	/* 非空则计算摘要出错 */
+};
+
+/*
+ * 一组测试的输入和答案，输入为NULL表示/dev/null
+ */
+struct dlpair
+{
+	struct dlfile *in;
+	struct dlfile *ans;
+};
+
+/*
+ * 计算摘要的线程共享的数据
+ */
+struct dljob
+{
+	struct dlfile *files;
+	int count;
+	int next;				/* 下一个待处理的文件 */
+	pthread_mutex_t lock;
+	const char *dir;		/* 数据目录的绝对路径 */
+	const char *store;		/* 数据仓库，NULL为不存入 */
+};
+
+/*
+ * 局部函数声明
+ */
+static int dl_scan(const char *dir, struct dlfile **files, int *count);
+static int dl_classify(const char *name, struct dlfile *file);
+static void * dl_worker(void *arg);
+static int dl_hash(const char *path, struct dlfile *file);
+static int dl_command(const char *path, struct dlfile *file);
+static int dl_pair(struct dlfile *files, int count,
+		struct dlpair **pairs, int *npair);
+static int dl_validate(const char *dir, struct dlfile *files, int count);
+static int dl_write_conf(const char *dir, const struct dataset *old,
+		const char *store, struct dlpair *pairs, int npair);
+static int dl_write_manifest(const char *dir, struct dlfile *files,
+		int count);
+static const char * dl_entry(const char *dir, const char *store,
+		const struct dlfile *file, char *buf);
+static int dl_key_cmp(const void *a, const void *b);
+static int dl_pair_cmp(const void *a, const void *b);
+static int dl_natural_cmp(const char *a, const char *b);
+
+/*
+ * 主函数：main
+ * 功能：参数解释，扫描数据目录，并行计算摘要，生成data.conf和清单
+ * 参数：ojdlck [-j 线程数] [--store 仓库目录] <数据目录>
+ * 返回值：成功返回0，布局错误或出错返回1
+ */
+int
+main(int argc, char *argv[])
+{
+	int i, count, npair, nthread = 0, hashed = 0, reused = 0;
+	const char *dirarg = NULL, *storearg = NULL;
+	char dir[PATH_MAX], store[PATH_MAX], path[PATH_MAX];
+	char errmsg[ERR_MSG_MAX];
+	struct dlfile *files;
+	struct dlpair *pairs;
+	const struct ddentry *ent;
+	struct dataset *old = NULL;	/* 旧的data.conf和清单 */
+	struct dljob job;
+	pthread_t *tids;
+
+	for (i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			nthread = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--store") == 0 && i + 1 < argc)
+			storearg = argv[++i];
+		else if (dirarg == NULL)
+			dirarg = argv[i];
+		else
+			dirarg = NULL, i = argc;
+	}
+	if (dirarg == NULL || nthread < 0) {
+		fprintf(stderr,
+				"usage: ojdlck [-j threads] [--store dir] <directory>\n");
+		return 1;
+	}
+
+	if (realpath(dirarg, dir) == NULL) {
+		fprintf(stderr, "ojdlck: %s: %s\n", dirarg, strerror(errno));
+		return 1;
+	}
+	if (storearg != NULL && realpath(storearg, store) == NULL) {
+		fprintf(stderr, "ojdlck: %s: %s\n", storearg, strerror(errno));
+		return 1;
+	}
+
+	/* 读入旧的data.conf和清单，保留题目选项，未改变的文件不再计算摘要 */
+	snprintf(path, PATH_MAX, "%s/data.conf", dir);
+	if (access(path, F_OK) == 0 && (old = dd_open(dir, ".", errmsg)) == NULL) {
+		fprintf(stderr, "ojdlck: %s\n", errmsg);
+		return 1;
+	}
+
+	if (dl_scan(dir, &files, &count) != 0)
+		return 1;
+
+	for (i = 0; i < count; ++i) {
+		snprintf(path, PATH_MAX, "%s/%s", dir, files[i].name);
+		ent = old != NULL ? dd_find_entry(old, path) : NULL;
+		if (ent != NULL && ent->size == files[i].st.st_size &&
+				ent->mtime_sec == files[i].st.st_mtim.tv_sec &&
+				ent->mtime_nsec == files[i].st.st_mtim.tv_nsec) {
+			memcpy(files[i].hash, ent->hash, HASH_LEN);
+			files[i].reused = 1;
+		}
+	}
+
+	/* 先检查布局，布局错误就不用计算摘要了 */
+	if (dl_pair(files, count, &pairs, &npair) != 0)
+		return 1;
+
+	/* 并行计算摘要，需要时存入仓库 */
+	if (nthread == 0)
+		nthread = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthread > count)
+		nthread = count;
+	if (nthread < 1)
+		nthread = 1;
+
+	job.files = files;
+	job.count = count;
+	job.next = 0;
+	job.dir = dir;
+	job.store = storearg != NULL ? store : NULL;
+	pthread_mutex_init(&job.lock, NULL);
+	if ((tids = malloc(sizeof(pthread_t) * nthread)) == NULL) {
+		fprintf(stderr, "ojdlck: malloc error.\n");
+		return 1;
+	}
+	for (i = 0; i < nthread; ++i) {
+		if (pthread_create(&tids[i], NULL, dl_worker, &job) != 0) {
+			fprintf(stderr, "ojdlck: pthread_create error.\n");
+			return 1;
+		}
+	}
+	for (i = 0; i < nthread; ++i)
+		pthread_join(tids[i], NULL);
+
+	for (i = 0; i < count; ++i) {
+		if (files[i].errmsg[0] != '\0') {
+			fprintf(stderr, "ojdlck: %s\n", files[i].errmsg);
+			return 1;
+		}
+		files[i].reused ? ++reused : ++hashed;
+	}
+
+	if (dl_validate(dir, files, count) != 0)
+		return 1;
+	if (dl_write_conf(dir, old, job.store, pairs, npair) != 0)
+		return 1;
+	if (dl_write_manifest(dir, files, count) != 0)
+		return 1;
+
+	printf("%s: %d cases, %d files hashed, %d reused\n",
+			dir, npair, hashed, reused);
+	dd_close(old);
+	return 0;
+}
+
+/*
+ * 局部函数：dl_scan
+ * 功能：扫描数据目录，找出特定类型的文件，按名称和类型排序
+ * 参数：dir为数据目录，files和count接收文件数组和个数
+ * 返回值：成功返回0，出错返回-1，错误写到标准出错
+ */
+static int
+dl_scan(const char *dir, struct dlfile **files, int *count)
+{
+	int size = 0;
+	DIR *dp;
+	struct dirent *de;
+	struct dlfile file, *tmp;
+	char path[PATH_MAX];
+
+	if ((dp = opendir(dir)) == NULL) {
+		fprintf(stderr, "ojdlck: opendir %s: %s\n", dir, strerror(errno));
+		return -1;
+	}
+
+	*files = NULL;
+	*count = 0;
+	while ((de = readdir(dp)) != NULL) {
+		memset(&file, 0, sizeof(file));
+		if (dl_classify(de->d_name, &file) != 0)
+			continue;
+
+		/* 只处理普通文件，符号链接按其目标处理 */
+		snprintf(path, PATH_MAX, "%s/%s", dir, de->d_name);
+		if (stat(path, &file.st) == -1 || !S_ISREG(file.st.st_mode)) {
+			free(file.name);
+			free(file.base);
+			continue;
+		}
+		if (strchr(de->d_name, '\n') != NULL) {
+			fprintf(stderr, "ojdlck: %s: newline in file name\n", path);
+			closedir(dp);
+			return -1;
+		}
+		if (strcmp(strrchr(de->d_name, '.'), ".gen") == 0 &&
+				dl_command(path, &file) != 0) {
+			closedir(dp);
+			return -1;
+		}
+
+		if (*count == size) {
+			size = size == 0 ? 256 : size * 2;
+			if ((tmp = realloc(*files, sizeof(struct dlfile) * size))
+					== NULL) {
+				fprintf(stderr, "ojdlck: realloc error.\n");
+				closedir(dp);
+				return -1;
+			}
+			*files = tmp;
+		}
+		(*files)[(*count)++] = file;
+	}
+	closedir(dp);
+
+	qsort(*files, *count, sizeof(struct dlfile), dl_key_cmp);
+	return 0;
+}
+
+/*
+ * 局部函数：dl_classify
+ * 功能：按文件名判断文件类型
+ * 参数：name为文件名，file接收名称、类型等字段
+ * 返回值：是特定类型的文件返回0，否则返回-1
+ */
+static int
+dl_classify(const char *name, struct dlfile *file)
+{
+	char *base, *dot;
+
+	if ((base = strdup(name)) == NULL)
+		return -1;
+
+	/* 先去掉压缩后缀 */
+	file->packed = src_packed(base);
+	if (file->packed)
+		*strrchr(base, '.') = '\0';
+
+	dot = strrchr(base, '.');
+	if (dot == NULL || dot == base) {
+		free(base);
+		return -1;
+	}
+
+	if (strcmp(base, "all.out") == 0)
+		file->type = DL_ALLOUT;
+	else if (strcmp(base, "all.exe") == 0)
+		file->type = DL_ALLEXE;
+	else if (strcmp(dot, ".in") == 0 || strcmp(dot, ".gen") == 0)
+		file->type = DL_IN;
+	else if (strcmp(dot, ".out") == 0)
+		file->type = DL_OUT;
+	else if (strcmp(dot, ".exe") == 0)
+		file->type = DL_EXE;
+	else {
+		free(base);
+		return -1;
+	}
+
+	/* 答案程序和生成命令由评测程序直接使用，不能是压缩文件 */
+	if (file->packed && (file->type == DL_EXE ||
+				file->type == DL_ALLEXE || strcmp(dot, ".gen") == 0)) {
+		free(base);
+		return -1;
+	}
+
+	*dot = '\0';
+	file->base = base;
+	if ((file->name = strdup(name)) == NULL) {
+		free(base);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：dl_worker
+ * 功能：计算摘要的线程，逐个领取文件直到没有剩余
+ * 参数：arg为struct dljob
+ * 返回值：NULL
+ * 注意：摘要已经来自清单的文件只需要存入仓库
+ */
+static void *
+dl_worker(void *arg)
+{
+	int i;
+	struct dljob *job = arg;
+	struct dlfile *file;
+	char path[PATH_MAX];
+
+	while (1) {
+		pthread_mutex_lock(&job->lock);
+		i = job->next++;
+		pthread_mutex_unlock(&job->lock);
+		if (i >= job->count)
+			break;
+
+		file = &job->files[i];
+		snprintf(path, PATH_MAX, "%s/%s", job->dir, file->name);
+		if (!file->reused && dl_hash(path, file) != 0)
+			continue;
+		/* 生成的数据不在仓库中，数据行总是生成命令 */
+		if (job->store != NULL && file->command == NULL)
+			store_put(job->store, path, file->hash, file->ref,
+					file->errmsg);
+	}
+	return NULL;
+}
+
+/*
+ * 局部函数：dl_hash
+ * 功能：计算文件内容的摘要，同时检查文本文件中是否有'\0'字符
+ * 参数：path为文件路径，file接收摘要和检查结果
+ * 返回值：成功返回0，出错返回-1，错误写入file->errmsg
+ */
+static int
+dl_hash(const char *path, struct dlfile *file)
+{
+	int fd, n;
+	char buf[65536];
+	struct hashctx ctx;
+	int text = !file->packed &&
+		file->type != DL_EXE && file->type != DL_ALLEXE;
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		snprintf(file->errmsg, ERR_MSG_MAX, "open %s: %s",
+				path, strerror(errno));
+		return -1;
+	}
+
+	hash_init(&ctx);
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		hash_update(&ctx, buf, n);
+		if (text && !file->nul && memchr(buf, '\0', n) != NULL)
+			file->nul = 1;
+	}
+	close(fd);
+	if (n == -1) {
+		snprintf(file->errmsg, ERR_MSG_MAX, "read %s: %s",
+				path, strerror(errno));
+		return -1;
+	}
+
+	hash_final(&ctx, file->hash);
+	return 0;
+}
+
+/*
+ * 局部函数：dl_command
+ * 功能：读取.gen文件中的生成命令
+ * 参数：path为文件路径，file接收命令
+ * 返回值：成功返回0，出错返回-1，错误写到标准出错
+ * 注意：命令为第一个非空行，格式为"程序 参数..."，
+ *   程序的相对路径相对于数据目录
+ */
+static int
+dl_command(const char *path, struct dlfile *file)
+{
+	FILE *fp;
+	char line[PATH_MAX], *p;
+	size_t len;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "ojdlck: fopen %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	p = NULL;
+	while (fgets(line, PATH_MAX, fp) != NULL) {
+		p = line + strspn(line, " \t\r\n");
+		if (*p != '\0')
+			break;
+		p = NULL;
+	}
+	fclose(fp);
+
+	if (p == NULL) {
+		fprintf(stderr, "ojdlck: %s: empty generator command\n", path);
+		return -1;
+	}
+	len = strlen(p);
+	while (len > 0 && isspace((unsigned char)p[len - 1]))
+		p[--len] = '\0';
+
+	if ((file->command = strdup(p)) == NULL) {
+		fprintf(stderr, "ojdlck: strdup error.\n");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：dl_pair
+ * 功能：按布局规则检查文件个数，并为每个输入文件配对答案
+ * 参数：files和count为按名称和类型排序的文件，
+ *   pairs接收按输入文件名自然顺序排列的配对，npair接收对数
+ * 返回值：布局正确返回0，否则返回-1，错误写到标准出错
+ */
+static int
+dl_pair(struct dlfile *files, int count, struct dlpair **pairs, int *npair)
+{
+	int i, k, n[DL_TYPES] = { 0 };
+	enum dltype atype;
+	struct dlfile *all = NULL, key;
+
+	for (i = 0; i < count; ++i) {
+		++n[files[i].type];
+
+		/* 同一个名称的压缩和未压缩文件不能同时存在，排序后它们相邻 */
+		if (i > 0 && dl_key_cmp(&files[i], &files[i - 1]) == 0) {
+			fprintf(stderr, "ojdlck: %s and %s are ambiguous\n",
+					files[i - 1].name, files[i].name);
+			return -1;
+		}
+		if (files[i].type == DL_ALLOUT || files[i].type == DL_ALLEXE)
+			all = &files[i];
+	}
+
+	/* 规则1：无输入文件，则答案有且必须有一个 */
+	if (n[DL_IN] == 0) {
+		if (count != 1) {
+			fprintf(stderr, "ojdlck: no input, %d answers\n", count);
+			return -1;
+		}
+		if ((*pairs = malloc(sizeof(struct dlpair))) == NULL) {
+			fprintf(stderr, "ojdlck: malloc error.\n");
+			return -1;
+		}
+		(*pairs)[0].in = NULL;
+		(*pairs)[0].ans = &files[0];
+		*npair = 1;
+		return 0;
+	}
+
+	/* 规则2：四种答案只能且必须有其中一种，个数为1或者与输入相同 */
+	if (n[DL_ALLOUT] == 1 && count == n[DL_IN] + 1)
+		atype = DL_ALLOUT;
+	else if (n[DL_ALLEXE] == 1 && count == n[DL_IN] + 1)
+		atype = DL_ALLEXE;
+	else if (n[DL_OUT] == n[DL_IN] && count == n[DL_IN] * 2)
+		atype = DL_OUT;
+	else if (n[DL_EXE] == n[DL_IN] && count == n[DL_IN] * 2)
+		atype = DL_EXE;
+	else {
+		fprintf(stderr, "ojdlck: bad layout: %d .in, %d .out, %d .exe, "
+				"%d all.out, %d all.exe\n", n[DL_IN], n[DL_OUT], n[DL_EXE],
+				n[DL_ALLOUT], n[DL_ALLEXE]);
+		return -1;
+	}
+
+	if ((*pairs = malloc(sizeof(struct dlpair) * n[DL_IN])) == NULL) {
+		fprintf(stderr, "ojdlck: malloc error.\n");
+		return -1;
+	}
+
+	/* 规则4：单组答案与输入文件名相同，按名称和类型二分查找 */
+	for (i = 0, k = 0; i < count; ++i) {
+		if (files[i].type != DL_IN)
+			continue;
+		(*pairs)[k].in = &files[i];
+		(*pairs)[k].ans = all;
+		if (atype == DL_OUT || atype == DL_EXE) {
+			key.base = files[i].base;
+			key.type = atype;
+			(*pairs)[k].ans = bsearch(&key, files, count,
+					sizeof(struct dlfile), dl_key_cmp);
+			if ((*pairs)[k].ans == NULL) {
+				fprintf(stderr, "ojdlck: no answer for %s\n",
+						files[i].name);
+				free(*pairs);
+				return -1;
+			}
+		}
+		++k;
+	}
+
+	/* 按输入文件名的自然顺序排列，2.in在10.in之前 */
+	qsort(*pairs, k, sizeof(struct dlpair), dl_pair_cmp);
+	*npair = k;
+	return 0;
+}
+
+/*
+ * 局部函数：dl_validate
+ * 功能：检查文件内容，答案文件不能为空，答案程序必须可执行，
+ *   文本文件中的'\0'字符只给出警告
+ * 参数：dir为数据目录，files和count为文件数组
+ * 返回值：通过返回0，否则返回-1，错误写到标准出错
+ */
+static int
+dl_validate(const char *dir, struct dlfile *files, int count)
+{
+	int i, ret = 0;
+	char path[PATH_MAX];
+
+	for (i = 0; i < count; ++i) {
+		snprintf(path, PATH_MAX, "%s/%s", dir, files[i].name);
+		if ((files[i].type == DL_OUT || files[i].type == DL_ALLOUT) &&
+				files[i].st.st_size == 0) {
+			fprintf(stderr, "ojdlck: %s: empty answer\n", path);
+			ret = -1;
+		}
+		if ((files[i].type == DL_EXE || files[i].type == DL_ALLEXE) &&
+				access(path, X_OK) != 0) {
+			fprintf(stderr, "ojdlck: %s: not executable\n", path);
+			ret = -1;
+		}
+		if (files[i].nul)
+			fprintf(stderr, "ojdlck: warning: %s: contains '\\0'\n", path);
+	}
+	return ret;
+}
+
+/*
+ * 局部函数：dl_write_conf
+ * 功能：生成data.conf，保留旧文件中的题目选项
+ * 参数：dir为数据目录，old为旧的数据集，可以为NULL，
+ *   store为仓库目录，不为NULL则数据行写成仓库引用，
+ *   并设置@store选项，pairs和npair为配对
+ * 返回值：成功返回0，出错返回-1
+ * 注意：先写临时文件再改名，评测不会读到不完整的data.conf
+ */
+static int
+dl_write_conf(const char *dir, const struct dataset *old,
+		const char *store, struct dlpair *pairs, int npair)
+{
+	int i;
+	FILE *fp;
+	const char *key, *val;
+	char path[PATH_MAX], tmp[PATH_MAX], buf[PATH_MAX];
+
+	snprintf(path, PATH_MAX, "%s/data.conf", dir);
+	snprintf(tmp, PATH_MAX, "%s/data.conf.%d", dir, getpid());
+	if ((fp = fopen(tmp, "w")) == NULL) {
+		fprintf(stderr, "ojdlck: fopen %s: %s\n", tmp, strerror(errno));
+		return -1;
+	}
+
+	fprintf(fp, "# generated by ojdlck, '@' options are kept\n");
+	for (i = 0; old != NULL && i < dd_get_option_count(old); ++i) {
+		key = dd_get_option_key(old, i);
+		if (store != NULL && strcmp(key, "store") == 0)
+			continue;
+		val = dd_get_option_value(old, i);
+		fprintf(fp, val[0] != '\0' ? "@%s %s\n" : "@%s\n", key, val);
+	}
+	if (store != NULL)
+		fprintf(fp, "@store %s\n", store);
+
+	fprintf(fp, "%d\n", npair * 2);
+	for (i = 0; i < npair; ++i) {
+		fprintf(fp, "%s\n", dl_entry(dir, store, pairs[i].in, buf));
+		fprintf(fp, "%s\n", dl_entry(dir, store, pairs[i].ans, buf));
+	}
+
+	if (fclose(fp) == EOF || rename(tmp, path) == -1) {
+		fprintf(stderr, "ojdlck: write %s: %s\n", path, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：dl_write_manifest
+ * 功能：生成清单文件，格式见data.h
+ * 参数：dir为数据目录，files和count为文件数组
+ * 返回值：成功返回0，出错返回-1
+ */
+static int
+dl_write_manifest(const char *dir, struct dlfile *files, int count)
+{
+	int i;
+	FILE *fp;
+	char path[PATH_MAX], tmp[PATH_MAX], hex[HASH_HEX];
+
+	snprintf(path, PATH_MAX, "%s/%s", dir, DD_MANIFEST);
+	snprintf(tmp, PATH_MAX, "%s/%s.%d", dir, DD_MANIFEST, getpid());
+	if ((fp = fopen(tmp, "w")) == NULL) {
+		fprintf(stderr, "ojdlck: fopen %s: %s\n", tmp, strerror(errno));
+		return -1;
+	}
+
+	for (i = 0; i < count; ++i) {
+		hash_hex(files[i].hash, hex);
+		fprintf(fp, "%s %lld %ld.%09ld %s\n", hex,
+				(long long)files[i].st.st_size,
+				(long)files[i].st.st_mtim.tv_sec,
+				(long)files[i].st.st_mtim.tv_nsec, files[i].name);
+	}
+
+	if (fclose(fp) == EOF || rename(tmp, path) == -1) {
+		fprintf(stderr, "ojdlck: write %s: %s\n", path, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：dl_entry
+ * 功能：生成data.conf中的一个数据行
+ * 参数：dir为数据目录，store为仓库目录，file为文件，NULL为/dev/null，
+ *   buf为缓冲区（PATH_MAX）
+ * 注意：.gen文件写成"!命令"，由评测程序运行生成程序得到输入
+ * 返回值：数据行
+ */
+static const char *
+dl_entry(const char *dir, const char *store, const struct dlfile *file,
+		char *buf)
+{
+	if (file == NULL)
+		return "/dev/null";
+	if (file->command != NULL) {
+		snprintf(buf, PATH_MAX, "!%s", file->command);
+		return buf;
+	}
+	if (store != NULL)
+		return file->ref;
+	snprintf(buf, PATH_MAX, "%s/%s", dir, file->name);
+	return buf;
+}
+
+/*
+ * 局部函数：dl_key_cmp
+ * 功能：按名称和类型比较两个文件，提供给qsort和bsearch
+ * 参数：a和b为struct dlfile
+ * 返回值：同strcmp
+ */
+static int
+dl_key_cmp(const void *a, const void *b)
+{
+	const struct dlfile *fa = a, *fb = b;
+	int ret;
+
+	if ((ret = strcmp(fa->base, fb->base)) != 0)
+		return ret;
+	return (int)fa->type - (int)fb->type;
+}
+
+/*
+ * 局部函数：dl_pair_cmp
+ * 功能：按输入文件名的自然顺序比较两组测试，提供给qsort
+ * 参数：a和b为struct dlpair
+ * 返回值：同strcmp
+ */
+static int
+dl_pair_cmp(const void *a, const void *b)
+{
+	return dl_natural_cmp(((const struct dlpair *)a)->in->name,
+			((const struct dlpair *)b)->in->name);
+}
+
+/*
+ * 局部函数：dl_natural_cmp
+ * 功能：自然顺序比较文件名，连续的数字按数值比较
+ * 参数：a和b为文件名
+ * 返回值：同strcmp
+ */
+static int
+dl_natural_cmp(const char *a, const char *b)
+{
+	size_t la, lb;
+
+	while (*a != '\0' && *b != '\0') {
+		if (isdigit((unsigned char)*a) && isdigit((unsigned char)*b)) {
+			/* 跳过前导零，位数多的数值大，位数相同逐位比较 */
+			while (*a == '0')
+				++a;
+			while (*b == '0')
+				++b;
+			for (la = 0; isdigit((unsigned char)a[la]); ++la)
+				;
+			for (lb = 0; isdigit((unsigned char)b[lb]); ++lb)
+				;
+			if (la != lb)
+				return la < lb ? -1 : 1;
+			if (strncmp(a, b, la) != 0)
+				return strncmp(a, b, la);
+			a += la;
+			b += lb;
+			continue;
+		}
+		if (*a != *b)
+			return (unsigned char)*a - (unsigned char)*b;
+		++a;
+		++b;
+	}
+	return (unsigned char)*a - (unsigned char)*b;
+}
@@ -0,0 +1,333 @@
+/*************************************************
+ * 源文件：order.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "order.h"
+
+/*
+ * 局部函数声明
+ */
+static void order_path(const char *dir, const char *datadir, char *path);
+static int order_parse(struct order *od, int fd);
+static int order_compare(const void *a, const void *b);
+
+/*
+ * order_sort排序的元素，带上统计，比较函数不需要访问order结构
+ */
+struct orderkey
+{
+	int index;				/* 测试序号 */
+	int fails;				/* 见struct casestat */
+	int time;
+};
+
+/*
+ * 接口函数：order_load
+ * 功能：读取题目的历史统计，运行顺序初始化为data.conf中的顺序
+ * 参数：od为待初始化的结构，dir为统计目录，datadir为题目数据目录，
+ *   count为测试组数，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：统计文件以数据目录绝对路径的摘要命名；
+ *   文件不存在或组数不一致，则从空的统计开始
+ */
+int
+order_load(struct order *od, const char *dir, const char *datadir,
+		int count, char *errmsg)
+{
+	int i, fd;
+
+	memset(od, 0, sizeof(struct order));
+	order_path(dir, datadir, od->path);
+
+	od->count = count;
+	od->newcost = -1;
+	od->stats = calloc(count + 1, sizeof(struct casestat));
+	od->newtime = malloc(sizeof(int) * (count + 1));
+	od->seq = malloc(sizeof(int) * (count + 1));
+	if (od->stats == NULL || od->newtime == NULL || od->seq == NULL) {
+		sprintf(errmsg, "**order_load** malloc error.");
+		order_free(od);
+		return -1;
+	}
+	for (i = 0; i < count; ++i) {
+		od->newtime[i] = -1;
+		od->seq[i] = i;
+	}
+
+	if ((fd = open(od->path, O_RDONLY)) == -1)
+		return 0;
+	flock(fd, LOCK_SH);
+	order_parse(od, fd);
+	close(fd);
+
+	return 0;
+}
+
+/*
+ * 接口函数：order_sort
+ * 功能：按历史统计安排运行顺序
+ * 参数：od为已经读取了统计的结构
+ * 返回值：无
+ * 注意：先运行单位时间内最可能成为首个错误的测试，
+ *   从未出错的测试按时间从小到大，相同时保持原来的顺序；
+ *   内存不足时保持原来的顺序，只影响速度不影响结果
+ */
+void
+order_sort(struct order *od)
+{
+	struct orderkey *keys;
+	int i;
+
+	if ((keys = malloc(sizeof(struct orderkey) * (od->count + 1))) == NULL)
+		return;
+	for (i = 0; i < od->count; ++i) {
+		keys[i].index = od->seq[i];
+		keys[i].fails = od->stats[od->seq[i]].fails;
+		keys[i].time = od->stats[od->seq[i]].time;
+	}
+	qsort(keys, od->count, sizeof(struct orderkey), order_compare);
+	for (i = 0; i < od->count; ++i)
+		od->seq[i] = keys[i].index;
+	free(keys);
+}
+
+/*
+ * 接口函数：order_record
+ * 功能：记录本次评测中一组正确测试的运行时间
+ * 参数：od为统计，index为data.conf中的序号，time为运行时间
+ * 返回值：无
+ */
+void
+order_record(struct order *od, int index, int time)
+{
+	if (index >= 0 && index < od->count)
+		od->newtime[index] = time;
+}
+
+/*
+ * 接口函数：order_cost
+ * 功能：记录本次评测的墙上时间
+ * 参数：od为统计，cost为从开始评测到全部测试结束的毫秒数
+ * 返回值：无
+ */
+void
+order_cost(struct order *od, int cost)
+{
+	od->newcost = cost;
+}
+
+/*
+ * 接口函数：order_save
+ * 功能：把本次评测的结果合并到统计文件
+ * 参数：od为统计，fail为首个错误测试的序号，没有错误为-1，
+ *   errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：在排它锁下重新读取文件后再合并，并发的评测不会丢失记录；
+ *   平均时间和评测耗时都是指数滑动平均，新的时间占1/4
+ */
+int
+order_save(struct order *od, int fail, char *errmsg)
+{
+	int i, n, len, fd;
+	char *buf;
+	struct casestat *st;
+
+	fd = open(od->path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP);
+	if (fd == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**order_save** open %s error: %s",
+				od->path, strerror(errno));
+		return -1;
+	}
+	flock(fd, LOCK_EX);
+
+	/* 其他评测可能已经更新了文件 */
+	memset(od->stats, 0, sizeof(struct casestat) * od->count);
+	od->judged = 0;
+	od->cost = 0;
+	order_parse(od, fd);
+
+	++od->judged;
+	if (od->newcost >= 0)
+		od->cost = od->cost == 0 ? od->newcost :
+			(od->cost * 3 + od->newcost) / 4;
+	if (fail >= 0 && fail < od->count)
+		++od->stats[fail].fails;
+	for (i = 0; i < od->count; ++i) {
+		st = &od->stats[i];
+		if (od->newtime[i] < 0)
+			continue;
+		if (st->time == 0)
+			st->time = od->newtime[i];
+		else
+			st->time = (st->time * 3 + od->newtime[i]) / 4;
+	}
+
+	len = 64 + od->count * 24;
+	if ((buf = malloc(len)) == NULL) {
+		sprintf(errmsg, "**order_save** malloc error.");
+		close(fd);
+		return -1;
+	}
+	n = snprintf(buf, len, "%s %d %d %d\n", ORDER_VERSION,
+			od->count, od->judged, od->cost);
+	for (i = 0; i < od->count; ++i)
+		n += snprintf(buf + n, len - n, "%d %d\n",
+				od->stats[i].fails, od->stats[i].time);
+
+	if (ftruncate(fd, 0) == -1 || pwrite(fd, buf, n, 0) != n) {
+		snprintf(errmsg, ERR_MSG_MAX, "**order_save** write %s error: %s",
+				od->path, strerror(errno));
+		free(buf);
+		close(fd);
+		return -1;
+	}
+
+	free(buf);
+	close(fd);
+	return 0;
+}
+
+/*
+ * 接口函数：order_free
+ * 功能：释放order_load分配的空间
+ * 参数：od为统计
+ * 返回值：无
+ */
+void
+order_free(struct order *od)
+{
+	free(od->stats);
+	free(od->newtime);
+	free(od->seq);
+	od->stats = NULL;
+	od->newtime = NULL;
+	od->seq = NULL;
+}
+
+/*
+ * 接口函数：order_expect
+ * 功能：读取题目评测的平均耗时，不需要知道测试组数
+ * 参数：dir为统计目录，datadir为题目数据目录
+ * 返回值：平均耗时，单位毫秒；没有统计或者统计正在被写入返回-1
+ * 注意：由mojd在评测开始之前调用，按预计耗时安排排队顺序；
+ *   在mojd的事件循环中调用，不能阻塞在文件锁上
+ */
+int
+order_expect(const char *dir, const char *datadir)
+{
+	char path[PATH_MAX], version[32];
+	int count, judged, cost;
+	FILE *fp;
+
+	order_path(dir, datadir, path);
+	if ((fp = fopen(path, "r")) == NULL)
+		return -1;
+	/* 有评测正在写统计时不等待，按没有统计处理 */
+	if (flock(fileno(fp), LOCK_SH | LOCK_NB) == -1) {
+		fclose(fp);
+		return -1;
+	}
+	if (fscanf(fp, "%31s %d %d %d", version, &count, &judged, &cost) != 4 ||
+			strcmp(version, ORDER_VERSION) != 0 || cost <= 0)
+		cost = -1;
+	fclose(fp);
+	return cost;
+}
+
+/*
+ * 局部函数：order_path
+ * 功能：得到题目的统计文件路径
+ * 参数：dir为统计目录，datadir为题目数据目录，path接收路径
+ * 返回值：无
+ * 注意：统计文件以数据目录绝对路径的摘要命名
+ */
+static void
+order_path(const char *dir, const char *datadir, char *path)
+{
+	char real[PATH_MAX];
+	char hex[HASH_HEX];
+	unsigned char key[HASH_LEN];
+	struct hashctx ctx;
+
+	if (realpath(datadir, real) == NULL)
+		snprintf(real, PATH_MAX, "%s", datadir);
+
+	hash_init(&ctx);
+	hash_update(&ctx, real, strlen(real));
+	hash_final(&ctx, key);
+	hash_hex(key, hex);
+	snprintf(path, PATH_MAX, "%s/%s", dir, hex);
+}
+
+/*
+ * 局部函数：order_parse
+ * 功能：从统计文件读取历史统计
+ * 参数：od为统计，fd为统计文件
+ * 返回值：成功返回0，文件格式不对或组数不一致返回-1，统计保持为空
+ */
+static int
+order_parse(struct order *od, int fd)
+{
+	int i, n, count, judged, cost, skip;
+	char *buf, *p;
+	struct stat st;
+	char version[32];
+
+	if (fstat(fd, &st) == -1 || st.st_size == 0)
+		return -1;
+	if ((buf = malloc(st.st_size + 1)) == NULL)
+		return -1;
+	if ((n = pread(fd, buf, st.st_size, 0)) <= 0) {
+		free(buf);
+		return -1;
+	}
+	buf[n] = '\0';
+
+	if (sscanf(buf, "%31s %d %d %d%n", version, &count, &judged, &cost,
+				&skip) != 4 ||
+			strcmp(version, ORDER_VERSION) != 0 || count != od->count) {
+		free(buf);
+		return -1;
+	}
+
+	p = buf + skip;
+	for (i = 0; i < count; ++i) {
+		if (sscanf(p, "%d %d%n", &od->stats[i].fails,
+					&od->stats[i].time, &skip) != 2) {
+			memset(od->stats, 0, sizeof(struct casestat) * od->count);
+			free(buf);
+			return -1;
+		}
+		p += skip;
+	}
+	od->judged = judged;
+	od->cost = cost;
+
+	free(buf);
+	return 0;
+}
+
+/*
+ * 局部函数：order_compare
+ * 功能：qsort的比较函数，比较两组测试谁先运行
+ * 参数：a和b指向struct orderkey
+ * 返回值：a先运行返回负数，b先运行返回正数
+ * 注意：比较fails_a / time_a与fails_b / time_b，交叉相乘避免除法，
+ *   时间加10毫秒，避免极快的测试使比值失去意义
+ */
+static int
+order_compare(const void *a, const void *b)
+{
+	const struct orderkey *sa = a, *sb = b;
+	int ia = sa->index, ib = sb->index;
+	long long ka, kb;
+
+	ka = (long long)sa->fails * (sb->time + 10);
+	kb = (long long)sb->fails * (sa->time + 10);
+	if (ka != kb)
+		return ka > kb ? -1 : 1;
+	if (sa->time != sb->time)
+		return sa->time < sb->time ? -1 : 1;
+	return ia - ib;
+}
@@ -0,0 +1,62 @@
+/***************************************************************
+ * 文件名：order.h
+ * 模块功能：记录每个题目各组测试的历史统计（首个错误的次数和
+ *   运行时间），并据此安排测试的运行顺序，使错误的程序尽早失败；
+ *   还记录整个评测的耗时，供mojd估计排队的评测需要多久
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include "hash.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#ifndef ORDER_H
+#define ORDER_H
+
+/*
+ * 统计文件格式的版本
+ */
+#define ORDER_VERSION "moj-stats-2"
+
+/*
+ * 单组测试的历史统计
+ */
+struct casestat
+{
+	int fails;				/* 作为首个错误测试的次数 */
+	int time;				/* 正确时的平均运行时间，单位毫秒 */
+};
+
+/*
+ * 一个题目的统计和本次评测的运行顺序
+ */
+struct order
+{
+	char path[PATH_MAX];	/* 统计文件路径 */
+	int count;				/* 测试组数 */
+	int judged;				/* 历史评测次数 */
+	int cost;				/* 整个评测的平均墙上时间，单位毫秒，0为没有 */
+	int newcost;			/* 本次评测的墙上时间，-1为没有 */
+	struct casestat *stats;	/* 每组测试的统计 */
+	int *newtime;			/* 本次评测每组的运行时间，-1为没有 */
+	int *seq;				/* 本次评测的运行顺序 */
+};
+
+int order_load(struct order *od, const char *dir, const char *datadir,
+		int count, char *errmsg);
+void order_sort(struct order *od);
+void order_record(struct order *od, int index, int time);
+void order_cost(struct order *od, int cost);
+int order_save(struct order *od, int fail, char *errmsg);
+void order_free(struct order *od);
+int order_expect(const char *dir, const char *datadir);
+
+#endif
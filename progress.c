@@ -0,0 +1,151 @@
+/*************************************************
+ * 源文件：progress.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "progress.h"
+
+/*
+ * 局部函数声明
+ */
+static void prg_flush(struct progress *prg);
+
+/*
+ * 接口函数：prg_init
+ * 功能：初始化进度通道，把描述符设为非阻塞，并且不被用户程序继承
+ * 参数：prg为进度通道，fd为事件描述符，-1为不输出事件，errmsg接收错误信息
+ * 返回值：成功返回0，描述符无效返回-1
+ * 注意：O_NONBLOCK设置在打开的文件上，与描述符的其他副本共享
+ */
+int
+prg_init(struct progress *prg, int fd, char *errmsg)
+{
+	int flags;
+	struct stat st;
+
+	prg->fd = -1;
+	prg->gone = 0;
+	prg->cancel = 0;
+	prg->len = 0;
+	prg->dropped = 0;
+	if (fd == -1)
+		return 0;
+
+	if (fstat(fd, &st) == -1 || (flags = fcntl(fd, F_GETFL)) == -1 ||
+			fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1 ||
+			fcntl(fd, F_SETFD, FD_CLOEXEC) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**prg_init** fd %d error: %s", fd, strerror(errno));
+		return -1;
+	}
+	prg->fd = fd;
+
+	/* 普通文件总是可读，写到文件时不能取消 */
+	prg->cancel = S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode);
+	return 0;
+}
+
+/*
+ * 接口函数：prg_event
+ * 功能：输出一个事件，不会阻塞
+ * 参数：prg为进度通道，fmt和后面的参数同printf，不需要换行符
+ * 返回值：无
+ * 注意：读者跟不上时事件暂存在缓冲区中，下次输出时先写出；
+ *   缓冲区放不下则丢弃该事件，只计数，读者看到的总是完整的行
+ */
+void
+prg_event(struct progress *prg, const char *fmt, ...)
+{
+	char line[256];
+	va_list ap;
+	int n;
+
+	if (prg->fd == -1 || prg->gone)
+		return;
+
+	va_start(ap, fmt);
+	n = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return;
+	if (n > (int)sizeof(line) - 2)
+		n = sizeof(line) - 2;
+	line[n++] = '\n';
+
+	if (prg->len + n > PRG_BUF) {
+		prg_flush(prg);
+		if (prg->len + n > PRG_BUF) {
+			++prg->dropped;
+			return;
+		}
+	}
+	memcpy(prg->buf + prg->len, line, n);
+	prg->len += n;
+	prg_flush(prg);
+}
+
+/*
+ * 局部函数：prg_flush
+ * 功能：尽量写出暂存的事件
+ * 参数：prg为进度通道
+ * 返回值：无
+ * 注意：写的时候屏蔽SIGPIPE，读者已经关闭时不会杀死评测程序，
+ *   产生的SIGPIPE在恢复屏蔽字之前取走；之后不再输出事件
+ */
+static void
+prg_flush(struct progress *prg)
+{
+	sigset_t set, old;
+	struct timespec zero = {0, 0};
+	ssize_t n;
+
+	if (prg->fd == -1 || prg->gone || prg->len == 0)
+		return;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGPIPE);
+	sigprocmask(SIG_BLOCK, &set, &old);
+	while (prg->len > 0) {
+		n = write(prg->fd, prg->buf, prg->len);
+		if (n > 0) {
+			memmove(prg->buf, prg->buf + n, prg->len - n);
+			prg->len -= n;
+			continue;
+		}
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1 && errno == EPIPE) {
+			sigtimedwait(&set, NULL, &zero);
+			prg->gone = 1;
+			prg->len = 0;
+		}
+		break;
+	}
+	sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+/*
+ * 接口函数：prg_cancelled
+ * 功能：检查调用者是否要求取消评测，不会阻塞
+ * 参数：prg为进度通道
+ * 返回值：要求取消返回1，否则返回0
+ * 注意：对方写入任何数据或者关闭了写端（套接字），关闭了读端（管道和套接字）
+ *   都表示取消；事件写到普通文件等其他描述符时不能取消
+ */
+int
+prg_cancelled(struct progress *prg)
+{
+	struct pollfd pfd;
+
+	if (prg->fd == -1 || !prg->cancel)
+		return 0;
+	if (prg->gone)
+		return 1;
+
+	pfd.fd = prg->fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) != 1)
+		return 0;
+	return (pfd.revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+}
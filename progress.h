@@ -0,0 +1,45 @@
+/***************************************************************
+ * 文件名：progress.h
+ * 模块功能：评测期间把每组测试的开始和结果作为事件写到调用者给出的
+ *   描述符，调用者可以借此显示进度或者提前取消评测
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+/*
+ * 写不出去的事件暂存的长度，满了之后新的事件被丢弃
+ */
+#define PRG_BUF 4096
+
+/*
+ * 进度通道，由tester模块在评测期间持有
+ */
+struct progress
+{
+	int fd;					/* 事件描述符，-1为不输出事件 */
+	int gone;				/* 读者已经关闭，之后不再输出事件 */
+	int cancel;				/* 读者能否取消评测，只有管道和套接字可以 */
+	int len;				/* buf中尚未写出的长度 */
+	int dropped;			/* 被丢弃的事件个数 */
+	char buf[PRG_BUF];		/* 尚未写出的事件，总是完整的行 */
+};
+
+int prg_init(struct progress *prg, int fd, char *errmsg);
+void prg_event(struct progress *prg, const char *fmt, ...);
+int prg_cancelled(struct progress *prg);
+
+#endif
@@ -0,0 +1,236 @@
+/*************************************************
+ * 源文件：sample.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "sample.h"
+
+/*
+ * 局部函数声明
+ */
+static void smp_tick(int signo);
+static int smp_now(struct sampler *smp);
+static void smp_compact(struct sampler *smp);
+
+/*
+ * 接口函数：smp_open
+ * 功能：打开用户进程的statm文件，并创建周期性的采样定时器
+ * 参数：smp为待初始化的采样器，pid为用户进程ID，
+ *   interval为采样间隔（毫秒），trace接收时间序列，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：定时器到期发送SIGUSR1，其作用只是打断case模块中阻塞的wait4；
+ *   原来的SIGUSR1处理方式保存在smp中，smp_close时恢复
+ */
+int
+smp_open(struct sampler *smp, pid_t pid, int interval,
+		struct memtrace *trace, char *errmsg)
+{
+	char path[64];
+	struct sigaction act;
+	struct sigevent sev;
+	struct itimerspec its;
+
+	memset(smp, 0, sizeof(struct sampler));
+	smp->interval = interval;
+	smp->trace = trace;
+	trace->count = 0;
+
+	sprintf(path, "/proc/%d/statm", pid);
+	if ((smp->fd = open(path, O_RDONLY)) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**smp_open** open %s error: %s", path, strerror(errno));
+		return -1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &smp->start);
+
+	/* 不设置SA_RESTART，使得wait4返回EINTR */
+	memset(&act, 0, sizeof(act));
+	act.sa_handler = smp_tick;
+	sigemptyset(&act.sa_mask);
+	if (sigaction(SIGUSR1, &act, &smp->oldact) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**smp_open** sigaction error: %s", strerror(errno));
+		close(smp->fd);
+		return -1;
+	}
+	smp->hooked = 1;
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_SIGNAL;
+	sev.sigev_signo = SIGUSR1;
+	if (timer_create(CLOCK_MONOTONIC, &sev, &smp->timer) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**smp_open** timer_create error: %s", strerror(errno));
+		sigaction(SIGUSR1, &smp->oldact, NULL);
+		close(smp->fd);
+		return -1;
+	}
+	smp->armed = 1;
+
+	its.it_value.tv_sec = interval / 1000;
+	its.it_value.tv_nsec = interval % 1000 * 1000000L;
+	its.it_interval = its.it_value;
+	timer_settime(smp->timer, 0, &its, NULL);
+
+	return 0;
+}
+
+/*
+ * 接口函数：smp_record
+ * 功能：读取一次用户进程的内存使用，记录为一个采样点
+ * 参数：smp为采样器，force为1则忽略采样间隔强制读取
+ * 返回值：返回最近一次读取到的虚拟内存（kb），读取出错返回-1
+ * 注意：用pread从偏移0读取，不需要重新打开statm；
+ *   采样间隔内的强制读取只更新最后一个点的峰值，不增加点，
+ *   内存有关的系统调用再多，序列也只按采样间隔增长
+ */
+int
+smp_record(struct sampler *smp, int force)
+{
+	int n, now, vm, rss;
+	char buf[128];
+	struct memsample *pt;
+
+	now = smp_now(smp);
+	if (!force && smp->trace->count > 0 && now - smp->last < smp->interval)
+		return smp->last_vm;
+
+	if ((n = pread(smp->fd, buf, sizeof(buf) - 1, 0)) <= 0)
+		return -1;
+	buf[n] = '\0';
+	if (sscanf(buf, "%d %d", &vm, &rss) != 2)
+		return -1;
+
+	vm = vm * (getpagesize() / 1024);
+	rss = rss * (getpagesize() / 1024);
+
+	smp->last_vm = vm;
+	if (smp->trace->count > 0 && now - smp->last < smp->interval) {
+		pt = &smp->trace->points[smp->trace->count - 1];
+		if (rss > pt->rss)
+			pt->rss = rss;
+		if (vm > pt->vm)
+			pt->vm = vm;
+		return vm;
+	}
+
+	if (smp->trace->count >= SMP_MAX)
+		smp_compact(smp);
+
+	pt = &smp->trace->points[smp->trace->count++];
+	pt->time = now;
+	pt->rss = rss;
+	pt->vm = vm;
+
+	smp->last = now;
+	return vm;
+}
+
+/*
+ * 接口函数：smp_close
+ * 功能：删除定时器，恢复原来的SIGUSR1处理方式，关闭statm文件
+ * 参数：smp为采样器
+ * 返回值：无
+ * 注意：先删除定时器再恢复，之后不会再有定时器的SIGUSR1
+ */
+void
+smp_close(struct sampler *smp)
+{
+	if (smp->armed) {
+		timer_delete(smp->timer);
+		smp->armed = 0;
+	}
+	if (smp->hooked) {
+		sigaction(SIGUSR1, &smp->oldact, NULL);
+		smp->hooked = 0;
+	}
+	if (smp->fd != -1) {
+		close(smp->fd);
+		smp->fd = -1;
+	}
+}
+
+/*
+ * 接口函数：smp_format
+ * 功能：把时间序列格式化为一行文本，每个点为time:rss:vm
+ * 参数：trace为时间序列，buf和size为输出缓冲区
+ * 返回值：返回写入的字节数
+ */
+int
+smp_format(const struct memtrace *trace, char *buf, int size)
+{
+	int i, n;
+
+	n = snprintf(buf, size, "memtrace %d", trace->count);
+	for (i = 0; i < trace->count && n < size; ++i)
+		n += snprintf(buf + n, size - n, " %d:%d:%d",
+				trace->points[i].time, trace->points[i].rss,
+				trace->points[i].vm);
+
+	return n < size ? n : size - 1;
+}
+
+/*
+ * 局部函数：smp_tick
+ * 功能：定时器信号处理函数
+ * 参数：signo为信号编号
+ * 返回值：无
+ * 注意：什么也不做，采样在case模块的wait4返回之后进行
+ */
+static void
+smp_tick(int signo)
+{
+	(void)signo;
+}
+
+/*
+ * 局部函数：smp_now
+ * 功能：计算距离采样开始的时间
+ * 参数：smp为采样器
+ * 返回值：单位为毫秒的时间
+ */
+static int
+smp_now(struct sampler *smp)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec - smp->start.tv_sec) * 1000 +
+		(ts.tv_nsec - smp->start.tv_nsec) / 1000000;
+}
+
+/*
+ * 局部函数：smp_compact
+ * 功能：序列满时把相邻两个采样点合并为一个，采样间隔加倍
+ * 参数：smp为采样器
+ * 返回值：无
+ * 注意：合并时保留两点中较大的内存值，短暂的内存峰值不会丢失；
+ *   间隔不超过SMP_INTERVAL_MAX，定时器按新的间隔重新设置
+ */
+static void
+smp_compact(struct sampler *smp)
+{
+	int i;
+	struct itimerspec its;
+	struct memsample *pts = smp->trace->points;
+
+	for (i = 0; i < SMP_MAX / 2; ++i) {
+		pts[i].time = pts[i * 2].time;
+		pts[i].rss = pts[i * 2].rss > pts[i * 2 + 1].rss ?
+			pts[i * 2].rss : pts[i * 2 + 1].rss;
+		pts[i].vm = pts[i * 2].vm > pts[i * 2 + 1].vm ?
+			pts[i * 2].vm : pts[i * 2 + 1].vm;
+	}
+	smp->trace->count = SMP_MAX / 2;
+	if (smp->interval >= SMP_INTERVAL_MAX)
+		return;
+
+	smp->interval = smp->interval * 2 < SMP_INTERVAL_MAX ?
+		smp->interval * 2 : SMP_INTERVAL_MAX;
+	if (smp->armed) {
+		its.it_value.tv_sec = smp->interval / 1000;
+		its.it_value.tv_nsec = smp->interval % 1000 * 1000000L;
+		its.it_interval = its.it_value;
+		timer_settime(smp->timer, 0, &its, NULL);
+	}
+}
@@ -0,0 +1,73 @@
+/***************************************************************
+ * 文件名：sample.h
+ * 模块功能：在用户程序运行期间对其内存使用进行采样，
+ *   得到一个紧凑的内存使用时间序列，附加在单组测试结果中
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+/*
+ * 时间序列最多保存的采样点个数，满了则两两合并
+ */
+#define SMP_MAX 64
+
+/*
+ * 合并后采样间隔的上限，单位毫秒
+ */
+#define SMP_INTERVAL_MAX 60000
+
+/*
+ * 单个采样点
+ */
+struct memsample
+{
+	int time;				/* 距离execve成功的时间，单位毫秒 */
+	int rss;				/* 常驻内存，单位kb */
+	int vm;					/* 虚拟内存，单位kb */
+};
+
+/*
+ * 内存使用的时间序列
+ */
+struct memtrace
+{
+	int count;				/* 有效的采样点个数 */
+	struct memsample points[SMP_MAX];
+};
+
+/*
+ * 采样器，由case模块在监控用户进程期间持有
+ */
+struct sampler
+{
+	int fd;					/* 持久打开的/proc/<pid>/statm */
+	int interval;			/* 当前采样间隔，单位毫秒，合并后加倍 */
+	int last;				/* 上一次采样的时间 */
+	int last_vm;			/* 上一次读取到的虚拟内存 */
+	int armed;				/* 定时器是否已经创建 */
+	timer_t timer;			/* 周期性打断wait4的定时器 */
+	int hooked;				/* 是否已经安装SIGUSR1的处理函数 */
+	struct sigaction oldact;	/* 安装之前的SIGUSR1处理方式 */
+	struct timespec start;	/* 采样开始的时间 */
+	struct memtrace *trace;	/* 结果写到这里 */
+};
+
+int smp_open(struct sampler *smp, pid_t pid, int interval,
+		struct memtrace *trace, char *errmsg);
+int smp_record(struct sampler *smp, int force);
+void smp_close(struct sampler *smp);
+int smp_format(const struct memtrace *trace, char *buf, int size);
+
+#endif
@@ -0,0 +1,178 @@
+/*************************************************
+ * 源文件：sandbox.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "sandbox.h"
+
+#ifndef CLONE_NEWNS
+#define CLONE_NEWNS 0x00020000
+#define CLONE_NEWUTS 0x04000000
+#define CLONE_NEWIPC 0x08000000
+#define CLONE_NEWPID 0x20000000
+#define CLONE_NEWNET 0x40000000
+#endif
+
+/*
+ * 用户进程所在的命名空间
+ */
+#define SBX_CLONE_FLAGS (CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWNET | \
+		CLONE_NEWIPC | CLONE_NEWUTS)
+
+/*
+ * 局部函数声明
+ */
+static int sbx_mount(const char *src, const char *rootfs, const char *dir,
+		const char *type, unsigned long flags, const char *data,
+		char *errmsg);
+static int sbx_dir(const char *rootfs, const char *dir);
+
+/*
+ * 接口函数：sbx_check
+ * 功能：检查根文件系统是否可用
+ * 参数：rootfs为根文件系统的目录，errmsg接收错误信息
+ * 返回值：可用返回0，否则返回-1
+ * 注意：根文件系统只读使用，挂载点必须预先建好
+ */
+int
+sbx_check(const char *rootfs, char *errmsg)
+{
+	if (!sbx_dir(rootfs, "")) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**sbx_check** %s is not a directory.", rootfs);
+		return -1;
+	}
+	if (!sbx_dir(rootfs, SBX_BOX) || !sbx_dir(rootfs, SBX_TMP)) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**sbx_check** %s needs directories %s and %s.",
+				rootfs, SBX_BOX, SBX_TMP);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 接口函数：sbx_fork
+ * 功能：创建子进程，rootfs不为NULL时子进程在新的命名空间中
+ * 参数：rootfs为根文件系统的目录，NULL则同fork
+ * 返回值：同fork
+ * 注意：创建命名空间需要超级权限，调用期间暂时切换到超级用户，
+ *   返回时父子进程都已切换回来，子进程照常由child模块设置；
+ *   子进程是新pid命名空间中的1号进程，它结束时命名空间中的进程全部被杀死
+ */
+pid_t
+sbx_fork(const char *rootfs)
+{
+	pid_t pid;
+	int err;
+
+	if (rootfs == NULL)
+		return fork();
+
+	if (setreuid(geteuid(), getuid()) == -1)
+		return -1;
+	pid = syscall(SYS_clone, SBX_CLONE_FLAGS | SIGCHLD, NULL, NULL, NULL, NULL);
+	err = errno;
+	if (setreuid(geteuid(), getuid()) == -1 && pid == 0)
+		_exit(1);
+	errno = err;
+	return pid;
+}
+
+/*
+ * 接口函数：sbx_enter
+ * 功能：在sbx_fork创建的子进程中准备根目录并进入
+ * 参数：rootfs为根文件系统的目录，basedir为用户程序的工作目录，
+ *   errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：挂载都在子进程私有的mount命名空间中，子进程结束时自动消失，
+ *   不需要卸载；根文件系统只读，SBX_TMP是新建的tmpfs，
+ *   basedir可写地绑定到SBX_BOX并作为工作目录
+ */
+int
+sbx_enter(const char *rootfs, const char *basedir, char *errmsg)
+{
+	/* 切换到超级用户，注意父进程中是暂时放弃了超级用户权限的 */
+	if (setreuid(geteuid(), getuid()) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**sbx_enter** setreuid[1] error: %s", strerror(errno));
+		return -1;
+	}
+
+	/* 挂载不能传播到宿主的命名空间 */
+	if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**sbx_enter** mount / private error: %s", strerror(errno));
+		return -1;
+	}
+
+	if (sbx_mount(rootfs, rootfs, "", NULL, MS_BIND | MS_REC, NULL,
+				errmsg) != 0 ||
+			sbx_mount(NULL, rootfs, "", NULL, MS_REMOUNT | MS_BIND |
+				MS_RDONLY | MS_NOSUID | MS_NODEV, NULL, errmsg) != 0 ||
+			sbx_mount("tmpfs", rootfs, SBX_TMP, "tmpfs",
+				MS_NOSUID | MS_NODEV, SBX_TMP_OPTIONS, errmsg) != 0 ||
+			sbx_mount(basedir, rootfs, SBX_BOX, NULL, MS_BIND,
+				NULL, errmsg) != 0 ||
+			sbx_mount(NULL, rootfs, SBX_BOX, NULL, MS_REMOUNT | MS_BIND |
+				MS_NOSUID | MS_NODEV, NULL, errmsg) != 0)
+		return -1;
+	if (sbx_dir(rootfs, SBX_PROC) && sbx_mount("proc", rootfs, SBX_PROC,
+				"proc", MS_NOSUID | MS_NODEV | MS_NOEXEC, NULL, errmsg) != 0)
+		return -1;
+
+	sethostname("moj", 3);
+
+	if (chroot(rootfs) == -1 || chdir(SBX_BOX) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**sbx_enter** chroot %s error: %s", rootfs, strerror(errno));
+		return -1;
+	}
+
+	/* 切换回到普通用户，之后由child模块降低权限 */
+	if (setreuid(geteuid(), getuid()) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**sbx_enter** setreuid[2] error: %s", strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：sbx_mount
+ * 功能：在根文件系统中挂载一个目录
+ * 参数：src, type, flags, data同mount，目标为rootfs和dir拼接的路径，
+ *   errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ */
+static int
+sbx_mount(const char *src, const char *rootfs, const char *dir,
+		const char *type, unsigned long flags, const char *data,
+		char *errmsg)
+{
+	char path[PATH_MAX];
+
+	snprintf(path, PATH_MAX, "%s%s", rootfs, dir);
+	if (mount(src, path, type, flags, data) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**sbx_mount** mount %s error: %s",
+				path, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：sbx_dir
+ * 功能：判断根文件系统中的路径是否为目录
+ * 参数：rootfs为根文件系统，dir为其中的路径
+ * 返回值：是目录返回1，否则返回0
+ */
+static int
+sbx_dir(const char *rootfs, const char *dir)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	snprintf(path, PATH_MAX, "%s%s", rootfs, dir);
+	return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
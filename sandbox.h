@@ -0,0 +1,40 @@
+/***************************************************************
+ * 文件名：sandbox.h
+ * 模块功能：在独立的mount，pid，net，ipc，uts命名空间中运行用户程序，
+ *   根目录为预先准备好的只读根文件系统
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mount.h>
+#include <sys/syscall.h>
+
+#ifndef SANDBOX_H
+#define SANDBOX_H
+
+/*
+ * 根文件系统中的挂载点：basedir绑定到SBX_BOX作为工作目录，
+ *   SBX_TMP挂载每次运行新建的tmpfs，SBX_PROC存在时挂载新的proc
+ */
+#define SBX_BOX "/box"
+#define SBX_TMP "/tmp"
+#define SBX_PROC "/proc"
+
+/*
+ * 每次运行的tmpfs的挂载选项
+ */
+#define SBX_TMP_OPTIONS "size=64m,nr_inodes=4096,mode=1777"
+
+int sbx_check(const char *rootfs, char *errmsg);
+pid_t sbx_fork(const char *rootfs);
+int sbx_enter(const char *rootfs, const char *basedir, char *errmsg);
+
+#endif
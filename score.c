@@ -0,0 +1,264 @@
+/*************************************************
+ * 源文件：score.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "score.h"
+
+/*
+ * 局部函数声明
+ */
+static int scr_parse(struct scoring *sc, const char *val, char *errmsg);
+static int scr_weight(const struct scoring *sc, int task);
+static int scr_contains(const struct scoring *sc, int task, int index);
+static int scr_passed(const struct scoring *sc, int task);
+
+/*
+ * 接口函数：scr_range
+ * 功能：判断一组测试是否在测试范围内
+ * 参数：list为逗号分隔的序号或者"起-止"，从1开始，index为data.conf顺序的序号，从0开始
+ * 返回值：在范围内返回1，否则返回0
+ * 注意：--cases和@subtask使用同样的格式
+ */
+int
+scr_range(const char *list, int index)
+{
+	const char *p = list;
+	char *end;
+	long lo, hi;
+
+	while (*p != '\0') {
+		lo = hi = strtol(p, &end, 10);
+		if (*end == '-')
+			hi = strtol(end + 1, &end, 10);
+		if (index + 1 >= lo && index + 1 <= hi)
+			return 1;
+		if (*end != ',')
+			break;
+		p = end + 1;
+	}
+	return 0;
+}
+
+/*
+ * 接口函数：scr_init
+ * 功能：读取数据集中的子任务，准备记录每组测试的结果
+ * 参数：sc为评分，mode为评分方式，不能是SCR_OFF，ds为数据集，errmsg接收错误信息
+ * 返回值：成功返回0，子任务格式错误或出错返回-1
+ * 注意：子任务的测试范围可以重叠；每个子任务至少包含一组测试，
+ *   不属于任何子任务的测试不计分
+ */
+int
+scr_init(struct scoring *sc, enum scoremode mode,
+		const struct dataset *ds, char *errmsg)
+{
+	int i, j;
+
+	sc->mode = mode;
+	sc->count = 0;
+	sc->ncase = dd_get_count(ds);
+	sc->cases = malloc(sizeof(struct scorecase) * (sc->ncase + 1));
+	if (sc->cases == NULL) {
+		sprintf(errmsg, "**scr_init** malloc error.");
+		return -1;
+	}
+	for (i = 0; i < sc->ncase; ++i)
+		sc->cases[i].code = -1;
+
+	for (i = 0; i < dd_get_option_count(ds); ++i) {
+		if (strcmp(dd_get_option_key(ds, i), "subtask") != 0)
+			continue;
+		if (scr_parse(sc, dd_get_option_value(ds, i), errmsg) != 0)
+			goto errexit;
+	}
+
+	for (i = 0; i < sc->count; ++i) {
+		for (j = 0; j < sc->ncase && !scr_contains(sc, i, j); ++j)
+			;
+		if (j == sc->ncase) {
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**scr_init** @subtask %d: no cases.", i + 1);
+			goto errexit;
+		}
+	}
+	return 0;
+
+errexit:
+	scr_free(sc);
+	return -1;
+}
+
+/*
+ * 局部函数：scr_parse
+ * 功能：解释一个子任务选项的值"<分值> <测试范围>"
+ * 参数：sc为评分，val为选项的值，errmsg接收错误信息
+ * 返回值：成功返回0，格式错误返回-1
+ */
+static int
+scr_parse(struct scoring *sc, const char *val, char *errmsg)
+{
+	struct subtask *task;
+	char *end;
+	long weight;
+
+	if (sc->count >= SCR_MAX) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**scr_parse** more than %d subtasks.", SCR_MAX);
+		return -1;
+	}
+
+	weight = strtol(val, &end, 10);
+	if (end == val || (*end != ' ' && *end != '\t') ||
+			weight < 0 || weight > INT_MAX / SCR_MAX)
+		goto fmterr;
+	while (*end == ' ' || *end == '\t')
+		++end;
+	if (*end == '\0' || strspn(end, "0123456789,-") != strlen(end))
+		goto fmterr;
+
+	task = &sc->tasks[sc->count++];
+	task->weight = weight;
+	task->cases = end;
+	return 0;
+
+fmterr:
+	snprintf(errmsg, ERR_MSG_MAX,
+			"**scr_parse** @subtask %s: format error.", val);
+	return -1;
+}
+
+/*
+ * 接口函数：scr_needed
+ * 功能：判断一组测试是否还需要运行
+ * 参数：sc为评分，index为测试序号，从0开始
+ * 返回值：需要运行返回1，否则返回0
+ * 注意：SCR_SKIP时，包含该组测试的子任务都已经有错误的测试，
+ *   该组测试不会再影响得分，不需要运行；子任务互不依赖，其他子任务继续
+ */
+int
+scr_needed(const struct scoring *sc, int index)
+{
+	int i;
+
+	if (sc->mode != SCR_SKIP || sc->count == 0)
+		return 1;
+
+	for (i = 0; i < sc->count; ++i)
+		if (scr_contains(sc, i, index) && scr_passed(sc, i))
+			return 1;
+	return 0;
+}
+
+/*
+ * 接口函数：scr_record
+ * 功能：记录一组测试的结果
+ * 参数：sc为评分，index为测试序号，code，time和memory为测试结果
+ * 返回值：无
+ */
+void
+scr_record(struct scoring *sc, int index, int code, int time, int memory)
+{
+	if (index < 0 || index >= sc->ncase)
+		return;
+	sc->cases[index].code = code;
+	sc->cases[index].time = time;
+	sc->cases[index].memory = memory;
+}
+
+/*
+ * 接口函数：scr_report
+ * 功能：计算得分，作为附加行写入评测结果
+ * 参数：sc为评分，res为评测结果
+ * 返回值：无
+ * 注意：附加行依次为"score <得分> <总分>"，有子任务时每个子任务一行
+ *   "subtask <序号> <得分> <分值>"，最后每组测试一行
+ *   "test <序号> <状态码> <时间>ms <内存>kb"，没有运行的为"test <序号> skip"
+ */
+void
+scr_report(const struct scoring *sc, struct result *res)
+{
+	int i, n, got = 0, total = 0;
+
+	n = sc->count > 0 ? sc->count : sc->ncase;
+	for (i = 0; i < n; ++i) {
+		total += scr_weight(sc, i);
+		if (scr_passed(sc, i))
+			got += scr_weight(sc, i);
+	}
+	exit_extra(res, "score %d %d", got, total);
+
+	for (i = 0; i < sc->count; ++i)
+		exit_extra(res, "subtask %d %d %d", i + 1,
+				scr_passed(sc, i) ? sc->tasks[i].weight : 0,
+				sc->tasks[i].weight);
+
+	for (i = 0; i < sc->ncase; ++i) {
+		if (sc->cases[i].code == -1)
+			exit_extra(res, "test %d skip", i + 1);
+		else
+			exit_extra(res, "test %d %d %dms %dkb", i + 1,
+					sc->cases[i].code, sc->cases[i].time,
+					sc->cases[i].memory);
+	}
+}
+
+/*
+ * 接口函数：scr_free
+ * 功能：释放scr_init分配的空间
+ * 参数：sc为评分，cases为NULL时什么也不做
+ * 返回值：无
+ */
+void
+scr_free(struct scoring *sc)
+{
+	free(sc->cases);
+	sc->cases = NULL;
+}
+
+/*
+ * 局部函数：scr_weight
+ * 功能：获取子任务的分值
+ * 参数：sc为评分，task为子任务序号
+ * 返回值：分值；没有子任务时SCR_TOTAL平均分配给每组测试，余数分散在各组中
+ */
+static int
+scr_weight(const struct scoring *sc, int task)
+{
+	if (sc->count > 0)
+		return sc->tasks[task].weight;
+	return SCR_TOTAL * (task + 1) / sc->ncase - SCR_TOTAL * task / sc->ncase;
+}
+
+/*
+ * 局部函数：scr_contains
+ * 功能：判断子任务是否包含一组测试
+ * 参数：sc为评分，task为子任务序号，index为测试序号
+ * 返回值：包含返回1，否则返回0
+ */
+static int
+scr_contains(const struct scoring *sc, int task, int index)
+{
+	if (sc->count == 0)
+		return task == index;
+	return scr_range(sc->tasks[task].cases, index);
+}
+
+/*
+ * 局部函数：scr_passed
+ * 功能：判断子任务是否还没有错误的测试
+ * 参数：sc为评分，task为子任务序号
+ * 返回值：包含的测试都正确或者没有运行返回1，否则返回0
+ * 注意：评测结束时SCR_ALL运行了全部测试，SCR_SKIP没有运行的测试
+ *   只属于已经失败的子任务，所以此时的返回值就是子任务是否得分
+ */
+static int
+scr_passed(const struct scoring *sc, int task)
+{
+	int i;
+
+	for (i = 0; i < sc->ncase; ++i)
+		if (scr_contains(sc, task, i) && sc->cases[i].code != -1 &&
+				sc->cases[i].code != EXIT_AC)
+			return 0;
+	return 1;
+}
@@ -0,0 +1,78 @@
+/***************************************************************
+ * 文件名：score.h
+ * 模块功能：OI赛制的部分分，运行全部测试，按data.conf中的子任务
+ *   计算得分，子任务的测试全部正确才得到该子任务的分值
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include "data.h"
+#include "exit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef SCORE_H
+#define SCORE_H
+
+/*
+ * 子任务的最大个数，没有子任务时每组测试各为一个子任务
+ */
+#define SCR_MAX 64
+
+/*
+ * 没有子任务时所有测试的总分，平均分配给每组测试
+ */
+#define SCR_TOTAL 100
+
+/*
+ * 评分方式
+ */
+enum scoremode
+{
+	SCR_OFF,				/* 不评分，首个错误即为结果 */
+	SCR_ALL,				/* 运行全部测试 */
+	SCR_SKIP				/* 包含某组测试的子任务都已失败时跳过该组 */
+};
+
+/*
+ * 一个子任务，来自选项行"@subtask <分值> <测试范围>"
+ */
+struct subtask
+{
+	int weight;				/* 分值 */
+	const char *cases;		/* 测试范围，格式同--cases，指向数据集 */
+};
+
+/*
+ * 一组测试的结果
+ */
+struct scorecase
+{
+	int code;				/* 状态，-1为没有运行 */
+	int time;				/* 时间，单位毫秒 */
+	int memory;				/* 内存，单位kb */
+};
+
+/*
+ * 一次评测的评分
+ */
+struct scoring
+{
+	enum scoremode mode;
+	int count;				/* 子任务个数，0为每组测试各为一个子任务 */
+	struct subtask tasks[SCR_MAX];
+	int ncase;				/* 测试组数 */
+	struct scorecase *cases;	/* 每组测试的结果 */
+};
+
+int scr_range(const char *list, int index);
+int scr_init(struct scoring *sc, enum scoremode mode,
+		const struct dataset *ds, char *errmsg);
+int scr_needed(const struct scoring *sc, int index);
+void scr_record(struct scoring *sc, int index, int code, int time,
+		int memory);
+void scr_report(const struct scoring *sc, struct result *res);
+void scr_free(struct scoring *sc);
+
+#endif
@@ -0,0 +1,502 @@
+/*************************************************
+ * 源文件：source.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "source.h"
+
+/*
+ * 内存文件和文件封印的常量，旧的C库头文件中可能没有定义
+ */
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#define F_SEAL_WRITE 0x0008
+#endif
+
+/*
+ * 压缩格式，按文件名后缀识别，解压程序都支持"-dcq"参数
+ */
+struct srcformat
+{
+	const char *suffix;
+	const char *prog;
+};
+
+static const struct srcformat src_formats[] = {
+	{ ".zst", "zstd" },
+	{ ".lz4", "lz4" },
+	{ ".gz", "gzip" },
+	{ ".xz", "xz" },
+	{ NULL, NULL }
+};
+
+/*
+ * 等待生成程序结束时的轮询间隔，单位毫秒
+ */
+#define SRC_POLL_SLICE 10
+
+/*
+ * 局部数据：src_gencache和src_gentime
+ * 作用：生成数据的缓存目录（NULL为不缓存）和生成程序、解压程序的墙上时间限制
+ * 被使用：src_config设置，src_generate和src_unpack使用
+ */
+static const char *src_gencache;
+static int src_gentime = SRC_GEN_TIME;
+
+/*
+ * 局部函数声明
+ */
+static const struct srcformat * src_format(const char *path);
+static int src_memfd(const char *func, char *errmsg);
+static int src_seal(int memfd, const char *func, char *errmsg);
+static void src_child(int infd, int outfd);
+static int src_unpack(const char *path, const struct srcformat *fmt,
+		char *errmsg);
+static int src_generate(const char *entry, char *errmsg);
+static int src_wait(pid_t pid, int timeout, int *status);
+static void src_save(int memfd, const char *path);
+
+/*
+ * 接口函数：src_config
+ * 功能：设置生成程序的缓存目录和时间限制
+ * 参数：gencache为缓存目录，NULL为不缓存，gentime为墙上时间限制，
+ *   单位毫秒，不大于0则使用SRC_GEN_TIME
+ * 返回值：无
+ */
+void
+src_config(const char *gencache, int gentime)
+{
+	src_gencache = gencache;
+	src_gentime = gentime > 0 ? gentime : SRC_GEN_TIME;
+}
+
+/*
+ * 接口函数：src_packed
+ * 功能：判断数据文件是否为压缩文件
+ * 参数：path为文件路径
+ * 返回值：压缩文件返回1，否则返回0
+ */
+int
+src_packed(const char *path)
+{
+	return src_format(path) != NULL;
+}
+
+/*
+ * 接口函数：src_generated
+ * 功能：判断数据行是否为生成程序
+ * 参数：entry为数据行，格式为"!程序 参数..."
+ * 返回值：是返回1，否则返回0
+ */
+int
+src_generated(const char *entry)
+{
+	return entry[0] == '!';
+}
+
+/*
+ * 接口函数：src_digest
+ * 功能：计算生成数据的摘要
+ * 参数：entry为生成程序的数据行，hash接收HASH_LEN个字节，
+ *   errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：摘要由生成程序文件的内容和参数字符串决定，
+ *   同样的程序和参数总是生成同样的数据
+ */
+int
+src_digest(const char *entry, unsigned char *hash, char *errmsg)
+{
+	char prog[PATH_MAX];
+	unsigned char proghash[HASH_LEN];
+	const char *args;
+	struct hashctx ctx;
+	size_t len;
+
+	++entry;
+	len = strcspn(entry, " \t");
+	if (len == 0 || len >= PATH_MAX) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**src_digest** bad generator: %s", entry);
+		return -1;
+	}
+	memcpy(prog, entry, len);
+	prog[len] = '\0';
+	args = entry + len + strspn(entry + len, " \t");
+
+	if (hash_file(prog, proghash, errmsg) != 0)
+		return -1;
+
+	hash_init(&ctx);
+	hash_update(&ctx, proghash, HASH_LEN);
+	hash_update(&ctx, args, strlen(args) + 1);
+	hash_final(&ctx, hash);
+	return 0;
+}
+
+/*
+ * 接口函数：src_open
+ * 功能：打开数据文件，压缩文件则先解压，生成程序则先运行
+ * 参数：path为文件路径或者生成程序的数据行，errmsg接收错误信息
+ * 返回值：成功返回描述符，文件偏移为0，出错返回-1
+ * 注意：压缩文件解压到内存文件（memfd）中，不在磁盘上留下临时文件；
+ *   内存文件解压后被封印，用户程序不能通过标准输入修改数据；
+ *   描述符带有FD_CLOEXEC
+ */
+int
+src_open(const char *path, char *errmsg)
+{
+	int fd;
+	const struct srcformat *fmt;
+
+	if (src_generated(path))
+		return src_generate(path, errmsg);
+	if ((fmt = src_format(path)) != NULL)
+		return src_unpack(path, fmt, errmsg);
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**src_open** open %s error: %s",
+				path, strerror(errno));
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * 局部函数：src_format
+ * 功能：按文件名后缀查找压缩格式
+ * 参数：path为文件路径
+ * 返回值：找到返回压缩格式，否则返回空指针
+ */
+static const struct srcformat *
+src_format(const char *path)
+{
+	const struct srcformat *fmt;
+	size_t len = strlen(path), n;
+
+	for (fmt = src_formats; fmt->suffix != NULL; ++fmt) {
+		n = strlen(fmt->suffix);
+		if (len > n && strcmp(path + len - n, fmt->suffix) == 0)
+			return fmt;
+	}
+	return NULL;
+}
+
+/*
+ * 局部函数：src_memfd
+ * 功能：创建可以封印的内存文件
+ * 参数：func为调用者的函数名，用于错误信息，errmsg接收错误信息
+ * 返回值：成功返回描述符，出错返回-1
+ */
+static int
+src_memfd(const char *func, char *errmsg)
+{
+	int memfd;
+
+	memfd = syscall(SYS_memfd_create, "moj-source",
+			MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (memfd == -1)
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**%s** memfd_create error: %s", func, strerror(errno));
+	return memfd;
+}
+
+/*
+ * 局部函数：src_seal
+ * 功能：封印内存文件并把偏移移到开头
+ * 参数：memfd为内存文件，func为调用者的函数名，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ */
+static int
+src_seal(int memfd, const char *func, char *errmsg)
+{
+	/* 封印之后任何描述符都不能再修改内容 */
+	if (fcntl(memfd, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_GROW |
+				F_SEAL_SHRINK | F_SEAL_SEAL) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**%s** seal error: %s", func, strerror(errno));
+		return -1;
+	}
+
+	lseek(memfd, 0, SEEK_SET);
+	return 0;
+}
+
+/*
+ * 局部函数：src_child
+ * 功能：在子进程中放弃超级权限并重定向标准输入输出
+ * 参数：infd为标准输入，outfd为标准输出
+ * 返回值：无，出错时子进程退出
+ * 注意：标准错误输出重定向到/dev/null
+ */
+static void
+src_child(int infd, int outfd)
+{
+	int nullfd;
+	uid_t uid;
+
+	/* 先换回超级用户，再把三个用户ID都设置为评测程序的用户 */
+	uid = geteuid();
+	if (setreuid(geteuid(), getuid()) == -1 || setuid(uid) == -1)
+		_exit(1);
+
+	if (dup2(infd, STDIN_FILENO) == -1 ||
+			dup2(outfd, STDOUT_FILENO) == -1)
+		_exit(1);
+	if ((nullfd = open("/dev/null", O_WRONLY)) != -1)
+		dup2(nullfd, STDERR_FILENO);
+}
+
+/*
+ * 局部函数：src_unpack
+ * 功能：调用解压程序把压缩文件解压到内存文件
+ * 参数：path为文件路径，fmt为压缩格式，errmsg接收错误信息
+ * 返回值：成功返回内存文件的描述符，出错返回-1
+ * 注意：解压程序以评测程序的用户身份在独立的进程组中运行，没有超级权限；
+ *   与生成程序一样受src_gentime和SRC_GEN_FSIZE限制，
+ *   卡住的解压程序和解压炸弹都不会拖住评测
+ */
+static int
+src_unpack(const char *path, const struct srcformat *fmt, char *errmsg)
+{
+	int memfd, infd, status;
+	struct rlimit rl;
+	pid_t pid;
+
+	if ((memfd = src_memfd("src_unpack", errmsg)) == -1)
+		return -1;
+
+	if ((infd = open(path, O_RDONLY)) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**src_unpack** open %s error: %s",
+				path, strerror(errno));
+		close(memfd);
+		return -1;
+	}
+
+	if ((pid = fork()) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**src_unpack** fork error: %s", strerror(errno));
+		close(infd);
+		close(memfd);
+		return -1;
+
+	} else if (pid == 0) {
+		setpgid(0, 0);
+		src_child(infd, memfd);
+
+		rl.rlim_cur = rl.rlim_max = SRC_GEN_FSIZE;
+		setrlimit(RLIMIT_FSIZE, &rl);
+
+		execlp(fmt->prog, fmt->prog, "-dcq", (char *)0);
+		_exit(1);
+	}
+
+	close(infd);
+	if (src_wait(pid, src_gentime, &status) != 0) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**src_unpack** %s -dcq %s: timeout after %d ms",
+				fmt->prog, path, src_gentime);
+		close(memfd);
+		return -1;
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**src_unpack** %s -dcq %s failed.", fmt->prog, path);
+		close(memfd);
+		return -1;
+	}
+
+	if (src_seal(memfd, "src_unpack", errmsg) != 0) {
+		close(memfd);
+		return -1;
+	}
+	return memfd;
+}
+
+/*
+ * 局部函数：src_generate
+ * 功能：运行生成程序，把它的标准输出作为数据
+ * 参数：entry为生成程序的数据行，errmsg接收错误信息
+ * 返回值：成功返回描述符，出错返回-1
+ * 注意：生成程序以评测程序的用户身份在独立的进程组中运行，
+ *   标准输入为/dev/null，受src_gentime和SRC_GEN_FSIZE限制，
+ *   必须以0退出；设置了缓存目录时先查缓存，生成后写入缓存
+ */
+static int
+src_generate(const char *entry, char *errmsg)
+{
+	int memfd, nullfd, argc, status;
+	char line[PATH_MAX], path[PATH_MAX], hex[HASH_HEX];
+	char *argv[SRC_GEN_ARGS + 1], *tok;
+	unsigned char hash[HASH_LEN];
+	struct rlimit rl;
+	pid_t pid;
+
+	if (strlen(entry + 1) >= PATH_MAX) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**src_generate** %s too long.", entry);
+		return -1;
+	}
+	strcpy(line, entry + 1);
+
+	argc = 0;
+	for (tok = strtok(line, " \t"); tok != NULL; tok = strtok(NULL, " \t")) {
+		if (argc >= SRC_GEN_ARGS) {
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**src_generate** too many arguments: %s", entry);
+			return -1;
+		}
+		argv[argc++] = tok;
+	}
+	argv[argc] = NULL;
+	if (argc == 0) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**src_generate** bad generator: %s", entry);
+		return -1;
+	}
+
+	/* 缓存中的数据以生成程序和参数的摘要为文件名 */
+	path[0] = '\0';
+	if (src_gencache != NULL) {
+		if (src_digest(entry, hash, errmsg) != 0)
+			return -1;
+		hash_hex(hash, hex);
+		snprintf(path, PATH_MAX, "%s/%.2s/%s", src_gencache, hex, hex);
+		if ((memfd = open(path, O_RDONLY | O_CLOEXEC)) != -1)
+			return memfd;
+	}
+
+	if ((memfd = src_memfd("src_generate", errmsg)) == -1)
+		return -1;
+
+	if ((nullfd = open("/dev/null", O_RDONLY)) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**src_generate** open /dev/null error: %s", strerror(errno));
+		close(memfd);
+		return -1;
+	}
+
+	if ((pid = fork()) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**src_generate** fork error: %s", strerror(errno));
+		close(nullfd);
+		close(memfd);
+		return -1;
+
+	} else if (pid == 0) {
+		/* 超时的时候连同生成程序创建的子进程一起杀死 */
+		setpgid(0, 0);
+		src_child(nullfd, memfd);
+
+		rl.rlim_cur = rl.rlim_max = src_gentime / 1000 + 1;
+		setrlimit(RLIMIT_CPU, &rl);
+		rl.rlim_cur = rl.rlim_max = SRC_GEN_FSIZE;
+		setrlimit(RLIMIT_FSIZE, &rl);
+
+		execv(argv[0], argv);
+		_exit(1);
+	}
+
+	close(nullfd);
+	if (src_wait(pid, src_gentime, &status) != 0) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**src_generate** %s: timeout after %d ms",
+				argv[0], src_gentime);
+		close(memfd);
+		return -1;
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**src_generate** %s failed.", entry + 1);
+		close(memfd);
+		return -1;
+	}
+
+	if (src_seal(memfd, "src_generate", errmsg) != 0) {
+		close(memfd);
+		return -1;
+	}
+
+	if (path[0] != '\0')
+		src_save(memfd, path);
+	return memfd;
+}
+
+/*
+ * 局部函数：src_wait
+ * 功能：在时间限制内等待子进程结束
+ * 参数：pid为子进程，timeout为墙上时间限制，单位毫秒，
+ *   status接收退出状态
+ * 返回值：按时结束返回0，超时返回-1，超时的时候杀死整个进程组
+ */
+static int
+src_wait(pid_t pid, int timeout, int *status)
+{
+	struct timespec now, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += timeout / 1000;
+	end.tv_nsec += (timeout % 1000) * 1000000L;
+	if (end.tv_nsec >= 1000000000L) {
+		++end.tv_sec;
+		end.tv_nsec -= 1000000000L;
+	}
+
+	while (waitpid(pid, status, WNOHANG) == 0) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (now.tv_sec > end.tv_sec ||
+				(now.tv_sec == end.tv_sec && now.tv_nsec >= end.tv_nsec)) {
+			kill(-pid, SIGKILL);
+			kill(pid, SIGKILL);
+			waitpid(pid, status, 0);
+			return -1;
+		}
+		poll(NULL, 0, SRC_POLL_SLICE);
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：src_save
+ * 功能：把生成的数据写入缓存
+ * 参数：memfd为封印后的内存文件，path为缓存中的路径
+ * 返回值：无
+ * 注意：先写临时文件再改名，并发的评测不会读到写了一半的数据；
+ *   缓存只是加速，写入失败不影响评测
+ */
+static void
+src_save(int memfd, const char *path)
+{
+	char dir[PATH_MAX], tmp[PATH_MAX], buf[65536];
+	int fd;
+	ssize_t n;
+	off_t off = 0;
+
+	snprintf(dir, PATH_MAX, "%s", path);
+	*strrchr(dir, '/') = '\0';
+	if (mkdir(dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) == -1 &&
+			errno != EEXIST)
+		return;
+
+	snprintf(tmp, PATH_MAX, "%s/.tmpXXXXXX", dir);
+	if ((fd = mkstemp(tmp)) == -1)
+		return;
+	fchmod(fd, S_IRUSR | S_IRGRP | S_IROTH);
+
+	while ((n = pread(memfd, buf, sizeof(buf), off)) > 0) {
+		if (write(fd, buf, n) != n) {
+			n = -1;
+			break;
+		}
+		off += n;
+	}
+
+	if (close(fd) == -1 || n == -1 || rename(tmp, path) == -1)
+		unlink(tmp);
+}
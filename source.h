@@ -0,0 +1,53 @@
+/***************************************************************
+ * 文件名：source.h
+ * 模块功能：打开测试数据文件，压缩的文件解压到内存文件中，
+ *   以'!'开头的数据行是生成程序，运行生成程序得到数据，
+ *   调用者总是得到一个可以读取、定位和内存映射的描述符
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <time.h>
+#include "hash.h"
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+/*
+ * 以描述符代替路径时使用的路径格式
+ */
+#define SRC_FD_PATH "/proc/self/fd/%d"
+
+/*
+ * 生成程序和解压程序的默认限制：墙上时间（毫秒）和输出大小（字节）
+ */
+#define SRC_GEN_TIME 10000
+#define SRC_GEN_FSIZE (1L << 30)
+
+/*
+ * 生成程序的参数个数上限，包括程序本身
+ */
+#define SRC_GEN_ARGS 64
+
+void src_config(const char *gencache, int gentime);
+int src_packed(const char *path);
+int src_generated(const char *entry);
+int src_digest(const char *entry, unsigned char *hash, char *errmsg);
+int src_open(const char *path, char *errmsg);
+
+#endif
@@ -0,0 +1,185 @@
+/*************************************************
+ * 源文件：store.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "store.h"
+
+/*
+ * 局部函数声明
+ */
+static int store_copy(const char *from, char *to, char *errmsg);
+
+/*
+ * 仓库中数据的布局为"<仓库>/<摘要前两位>/<摘要><后缀>"，
+ * 摘要是文件原样内容（压缩文件为压缩后的内容）的SHA-256，
+ * 数据写入后不再改变，按文件名就可以知道内容的摘要
+ */
+
+/*
+ * 接口函数：store_is_ref
+ * 功能：判断data.conf中的数据行是否是仓库引用
+ * 参数：entry为数据行
+ * 返回值：是返回1，否则返回0
+ */
+int
+store_is_ref(const char *entry)
+{
+	return strncmp(entry, STORE_PREFIX, strlen(STORE_PREFIX)) == 0;
+}
+
+/*
+ * 接口函数：store_path
+ * 功能：把仓库引用转换为仓库中的文件路径
+ * 参数：store为仓库目录，ref为引用，path接收路径（PATH_MAX），
+ *   errmsg接收错误信息
+ * 返回值：成功返回0，引用格式错误返回-1
+ * 注意：只检查格式，不检查文件是否存在
+ */
+int
+store_path(const char *store, const char *ref, char *path, char *errmsg)
+{
+	unsigned char hash[HASH_LEN];
+	const char *hex = ref + strlen(STORE_PREFIX);
+	const char *suffix = hex + HASH_LEN * 2;
+
+	/* 后缀只能是压缩格式的后缀，不能跳出仓库目录 */
+	if (!store_is_ref(ref) || strlen(hex) < HASH_LEN * 2 ||
+			hash_unhex(hex, hash) != 0 ||
+			(*suffix != '\0' && (*suffix != '.' || strchr(suffix, '/') ||
+								 !src_packed(ref)))) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**store_path** bad reference: %s", ref);
+		return -1;
+	}
+
+	if (snprintf(path, PATH_MAX, "%s/%.2s/%s", store, hex, hex)
+			>= PATH_MAX) {
+		snprintf(errmsg, ERR_MSG_MAX, "**store_path** %s too long.", store);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 接口函数：store_digest
+ * 功能：从仓库中数据的路径得到内容摘要，不读取文件
+ * 参数：path为文件路径，hash接收摘要（HASH_LEN字节）
+ * 返回值：是仓库中的数据返回0，否则返回-1
+ * 注意：按布局判断，要求文件名是摘要，且父目录是摘要的前两位
+ */
+int
+store_digest(const char *path, unsigned char *hash)
+{
+	const char *name, *dir;
+
+	if ((name = strrchr(path, '/')) == NULL || name - path < 3)
+		return -1;
+	dir = name - 2;
+	++name;
+
+	if (dir[-1] != '/' || strncmp(dir, name, 2) != 0)
+		return -1;
+	if (strlen(name) < HASH_LEN * 2 ||
+			(name[HASH_LEN * 2] != '\0' && name[HASH_LEN * 2] != '.'))
+		return -1;
+	return hash_unhex(name, hash);
+}
+
+/*
+ * 接口函数：store_put
+ * 功能：把文件存入仓库，已经存在则不再复制
+ * 参数：store为仓库目录，file为文件路径，hash为已经算好的摘要，
+ *   为NULL则读取文件计算，ref接收引用（STORE_REF_MAX），errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：压缩文件保留其后缀；先复制到唯一的临时文件再改名，
+ *   多个进程或线程并发存入同一个文件是安全的；仓库中的文件是只读的
+ */
+int
+store_put(const char *store, const char *file, const unsigned char *hash,
+		char *ref, char *errmsg)
+{
+	unsigned char fhash[HASH_LEN];
+	char hex[HASH_HEX];
+	char path[PATH_MAX], tmp[PATH_MAX];
+	const char *suffix = "";
+
+	if (hash == NULL) {
+		if (hash_file(file, fhash, errmsg) != 0)
+			return -1;
+		hash = fhash;
+	}
+	hash_hex(hash, hex);
+
+	if (src_packed(file))
+		suffix = strrchr(file, '.');
+	snprintf(ref, STORE_REF_MAX, "%s%s%s", STORE_PREFIX, hex, suffix);
+
+	snprintf(path, PATH_MAX, "%s/%.2s", store, hex);
+	if (mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) == -1 &&
+			errno != EEXIST) {
+		snprintf(errmsg, ERR_MSG_MAX, "**store_put** mkdir %s error: %s",
+				path, strerror(errno));
+		return -1;
+	}
+
+	if (store_path(store, ref, path, errmsg) != 0)
+		return -1;
+	if (access(path, F_OK) == 0)
+		return 0;
+
+	snprintf(tmp, PATH_MAX, "%s.XXXXXX", path);
+	if (store_copy(file, tmp, errmsg) != 0)
+		return -1;
+	if (rename(tmp, path) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**store_put** rename %s error: %s",
+				tmp, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 局部函数：store_copy
+ * 功能：复制文件到新建的临时文件，目标文件是只读的
+ * 参数：from为源路径，to为mkstemp的模板，接收实际路径，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1，出错时删除目标文件
+ */
+static int
+store_copy(const char *from, char *to, char *errmsg)
+{
+	int in, out, n;
+	char buf[65536];
+
+	if ((in = open(from, O_RDONLY)) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**store_copy** open %s error: %s",
+				from, strerror(errno));
+		return -1;
+	}
+	if ((out = mkstemp(to)) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**store_copy** mkstemp %s error: %s",
+				to, strerror(errno));
+		close(in);
+		return -1;
+	}
+	fchmod(out, S_IRUSR | S_IRGRP | S_IROTH);
+
+	while ((n = read(in, buf, sizeof(buf))) > 0) {
+		if (write(out, buf, n) != n) {
+			n = -1;
+			break;
+		}
+	}
+
+	close(in);
+	if (close(out) == -1)
+		n = -1;
+	if (n == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**store_copy** copy %s error: %s",
+				from, strerror(errno));
+		unlink(to);
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,40 @@
+/***************************************************************
+ * 文件名：store.h
+ * 模块功能：按内容摘要存放测试数据的仓库，相同的输入和答案只存一份，
+ *   data.conf中以"sha256:<摘要>"引用仓库中的数据
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include "hash.h"
+#include "source.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef STORE_H
+#define STORE_H
+
+/*
+ * 引用的前缀，后接64位小写十六进制摘要，可以再跟压缩格式的后缀
+ */
+#define STORE_PREFIX "sha256:"
+
+/*
+ * 引用字符串的最大长度（含结束符）
+ */
+#define STORE_REF_MAX 96
+
+int store_is_ref(const char *entry);
+int store_path(const char *store, const char *ref, char *path,
+		char *errmsg);
+int store_digest(const char *path, unsigned char *hash);
+int store_put(const char *store, const char *file,
+		const unsigned char *hash, char *ref, char *errmsg);
+
+#endif
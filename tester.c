@@ -1,39 +1,87 @@
 /*************************************************
  * 源文件：tester.c
  * 版本：v0.1.0
- * 最后修改：2012-08-15
+ * 最后修改：2026-10-18
  ************************************************/
 #include "tester.h"
 
 /*
  * 局部函数声明
  */
-static void tester_exit(struct caseout *csout);
+static int tester_run_case(struct casein *csin, const char *infile,
+		const char *ansfile, const char *outfile, struct caseout *csout);
+static void tester_finish(struct dataset *ds, struct progress *prg,
+		struct caseout *csout, struct result *res);
 static void tester_test_print(struct casein *csin,
 		struct caseout *csout);
 
 /*
  * 接口函数：tester_start
  * 功能：调用case_run_test进行每组测试，并检测每组的测试结果
- * 参数：cond见tester.h头文件定义
+ * 参数：cond见tester.h头文件定义，res接收评测结果
  * 返回值：无
+ * 注意：res由调用者用exit_init初始化，其中可以已经有编译的附加行；
+ *   出错时也释放全部资源后返回，不退出程序，可以在一个进程中多次调用
  */
 void
-tester_start(struct condition *cond)
+tester_start(struct condition *cond, struct result *res)
 {
-	int i, cnt;
-	int infd, outfd;		/* 用户程序的输入和输出文件描述符 */
+	int i, k, cnt;
+	int fail = -1;			/* data.conf顺序中首个错误测试的序号 */
+	int outfd = -1;			/* 用户程序的输出文件描述符 */
+	int odok = 0;			/* 是否读取了历史统计 */
+	int keyok;				/* 是否得到了该组测试的缓存键 */
+	int hits = 0;			/* 命中缓存的测试组数 */
 	int maxtime = 0;		/* 所有组测试结果中最大的时间 */
+	int maxraw = 0;			/* 最大时间那组测试扣除开销之前的时间 */
 	int maxmemory = 0;		/* 所有则测试结果中最大内存 */
 	const char *infile;		/* 用户测试输入文件 */
 	const char *ansfile;	/* 用户测试的答案文件或答案程序 */
+	struct dataset *ds = NULL;	/* 数据目录的数据集 */
+	struct progress prg;	/* 进度事件，需要cond->progress */
+	struct scoring sc;		/* 部分分，需要cond->score */
 	char outfile[PATH_MAX]; /* 用户程序的临时输出文件 */
 	struct casein csin;		/* 单组测试函数中的参数 */
 	struct caseout csout;	/* 单组测试函数中的返回结果 */
+	struct caseout failout;	/* 首个错误测试的结果 */
+	struct memtrace peak;	/* 内存最大的那组测试的内存序列 */
+	struct cache cc;		/* 结果缓存，需要cond->cache */
+	unsigned char key[HASH_LEN];
+	struct order od;		/* 历史统计和运行顺序，需要cond->stats */
+	char errbuf[ERR_MSG_MAX];
+	const char *cmpspec;	/* 比较方式的描述 */
+	struct cmpmode cmpmode;	/* 静态答案的比较方式 */
+	const char *chkopt;		/* data.conf中常驻检查程序的选项 */
+	char chkpath[PATH_MAX];	/* 常驻检查程序的路径 */
+	char itpath[PATH_MAX];	/* 交互程序的路径 */
+	struct checker chk;		/* 常驻检查程序，需要@checker选项 */
+	struct zygote zg;		/* 预先初始化的解释器，需要cond->zygote */
+	struct cgroup cg;		/* 每组测试的叶子组，需要cond->cgroup */
+	struct childin zgin;	/* 运行zygote的条件 */
+	struct timespec begin, end;	/* 评测的起止时间，作为题目的评测耗时 */
 
-	if (dd_init(cond->datadir, csout.msg) != 0) {
+	/* moj_judge从编译之前开始计时，直接调用时从这里开始 */
+	if (cond->begin.tv_sec != 0 || cond->begin.tv_nsec != 0)
+		begin = cond->begin;
+	else
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+	csout.trace.count = 0;
+	peak.count = 0;
+	csin.checker = NULL;
+	csin.zygote = NULL;
+	sc.cases = NULL;
+
+	if (prg_init(&prg, cond->progress, csout.msg) != 0) {
+		csout.code = EXIT_EE;
+		goto errexit;
+	}
+
+	/* 调用者已经打开了数据集则共享，否则打开数据目录 */
+	if (cond->dataset != NULL)
+		ds = dd_retain(cond->dataset);
+	else if ((ds = dd_open(cond->datadir, cond->store, csout.msg)) == NULL) {
 		csout.code = EXIT_EE;
-		tester_exit(&csout);
+		goto errexit;
 	}
 
 	/* 填充csin结构体 */
@@ -43,6 +91,80 @@ tester_start(struct condition *cond)
 	csin.fsize = cond->fsize;
 	csin.basedir = cond->basedir;
 	csin.who = cond->who;
+	csin.memtrace = cond->memtrace;
+
+	/* 比较方式：命令行优先，其次是data.conf中的@compare选项 */
+	csin.compare = NULL;
+	cmpspec = cond->compare != NULL ? cond->compare : dd_get_option(ds, "compare");
+	if (cmpspec != NULL) {
+		if (cmp_parse(cmpspec, &cmpmode, csout.msg) != 0) {
+			csout.code = EXIT_EE;
+			goto errexit;
+		}
+		csin.compare = &cmpmode;
+	}
+
+	/* 答案程序和常驻检查程序的时间限制：命令行优先，其次是@checker-time */
+	csin.chktime = cond->chktime;
+	if (csin.chktime == 0 && (chkopt = dd_get_option(ds, "checker-time")) != NULL)
+		csin.chktime = atoi(chkopt);
+
+	/* 有校准文件则按系统调用停止的次数扣除跟踪开销 */
+	csin.overhead = 0;
+	if (cond->calibration != NULL &&
+			calib_load(cond->calibration, &csin.overhead, csout.msg) != 0) {
+		csout.code = EXIT_EE;
+		goto errexit;
+	}
+
+	/* 有根文件系统则每组测试在新的命名空间沙箱中运行 */
+	csin.cpu = cond->cpu;
+	csin.rootfs = cond->rootfs;
+	if (cond->rootfs != NULL && sbx_check(cond->rootfs, csout.msg) != 0) {
+		csout.code = EXIT_EE;
+		goto errexit;
+	}
+
+	/* 有父组则每组测试在新建的cgroup叶子组中运行 */
+	csin.cgroup = NULL;
+	if (cond->cgroup != NULL) {
+		if (cg_init(&cg, cond->cgroup, cond->basedir, csout.msg) != 0) {
+			csout.code = EXIT_EE;
+			goto errexit;
+		}
+		csin.cgroup = &cg;
+	}
+
+	/* 生成程序的缓存目录来自命令行，时间限制来自@gen-time选项 */
+	chkopt = dd_get_option(ds, "gen-time");
+	src_config(cond->gencache, chkopt != NULL ? atoi(chkopt) : 0);
+
+	/* data.conf中有@interactor选项则为交互题，相对路径相对于数据目录 */
+	csin.interactor = NULL;
+	if ((chkopt = dd_get_option(ds, "interactor")) != NULL) {
+		if (chkopt[0] == '/')
+			snprintf(itpath, PATH_MAX, "%s", chkopt);
+		else
+			snprintf(itpath, PATH_MAX, "%s/%s", cond->datadir, chkopt);
+		csin.interactor = itpath;
+	}
+
+	/*
+	 * data.conf中有@checker选项，则启动常驻检查程序，相对路径相对于数据目录；
+	 * 交互题由交互程序判定，不需要检查程序
+	 */
+	if (csin.interactor == NULL &&
+			(chkopt = dd_get_option(ds, "checker")) != NULL) {
+		if (chkopt[0] == '/')
+			snprintf(chkpath, PATH_MAX, "%s", chkopt);
+		else
+			snprintf(chkpath, PATH_MAX, "%s/%s", cond->datadir, chkopt);
+		if (chk_start(&chk, chkpath, csin.chktime, csout.msg) != 0) {
+			csout.code = EXIT_IE;
+			goto errexit;
+		}
+		csin.checker = &chk;
+	}
 
 	/* 创建临时输出文件，权限由屏蔽字限制 */
 	if (cond->basedir[strlen(cond->basedir) - 1] != '/')
@@ -55,108 +177,292 @@ tester_start(struct condition *cond)
 		csout.code = EXIT_IE;
 		snprintf(csout.msg, ERR_MSG_MAX, "**tester_start** open %s error: %s",
 				outfile, strerror(errno));
-		tester_exit(&csout);
+		goto errexit;
 	}
 	unlink(outfile);
 
-	/* 准备调用case_run_test */
-	cnt = dd_get_count();
-	for (i = 0; i < cnt; ++i) {
-		infile = dd_get_input(i);
-		ansfile = dd_get_answer(i);
-
-		/* 文件指针置0，截断长度为0 */
-		if (lseek(outfd, 0, SEEK_SET) != 0) {
-			close(outfd);
+	/* 按需要读取历史统计，自适应模式下重新安排运行顺序 */
+	cnt = dd_get_count(ds);
+	if (cond->stats != NULL) {
+		if (order_load(&od, cond->stats, cond->datadir,
+					cnt, csout.msg) != 0) {
 			csout.code = EXIT_IE;
-			snprintf(csout.msg, ERR_MSG_MAX,
-					"**tester_start** lseek %s error: %s",
-					outfile, strerror(errno));
-			tester_exit(&csout);
+			goto errexit;
 		}
-		if (ftruncate(outfd, 0) == -1) {
-			close(outfd);
+		odok = 1;
+		if (cond->adaptive)
+			order_sort(&od);
+	}
+
+	/* 评分时读取子任务 */
+	if (cond->score != SCR_OFF &&
+			scr_init(&sc, cond->score, ds, csout.msg) != 0) {
+		csout.code = EXIT_EE;
+		goto errexit;
+	}
+
+	/* zygote模式下先启动解释器，所有测试共用，启动时间不计入用户程序 */
+	if (cond->zygote) {
+		if ((zgin.infd = open("/dev/null", O_RDWR)) == -1) {
 			csout.code = EXIT_IE;
 			snprintf(csout.msg, ERR_MSG_MAX,
-					"**tester_start** truncate %s error: %s",
-					outfile, strerror(errno));
-			tester_exit(&csout);
+					"**tester_start** open /dev/null error: %s",
+					strerror(errno));
+			goto errexit;
 		}
-
-		/* 打开用户程序的输入文件 */
-		infd = open(infile, O_RDONLY);
-		if (infd == -1) {
-			close(outfd);
+		zgin.outfd = dup(zgin.infd);
+		zgin.time = csin.overhead > 0 ? cond->time * CALIB_SLACK : cond->time;
+		zgin.fsize = cond->fsize;
+		zgin.basedir = cond->basedir;
+		zgin.command = cond->command;
+		zgin.who = cond->who;
+		zgin.rootfs = cond->rootfs;
+		zgin.cpu = cond->cpu;
+		if (zyg_start(&zg, &zgin, csout.msg) != 0) {
+			close(zgin.infd);
+			close(zgin.outfd);
 			csout.code = EXIT_IE;
+			goto errexit;
+		}
+		close(zgin.infd);
+		close(zgin.outfd);
+		exit_extra(res, "zygote %dms", zg.startup);
+		csin.zygote = &zg;
+	}
+
+	/* 按需要初始化结果缓存，缓存键取决于上面是否启动了zygote */
+	if (cond->cache != NULL && cache_init(&cc, cond->cache,
+				cond->cache_policy, &csin, csout.msg) != 0) {
+		csout.code = EXIT_EE;
+		goto errexit;
+	}
+
+	/* 准备调用case_run_test */
+	csin.outfd = outfd;
+	prg_event(&prg, "cases %d", cnt);
+	for (k = 0; k < cnt; ++k) {
+		i = cond->stats != NULL ? od.seq[k] : k;
+
+		/* 排在已知首个错误之后的测试不会影响结果，评分时由子任务决定 */
+		if (cond->score == SCR_OFF && fail != -1 && i > fail)
+			continue;
+		if (cond->score != SCR_OFF && !scr_needed(&sc, i))
+			continue;
+		if (cond->cases != NULL && !scr_range(cond->cases, i))
+			continue;
+
+		/* 调用者要求取消则不再运行后面的测试 */
+		if (prg_cancelled(&prg)) {
+			csout.code = EXIT_EE;
 			snprintf(csout.msg, ERR_MSG_MAX,
-					"**tester_start** open %s error: %s",
-					infile, strerror(errno));
-			tester_exit(&csout);
+					"**tester_start** cancelled by caller.");
+			goto errexit;
 		}
+		prg_event(&prg, "start %d", i + 1);
 
-		/* 填充csin结构体的剩余字段，调用case_run_test */
-		csin.infd = infd;
-		csin.outfd = outfd;
-		csin.ansfile = ansfile;
+		infile = dd_get_input(ds, i);
+		ansfile = dd_get_answer(ds, i);
+		csin.index = i;
 
-		case_run_test(&csin, &csout);
-		/* tester_test_print(&csin, &csout); */
+		/* 命中缓存则不再运行用户程序，计算缓存键出错则只是不使用缓存 */
+		keyok = cond->cache != NULL &&
+			cache_key(&cc, ds, infile, ansfile, key, csout.msg) == 0;
+		if (keyok && cache_lookup(&cc, key, &csout) == 1) {
+			++hits;
+			prg_event(&prg, "done %d %d %dms %dkb cache", i + 1,
+					csout.code, csout.time, csout.memory);
+		} else {
+			if (tester_run_case(&csin, infile, ansfile, outfile, &csout) != 0)
+				goto errexit;
+			if (keyok)
+				cache_store(&cc, key, &csout);
+			prg_event(&prg, "done %d %d %dms %dkb", i + 1,
+					csout.code, csout.time, csout.memory);
+		}
 
 		/*
-		 * 关闭单组数据输入文件，
-		 * 如果结果不正确，则关闭临时文件并退出
-		 * 结果正确，则记录最大时间和内存使用
+		 * 结果正确，则记录最大时间和内存使用；
+		 * 结果不正确，则记录data.conf顺序中最靠前的错误，
+		 * 还要运行排在它前面而没有运行的测试，才能确定最终结果
 		 */
-		close(infd);
 		if (csout.code == EXIT_AC) {
-			maxtime = csout.time > maxtime ? csout.time : maxtime;
-			maxmemory = csout.memory > maxmemory ?
-				csout.memory : maxmemory;
-		} else {
-			close(outfd);
-			tester_exit(&csout);
+			if (csout.time >= maxtime) {
+				maxtime = csout.time;
+				maxraw = csout.rawtime;
+			}
+			if (csout.memory >= maxmemory) {
+				maxmemory = csout.memory;
+				peak = csout.trace;
+			}
+			if (cond->stats != NULL)
+				order_record(&od, i, csout.time);
+		} else if (fail == -1 || i < fail) {
+			fail = i;
+			failout = csout;
 		}
+		if (cond->score != SCR_OFF)
+			scr_record(&sc, i, csout.code, csout.time, csout.memory);
+	}
+	close(outfd);
+	outfd = -1;
+	if (csin.checker != NULL)
+		chk_stop(csin.checker);
+	if (csin.zygote != NULL)
+		zyg_stop(csin.zygote);
+
+	/* 统计只用于安排顺序，保存失败不影响结果 */
+	if (cond->stats != NULL) {
+		/* 只运行部分测试时的耗时不代表整个题目 */
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		if (cond->cases == NULL)
+			order_cost(&od, (end.tv_sec - begin.tv_sec) * 1000 +
+					(end.tv_nsec - begin.tv_nsec) / 1000000);
+		order_save(&od, fail, errbuf);
+		order_free(&od);
+	}
+	if (cond->cache != NULL)
+		exit_extra(res, "cachehit %d", hits);
+
+	/* 评分时结果仍为首个错误，得分在附加行中 */
+	if (cond->score != SCR_OFF) {
+		scr_report(&sc, res);
+		scr_free(&sc);
+	}
+
+	/* 只运行部分测试时给出错误测试的序号，由调用者与其他部分合并 */
+	if (fail != -1) {
+		if (cond->cases != NULL)
+			exit_extra(res, "case %d", fail + 1);
+		tester_finish(ds, &prg, &failout, res);
+		return;
 	}
 
 	/* 所有的输入都测试正确 */
-	close(outfd);
+	csout.code = EXIT_AC;
 	csout.time = maxtime;
+	if (csin.overhead > 0)
+		exit_extra(res, "rawtime %d", maxraw);
 	csout.memory = maxmemory;
-	tester_exit(&csout);
+	csout.trace = peak;
+	tester_finish(ds, &prg, &csout, res);
+	return;
+
+errexit:
+	if (outfd != -1)
+		close(outfd);
+	if (csin.checker != NULL)
+		chk_stop(csin.checker);
+	if (csin.zygote != NULL)
+		zyg_stop(csin.zygote);
+	if (odok)
+		order_free(&od);
+	scr_free(&sc);
+	tester_finish(ds, &prg, &csout, res);
+}
+
+/*
+ * 局部函数：tester_run_case
+ * 功能：清空临时输出文件，打开输入文件，调用case_run_test进行一组测试
+ * 参数：csin中除了infd和ansfile的字段已经填充，infile和ansfile为该组的
+ *   输入和答案文件，outfile为临时输出文件名，csout接收测试结果
+ * 返回值：进行了测试返回0；准备输入输出出错返回-1，错误在csout中
+ */
+static int
+tester_run_case(struct casein *csin, const char *infile,
+		const char *ansfile, const char *outfile, struct caseout *csout)
+{
+	int infd;		/* 用户程序的输入文件描述符 */
+
+	/* 文件指针置0，截断长度为0 */
+	if (lseek(csin->outfd, 0, SEEK_SET) != 0) {
+		csout->code = EXIT_IE;
+		snprintf(csout->msg, ERR_MSG_MAX,
+				"**tester_run_case** lseek %s error: %s",
+				outfile, strerror(errno));
+		return -1;
+	}
+	if (ftruncate(csin->outfd, 0) == -1) {
+		csout->code = EXIT_IE;
+		snprintf(csout->msg, ERR_MSG_MAX,
+				"**tester_run_case** truncate %s error: %s",
+				outfile, strerror(errno));
+		return -1;
+	}
+
+	/* 打开用户程序的输入文件，压缩的输入先解压，生成的输入先运行生成程序 */
+	infd = src_open(infile, csout->msg);
+	if (infd == -1) {
+		csout->code = EXIT_IE;
+		return -1;
+	}
+
+	/* 填充csin结构体的剩余字段，调用case_run_test */
+	csin->infd = infd;
+	csin->infile = infile;
+	csin->ansfile = ansfile;
+
+	case_run_test(csin, csout);
+	/* tester_test_print(csin, csout); */
+
+	/* 关闭单组数据输入文件 */
+	close(infd);
+	return 0;
 }
 
 /*
- * 局部函数：tester_exit
- * 功能：根据测试结果，填写相应参数调用exit_func退出整个程序
- * 参数：csout见case.h头文件定义
+ * 局部函数：tester_finish
+ * 功能：把测试结果填入评测结果，输出结束事件，释放对数据集的引用
+ * 参数：ds为数据集，可以为空指针，prg为进度通道，
+ *   csout见case.h头文件定义，res接收评测结果
  * 返回值：无
  */
 static void
-tester_exit(struct caseout *csout)
+tester_finish(struct dataset *ds, struct progress *prg,
+		struct caseout *csout, struct result *res)
 {
-	/* 释放data模块的资源 */
-	dd_end();
+	char buf[4096];
+	char *p;
+
+	/* 释放对数据集的引用 */
+	dd_close(ds);
+
+	/* 结束事件只有状态，完整的结果仍然由调用者输出 */
+	prg_event(prg, "end %d", csout->code);
+	if (prg->dropped > 0)
+		exit_extra(res, "progress dropped %d", prg->dropped);
+
+	/* 有内存采样序列则作为附加行输出 */
+	if (csout->trace.count > 0) {
+		smp_format(&csout->trace, buf, sizeof(buf));
+		exit_extra(res, "%s", buf);
+	}
 
+	/* 检查程序给出的附加信息，换行替换为空格以保持一行 */
+	if ((csout->code == EXIT_PE || csout->code == EXIT_WA) &&
+			csout->msg[0] != '\0') {
+		for (p = csout->msg; *p != '\0'; ++p)
+			if (*p == '\n' || *p == '\r')
+				*p = ' ';
+		exit_extra(res, "checker %s", csout->msg);
+	}
+
+	res->code = csout->code;
+	res->time = 0;
+	res->memory = 0;
+	res->msg[0] = '\0';
 	switch (csout->code) {
-		case EXIT_AC : exit_func(csout->code, csout->time, csout->memory);
-					   break;
-
-		case EXIT_PE : 
-		case EXIT_WA : 
-		case EXIT_TLE :
-		case EXIT_MLE :
-		case EXIT_OLE : exit_func(csout->code);
+		case EXIT_AC :	res->time = csout->time;
+						res->memory = csout->memory;
 						break;
 
 		case EXIT_IE :
 		case EXIT_EE :
 		case EXIT_RE1 :
-		case EXIT_RE2 : exit_func(csout->code, csout->msg);
-						break;
-		
-		/* 未知的退出状态，由exit_func进行处理 */
-		default :		exit_func(csout->code);
+		case EXIT_RE2 :	snprintf(res->msg, ERR_MSG_MAX, "%s", csout->msg);
 						break;
+
+		/* 其他状态只有名称，未知的状态由exit_format处理 */
+		default :		break;
 	}
 }
 
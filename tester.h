@@ -2,15 +2,21 @@
  * 文件名：tester.h
  * 模块功能：准备用户程序的每组测试，并检测其测试结果
  * 版本：v0.1.0
- * 最后修改：2012-08-15
+ * 最后修改：2026-10-18
  **************************************************************/
 #include "global.h"
 #include "case.h"
 #include "data.h"
 #include "exit.h"
+#include "cache.h"
+#include "order.h"
+#include "calib.h"
+#include "progress.h"
+#include "score.h"
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -28,9 +34,36 @@ struct condition
 	int who;
 	const char *basedir;	/* 工作和根目录 */
 	const char *datadir;	/* 数据目录，相对basedir */
+	struct dataset *dataset;	/* 已打开的数据目录，NULL则按datadir打开 */
 	const char *magic;		/* 用于临时文件名 */
 	char * const *command;	/* 待测试的命令 */
+	int memtrace;			/* 内存采样间隔，单位毫秒，0为不采样 */
+	const char *cache;		/* 结果缓存目录，NULL为不使用缓存 */
+	const char *cache_policy;	/* 可缓存的结果列表，NULL为默认值 */
+	const char *stats;		/* 历史统计目录，NULL为不记录 */
+	int adaptive;			/* 为1则按历史统计安排测试顺序 */
+	const char *compare;	/* 比较方式，覆盖data.conf中的@compare */
+	int chktime;			/* 答案程序的时间限制，覆盖@checker-time */
+	const char *store;		/* 数据仓库目录，覆盖data.conf中的@store */
+	const char *gencache;	/* 生成数据的缓存目录，NULL为不缓存 */
+	const char *src;		/* 源程序，不为NULL则先编译，见compile.h */
+	const char *cc;			/* 编译器 */
+	const char *cflags;		/* 编译选项 */
+	const char *exe;		/* 编译生成的可执行文件，相对basedir */
+	const char *ccache;		/* 编译缓存目录，NULL为不缓存 */
+	int ctime;				/* 编译的墙上时间限制，单位毫秒 */
+	int cmemory;			/* 编译的内存限制，单位kb */
+	int zygote;				/* 为1则命令是zygote，见zygote.h */
+	const char *calibration;	/* 跟踪开销的校准文件，NULL为不扣除 */
+	const char *rootfs;		/* 沙箱的根文件系统，NULL为不使用沙箱 */
+	const char *cgroup;		/* cgroup v2的父组目录，NULL为不使用 */
+	int cpu;				/* 用户进程绑定的CPU，-1为不绑定 */
+	const char *cases;		/* 只运行的测试，如"1-3,7"，从1开始，NULL为全部 */
+	int progress;			/* 进度事件的描述符，-1为不输出，见progress.h */
+	enum scoremode score;	/* 部分分的评分方式，SCR_OFF为不评分，见score.h */
+	struct timespec begin;	/* 评测开始的时间（CLOCK_MONOTONIC），包括编译，
+							   为0则从tester_start开始计算 */
 };
-void tester_start(struct condition *cond);
+void tester_start(struct condition *cond, struct result *res);
 
 #endif
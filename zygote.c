@@ -0,0 +1,338 @@
+/*************************************************
+ * 源文件：zygote.c
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ ************************************************/
+#include "zygote.h"
+
+/*
+ * 等待zygote时的轮询间隔，单位毫秒
+ */
+#define ZYG_POLL_SLICE 10
+
+/*
+ * 局部函数声明
+ */
+static int zyg_handle(struct zygote *zg, int status, pid_t *forked);
+static int zyg_send(struct zygote *zg, int infd, int outfd);
+static int zyg_elapsed(const struct timespec *begin);
+
+/*
+ * 接口函数：zyg_start
+ * 功能：启动zygote并等待它初始化完毕
+ * 参数：zg为待启动的zygote，chd为运行zygote的条件，
+ *   其中的管道和控制描述符由本函数填写，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：zygote同用户程序一样由child模块设置目录、限制和用户身份，
+ *   控制套接字为CHILD_CTL_FD；zygote本身不检查系统调用，
+ *   派生出来的子进程由评测程序跟踪，运行用户程序时检查全部系统调用；
+ *   chd->rootfs不为NULL时zygote及其子进程都在同一个沙箱中
+ */
+int
+zyg_start(struct zygote *zg, struct childin *chd, char *errmsg)
+{
+	int sv[2], pfd[2], status, n;
+	char c;
+	pid_t forked;
+	struct timespec begin;
+	struct pollfd pfds;
+
+	zg->pid = -1;
+	zg->sock = -1;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**zyg_start** socketpair error: %s", strerror(errno));
+		return -1;
+	}
+	if (pipe(pfd) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**zyg_start** pipe error: %s", strerror(errno));
+		close(sv[0]);
+		close(sv[1]);
+		return -1;
+	}
+
+	chd->pfd[0] = pfd[0];
+	chd->pfd[1] = pfd[1];
+	chd->ctlfd = sv[1];
+	if ((zg->pid = sbx_fork(chd->rootfs)) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**zyg_start** fork error: %s", strerror(errno));
+		close(sv[0]);
+		close(sv[1]);
+		close(pfd[0]);
+		close(pfd[1]);
+		return -1;
+
+	} else if (zg->pid == 0) {
+		close(sv[0]);
+		child_run_process(chd);
+	}
+
+	close(sv[1]);
+	close(pfd[1]);
+	zg->sock = sv[0];
+
+	/* 期待zygote因为execve而被SIGTRAP停止 */
+	if (waitpid(zg->pid, &status, 0) == -1 || !WIFSTOPPED(status) ||
+			WSTOPSIG(status) != SIGTRAP) {
+		errmsg[0] = '\0';
+		if (WIFEXITED(status) && WEXITSTATUS(status) == 1 &&
+				(n = read(pfd[0], errmsg, ERR_MSG_MAX - 1)) > 0)
+			errmsg[n] = '\0';
+		if (errmsg[0] == '\0')
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**zyg_start** cannot execute zygote.");
+		close(pfd[0]);
+		zyg_stop(zg);
+		return -1;
+	}
+	close(pfd[0]);
+
+	/*
+	 * zygote派生的子进程自动被跟踪；评测程序退出时杀死zygote和子进程；
+	 * zygote本身不停在系统调用上
+	 */
+	if (ptrace(PTRACE_SETOPTIONS, zg->pid, 0,
+				PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK |
+				PTRACE_O_EXITKILL) == -1 ||
+			ptrace(PTRACE_CONT, zg->pid, 0, 0) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**zyg_start** ptrace error: %s", strerror(errno));
+		zyg_stop(zg);
+		return -1;
+	}
+
+	/* 等待就绪消息，其间处理zygote的停止 */
+	pfds.fd = zg->sock;
+	pfds.events = POLLIN;
+	while (1) {
+		while ((n = waitpid(zg->pid, &status, WNOHANG)) > 0) {
+			forked = -1;
+			if (zyg_handle(zg, status, &forked) != 0) {
+				snprintf(errmsg, ERR_MSG_MAX,
+						"**zyg_start** zygote exited during startup.");
+				zyg_stop(zg);
+				return -1;
+			}
+			/* 初始化期间派生的进程属于运行库，不跟踪 */
+			if (forked != -1) {
+				waitpid(forked, NULL, __WALL);
+				ptrace(PTRACE_DETACH, forked, 0, 0);
+			}
+		}
+
+		if (poll(&pfds, 1, ZYG_POLL_SLICE) == 1) {
+			if (recv(zg->sock, &c, 1, 0) == 1 && c == ZYG_READY)
+				break;
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**zyg_start** zygote failed to start.");
+			zyg_stop(zg);
+			return -1;
+		}
+
+		if (zyg_elapsed(&begin) > ZYG_START_TIME) {
+			snprintf(errmsg, ERR_MSG_MAX,
+					"**zyg_start** zygote startup timeout after %d ms",
+					ZYG_START_TIME);
+			zyg_stop(zg);
+			return -1;
+		}
+	}
+
+	zg->startup = zyg_elapsed(&begin);
+	return 0;
+}
+
+/*
+ * 接口函数：zyg_spawn
+ * 功能：让zygote派生一个子进程运行用户程序
+ * 参数：zg为zygote，infd和outfd为用户程序的标准输入输出，
+ *   cg不为NULL时子进程在继续运行之前移入其叶子组，
+ *   child接收子进程的ID，errmsg接收错误信息
+ * 返回值：成功返回0，出错返回-1
+ * 注意：返回时子进程已经以PTRACE_SYSCALL继续运行，
+ *   此后同execve之后的用户程序一样由case模块监控；
+ *   子进程的资源使用从派生时开始计算，不包括zygote的启动
+ */
+int
+zyg_spawn(struct zygote *zg, int infd, int outfd, struct cgroup *cg,
+		pid_t *child, char *errmsg)
+{
+	int status, n;
+	pid_t forked = -1;
+	struct timespec begin;
+
+	/* 先处理上一组测试留下的停止，例如子进程结束时的SIGCHLD */
+	while ((n = waitpid(zg->pid, &status, WNOHANG)) > 0) {
+		if (zyg_handle(zg, status, &forked) != 0)
+			break;
+		if (forked != -1) {
+			kill(forked, SIGKILL);
+			waitpid(forked, NULL, __WALL);
+			forked = -1;
+		}
+	}
+	if (zg->pid == -1) {
+		snprintf(errmsg, ERR_MSG_MAX, "**zyg_spawn** zygote exited.");
+		return -1;
+	}
+
+	if (zyg_send(zg, infd, outfd) != 0) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**zyg_spawn** sendmsg error: %s", strerror(errno));
+		return -1;
+	}
+
+	/* 等待zygote的派生事件，得到子进程的ID */
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	while (forked == -1) {
+		n = waitpid(zg->pid, &status, WNOHANG);
+		if (n == -1 || (n > 0 && zyg_handle(zg, status, &forked) != 0)) {
+			snprintf(errmsg, ERR_MSG_MAX, "**zyg_spawn** zygote exited.");
+			return -1;
+		}
+		if (n == 0) {
+			if (zyg_elapsed(&begin) > ZYG_START_TIME) {
+				snprintf(errmsg, ERR_MSG_MAX,
+						"**zyg_spawn** zygote does not fork.");
+				return -1;
+			}
+			poll(NULL, 0, 1);
+		}
+	}
+
+	/* 自动跟踪的子进程先以SIGSTOP停止 */
+	if (waitpid(forked, &status, __WALL) == -1 || !WIFSTOPPED(status)) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**zyg_spawn** child %d did not stop.", (int)forked);
+		kill(forked, SIGKILL);
+		return -1;
+	}
+
+	if (cg != NULL && cg_attach(cg, forked, errmsg) != 0) {
+		kill(forked, SIGKILL);
+		waitpid(forked, NULL, __WALL);
+		return -1;
+	}
+
+	/* 用户程序不继承zygote的派生跟踪，同普通的用户进程一样监控 */
+	if (ptrace(PTRACE_SETOPTIONS, forked, 0, PTRACE_O_EXITKILL) == -1 ||
+			ptrace(PTRACE_SYSCALL, forked, 0, 0) == -1) {
+		snprintf(errmsg, ERR_MSG_MAX,
+				"**zyg_spawn** ptrace error: %s", strerror(errno));
+		kill(forked, SIGKILL);
+		waitpid(forked, NULL, __WALL);
+		return -1;
+	}
+
+	*child = forked;
+	return 0;
+}
+
+/*
+ * 接口函数：zyg_stop
+ * 功能：结束zygote
+ * 参数：zg为zygote
+ * 返回值：无
+ */
+void
+zyg_stop(struct zygote *zg)
+{
+	if (zg->sock != -1) {
+		close(zg->sock);
+		zg->sock = -1;
+	}
+	if (zg->pid > 0) {
+		kill(zg->pid, SIGKILL);
+		waitpid(zg->pid, NULL, 0);
+	}
+	zg->pid = -1;
+}
+
+/*
+ * 局部函数：zyg_handle
+ * 功能：处理zygote的一次状态变化
+ * 参数：zg为zygote，status为waitpid得到的状态，
+ *   forked接收派生的子进程ID，没有派生则不改变
+ * 返回值：zygote继续运行返回0，zygote已经结束返回-1
+ * 注意：信号停止时把信号原样传递给zygote
+ */
+static int
+zyg_handle(struct zygote *zg, int status, pid_t *forked)
+{
+	unsigned long msg;
+	int event, sig = 0;
+
+	if (WIFEXITED(status) || WIFSIGNALED(status)) {
+		zg->pid = -1;
+		return -1;
+	}
+	if (!WIFSTOPPED(status))
+		return 0;
+
+	event = status >> 16;
+	if (WSTOPSIG(status) == SIGTRAP &&
+			(event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK)) {
+		if (ptrace(PTRACE_GETEVENTMSG, zg->pid, 0, &msg) == 0)
+			*forked = (pid_t)msg;
+	} else if (WSTOPSIG(status) != SIGTRAP) {
+		sig = WSTOPSIG(status);
+	}
+
+	ptrace(PTRACE_CONT, zg->pid, 0, sig);
+	return 0;
+}
+
+/*
+ * 局部函数：zyg_send
+ * 功能：发送ZYG_RUN消息，附带标准输入输出描述符
+ * 参数：zg为zygote，infd和outfd为描述符
+ * 返回值：成功返回0，出错返回-1
+ */
+static int
+zyg_send(struct zygote *zg, int infd, int outfd)
+{
+	char c = ZYG_RUN;
+	char ctrl[CMSG_SPACE(sizeof(int) * 2)];
+	int fds[2];
+	struct iovec iov;
+	struct msghdr mh;
+	struct cmsghdr *cm;
+
+	fds[0] = infd;
+	fds[1] = outfd;
+	iov.iov_base = &c;
+	iov.iov_len = 1;
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_control = ctrl;
+	mh.msg_controllen = sizeof(ctrl);
+
+	cm = CMSG_FIRSTHDR(&mh);
+	cm->cmsg_level = SOL_SOCKET;
+	cm->cmsg_type = SCM_RIGHTS;
+	cm->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+
+	return sendmsg(zg->sock, &mh, MSG_NOSIGNAL) == 1 ? 0 : -1;
+}
+
+/*
+ * 局部函数：zyg_elapsed
+ * 功能：计算从begin开始经过的墙上时间
+ * 参数：begin为开始时间
+ * 返回值：经过的毫秒数
+ */
+static int
+zyg_elapsed(const struct timespec *begin)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - begin->tv_sec) * 1000 +
+		(now.tv_nsec - begin->tv_nsec) / 1000000;
+}
@@ -0,0 +1,57 @@
+/***************************************************************
+ * 文件名：zygote.h
+ * 模块功能：管理预先初始化的解释器（zygote），每次评测只启动一次，
+ *   每组测试由zygote派生一个子进程运行用户程序，
+ *   解释器的启动时间和内存不计入用户程序的使用
+ * 版本：v0.1.0
+ * 最后修改：2026-10-18
+ **************************************************************/
+#include "global.h"
+#include "child.h"
+#include "cgroup.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+/*
+ * zygote启动（导入运行库、编译用户程序）的墙上时间限制，单位毫秒
+ */
+#define ZYG_START_TIME 10000
+
+/*
+ * 协议消息：zygote就绪后发送ZYG_READY；
+ *   评测程序发送ZYG_RUN并附带标准输入输出两个描述符，zygote派生一个子进程
+ */
+#define ZYG_READY 'z'
+#define ZYG_RUN 'r'
+
+/*
+ * 预先初始化的解释器
+ */
+struct zygote
+{
+	pid_t pid;				/* zygote的进程ID，-1为没有运行 */
+	int sock;				/* 与zygote通讯的套接字 */
+	int startup;			/* 启动使用的墙上时间，单位毫秒 */
+};
+
+int zyg_start(struct zygote *zg, struct childin *chd, char *errmsg);
+int zyg_spawn(struct zygote *zg, int infd, int outfd, struct cgroup *cg,
+		pid_t *child, char *errmsg);
+void zyg_stop(struct zygote *zg);
+
+#endif
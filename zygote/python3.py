@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+# zygote for Python 3 submissions, protocol in doc/HowTo_zygote.txt
+# usage: moj ... --zygote --end python3 python3.py main.py
+
+import array
+import io
+import os
+import socket
+import sys
+import traceback
+
+# modules most submissions import, loaded once before forking
+import bisect
+import collections
+import copy
+import decimal
+import fractions
+import functools
+import heapq
+import itertools
+import math
+import operator
+import random
+import re
+import string
+
+CTL_FD = 3
+READY = b'z'
+RUN = b'r'
+
+
+def run(code, path, fds):
+    """Runs in the forked child: rebind stdio, execute, never return."""
+    os.dup2(fds[0], 0)
+    os.dup2(fds[1], 1)
+    for fd in fds:
+        if fd > 2:
+            os.close(fd)
+    os.close(CTL_FD)
+
+    sys.stdin = io.TextIOWrapper(io.FileIO(0, 'r', closefd=False))
+    sys.stdout = io.TextIOWrapper(io.FileIO(1, 'w', closefd=False))
+    sys.argv = [path]
+
+    status = 0
+    try:
+        if code is None:
+            code = compile(open(path, 'rb').read(), path, 'exec')
+        exec(code, {'__name__': '__main__', '__file__': path,
+                    '__builtins__': __builtins__})
+    except SystemExit as e:
+        if e.code is None:
+            status = 0
+        elif isinstance(e.code, int):
+            status = e.code
+        else:
+            status = 1
+    except BaseException:
+        traceback.print_exc()
+        status = 1
+    try:
+        sys.stdout.flush()
+    except BaseException:
+        status = status or 1
+    os._exit(status)
+
+
+def main():
+    path = sys.argv[1]
+    with open(path, 'rb') as f:
+        source = f.read()
+
+    # syntax errors are reported by the child, like a normal run
+    try:
+        code = compile(source, path, 'exec')
+    except SyntaxError:
+        code = None
+
+    sock = socket.socket(fileno=CTL_FD)
+    sock.send(READY)
+
+    size = socket.CMSG_SPACE(2 * array.array('i').itemsize)
+    while True:
+        try:
+            msg, anc, _, _ = sock.recvmsg(1, size)
+        except OSError:
+            break
+        if msg != RUN:
+            break
+
+        fds = array.array('i')
+        for level, kind, data in anc:
+            if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+                fds.frombytes(data[:len(data) - len(data) % fds.itemsize])
+        if len(fds) != 2:
+            break
+
+        pid = os.fork()
+        if pid == 0:
+            run(code, path, fds)
+        for fd in fds:
+            os.close(fd)
+        os.waitpid(pid, 0)
+
+
+if __name__ == '__main__':
+    main()